@@ -0,0 +1,1506 @@
+#pragma once
+#include "RB_Tree.h"
+#include <algorithm>
+#include <climits>
+#include <cstddef>
+#include <iostream>
+#include <iomanip>
+#include <iterator>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+//Vector compares used by the in-node key scan. SSE2 is part of every x86-64 target, 64 bit integer compares need
+//SSE4.2. Other targets, or builds without these instruction sets, use the portable scan.
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64)
+#include <emmintrin.h>
+#define B_TREE_SSE2 1
+#else
+#define B_TREE_SSE2 0
+#endif
+#if defined(__SSE4_2__)
+#include <nmmintrin.h>
+#define B_TREE_SSE42 1
+#else
+#define B_TREE_SSE42 0
+#endif
+
+//B+ tree with the public interface of RB_Tree. Every node packs many sorted keys into a few cache lines, so a search
+//touches far fewer nodes than in a binary tree and each node it touches is read from contiguous memory.
+//
+//All keys live in the leaves, which are linked in key order. Inner nodes hold separator keys only: every key in
+//children[i] is smaller than keys[i], which is no larger than any key in children[i + 1]. Fat nodes cannot give each
+//copy of a key its own node, so Duplicates::MULTI_NODE behaves like Duplicates::COUNTED and stores a repeat count
+//beside each key. Duplicates::UNIQUE stores no counts.
+//
+//nodeBytes is the target size of a node. The default of 256 bytes is four 64 byte cache lines.
+template<typename keyType, Duplicates duplicates = Duplicates::MULTI_NODE, unsigned nodeBytes = 256>
+class B_Tree
+{
+private:
+    //Keys are counted unless the tree rejects duplicates
+    static constexpr bool COUNTED{ duplicates != Duplicates::UNIQUE };
+
+    //Fields shared by leaves and inner nodes
+    struct Node
+    {
+        unsigned short numKeys;     //Number of keys in use
+        bool isLeaf;                //True for a Leaf, false for an Inner node
+    };
+
+    /// <summary>
+    /// Number of key slots that fit in a node once the fixed fields are accounted for. At least 4 so a split always
+    /// leaves two usable halves, even for large keys.
+    /// </summary>
+    static constexpr unsigned short capacity(const std::size_t fixedBytes, const std::size_t slotBytes)
+    {
+        return (nodeBytes > fixedBytes && (nodeBytes - fixedBytes) / slotBytes > 4) ?
+            static_cast<unsigned short>((nodeBytes - fixedBytes) / slotBytes) : 4;
+    }
+
+    static constexpr unsigned short LEAF_CAPACITY{ capacity(sizeof(Node) + 2 * sizeof(void*), sizeof(keyType) + (COUNTED ? sizeof(unsigned) : 0)) };
+    static constexpr unsigned short INNER_CAPACITY{ capacity(sizeof(Node) + sizeof(void*), sizeof(keyType) + sizeof(void*)) };
+
+    //Fewest keys a node other than the root may hold. Two siblings at the minimum always fit in one node when merged.
+    static constexpr unsigned short MIN_LEAF_KEYS{ LEAF_CAPACITY / 2 };
+    static constexpr unsigned short MIN_INNER_KEYS{ (INNER_CAPACITY - 1) / 2 };
+
+    //Number of keys compared per step of the in-node scan for arithmetic keys. One block spans a cache line.
+    static constexpr unsigned SCAN_BLOCK{ (sizeof(keyType) < 64) ? static_cast<unsigned>(64 / sizeof(keyType)) : 1 };
+
+    //Repeat counts of a leaf's keys. Only leaves of a counted tree carry them.
+    struct LeafCounts
+    {
+        unsigned counts[LEAF_CAPACITY];     //Number of copies of keys[i], at least 1
+    };
+    struct NoLeafCounts
+    {
+    };
+
+    struct Leaf : Node, std::conditional<COUNTED, LeafCounts, NoLeafCounts>::type
+    {
+        keyType keys[LEAF_CAPACITY];    //Keys in ascending order
+        Leaf* prev;                     //Leaf holding the next smaller keys, nullptr for the first leaf
+        Leaf* next;                     //Leaf holding the next larger keys, nullptr for the last leaf
+    };
+
+    struct Inner : Node
+    {
+        keyType keys[INNER_CAPACITY];           //Separator keys in ascending order
+        Node* children[INNER_CAPACITY + 1];     //numKeys + 1 children
+    };
+
+    //Result of an insert into a subtree that had to split. right is nullptr when no split happened.
+    struct Split
+    {
+        keyType separator;      //Smallest key of the new right node
+        Node* right;            //New node holding the upper half of the split node
+    };
+
+    Node* root;             //Root of the tree, nullptr when the tree is empty
+    Leaf* head;             //Leaf holding the smallest keys, nullptr when the tree is empty
+    Leaf* tail;             //Leaf holding the largest keys, nullptr when the tree is empty
+    unsigned numNodes;      //Number of leaves and inner nodes
+    unsigned numDistinct;   //Number of distinct keys, one per used leaf slot
+    unsigned numKeys;       //Number of keys including repeated copies
+    int height;             //Number of inner levels above the leaves, -1 when the tree is empty
+
+    //Private member functions
+    template<bool orEqual>
+    static unsigned countBlock(const keyType* const, const keyType&);
+    template<bool orEqual>
+    static unsigned rank(const keyType* const, const unsigned, const keyType&);
+    static unsigned lowerBound(const keyType* const, const unsigned, const keyType&);
+    static unsigned upperBound(const keyType* const, const unsigned, const keyType&);
+    static unsigned keyCount(const Leaf* const, const unsigned);
+    Leaf* createLeaf();
+    Inner* createInner();
+    void freeNode(Node* const);
+    const Leaf* findLeaf(const keyType&) const;
+    bool insertInto(Node* const, const keyType&, const unsigned, Split&);
+    void splitLeaf(Leaf* const, Split&);
+    void splitInner(Inner* const, Split&);
+    bool removeFrom(Node* const, const keyType&);
+    void fixUnderflow(Inner* const, const unsigned);
+    bool isUnderfull(const Node* const) const;
+    bool insertCopies(const keyType&, const unsigned);
+    Node* copySubtree(const Node* const, Leaf*&);
+    void destroySubtree(Node* const);
+
+public:
+    //Bidirectional iterator visiting the distinct keys in ascending order. Keys cannot be modified through an
+    //iterator. Any insert or remove may move keys between leaves and invalidates every iterator.
+    class iterator
+    {
+    private:
+        friend class B_Tree;
+
+        const Leaf* leaf;       //Leaf the iterator refers to, nullptr for end()
+        unsigned index;         //Slot of the key within the leaf
+        const B_Tree* tree;     //Tree the leaf belongs to
+
+        iterator(const Leaf* const, const unsigned, const B_Tree* const);
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = keyType;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const keyType*;
+        using reference = const keyType&;
+
+        iterator();
+        reference operator*() const;
+        pointer operator->() const;
+        iterator& operator++();
+        iterator operator++(int);
+        iterator& operator--();
+        iterator operator--(int);
+        bool operator==(const iterator&) const;
+        bool operator!=(const iterator&) const;
+    };
+    using const_iterator = iterator;
+
+    //Default Constructor
+    B_Tree();
+
+    //Copy Constructor
+    B_Tree(const B_Tree&);
+
+    //Move Constructor
+    B_Tree(B_Tree&&) noexcept;
+
+    //Destructor
+    ~B_Tree();
+
+    //Public member functions
+    bool insert(const keyType& x);
+    bool remove(const keyType& x);
+    bool containsKey(const keyType& x) const;
+    unsigned countKey(const keyType& x) const;
+    bool isEmpty() const;
+    unsigned getNumNodes() const;
+    unsigned getNumKeys() const;
+    int getTreeHeight() const;
+    void statistics() const;
+    void destroyTree();
+    void displayTree(const Order) const;
+    iterator begin() const;
+    iterator end() const;
+    const keyType& getMin() const;
+    const keyType& getMax() const;
+
+    //Overloaded Operators
+    B_Tree<keyType, duplicates, nodeBytes>& operator=(const B_Tree<keyType, duplicates, nodeBytes>&);
+    B_Tree<keyType, duplicates, nodeBytes>& operator=(B_Tree<keyType, duplicates, nodeBytes>&&) noexcept;
+    B_Tree<keyType, duplicates, nodeBytes> operator+(const B_Tree<keyType, duplicates, nodeBytes>&) const;
+    B_Tree<keyType, duplicates, nodeBytes>& operator+=(const B_Tree<keyType, duplicates, nodeBytes>&);
+    bool operator==(const B_Tree&) const;
+    bool operator!=(const B_Tree&) const;
+};
+
+//***************************************************
+//		Private member function definitions
+//***************************************************
+/// <summary>
+/// Counts the keys in one SCAN_BLOCK of arithmetic keys that are smaller than x, or no larger than x when orEqual is
+/// set. 32 bit integers, floats and doubles are compared with SSE2 and 64 bit integers with SSE4.2 when available.
+/// Each matching lane of a compare is all ones, i.e. -1, so subtracting the compare results counts the matches.
+/// </summary>
+/// <param name="keys"> The first key of the block. </param>
+/// <param name="x"> The key being located. </param>
+/// <returns> The number of keys in the block that are below x. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+template<bool orEqual>
+unsigned B_Tree<keyType, duplicates, nodeBytes>::countBlock(const keyType* const keys, const keyType& x)
+{
+#if B_TREE_SSE2
+    if constexpr (std::is_integral<keyType>::value && sizeof(keyType) == 4)
+    {
+        //Unsigned keys are biased into the signed range so the signed compare orders them correctly
+        const __m128i bias{ _mm_set1_epi32(std::is_signed<keyType>::value ? 0 : INT_MIN) };
+        const __m128i target{ _mm_xor_si128(_mm_set1_epi32(static_cast<int>(x)), bias) };
+        __m128i matches{ _mm_setzero_si128() };
+
+        for (unsigned i{ 0 }; i < SCAN_BLOCK; i += 4)
+        {
+            const __m128i block{ _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), bias) };
+            matches = _mm_sub_epi32(matches, orEqual ? _mm_cmpgt_epi32(block, target) : _mm_cmpgt_epi32(target, block));
+        }
+
+        //Add the four lane counts together
+        matches = _mm_add_epi32(matches, _mm_shuffle_epi32(matches, _MM_SHUFFLE(1, 0, 3, 2)));
+        matches = _mm_add_epi32(matches, _mm_shuffle_epi32(matches, _MM_SHUFFLE(2, 3, 0, 1)));
+        const unsigned found{ static_cast<unsigned>(_mm_cvtsi128_si32(matches)) };
+
+        //With orEqual the compare found the keys above x
+        return orEqual ? SCAN_BLOCK - found : found;
+    }
+    else if constexpr (std::is_same<keyType, float>::value)
+    {
+        const __m128 target{ _mm_set1_ps(x) };
+        __m128i matches{ _mm_setzero_si128() };
+
+        for (unsigned i{ 0 }; i < SCAN_BLOCK; i += 4)
+        {
+            const __m128 block{ _mm_loadu_ps(keys + i) };
+            matches = _mm_sub_epi32(matches, _mm_castps_si128(orEqual ? _mm_cmpgt_ps(block, target) : _mm_cmplt_ps(block, target)));
+        }
+
+        matches = _mm_add_epi32(matches, _mm_shuffle_epi32(matches, _MM_SHUFFLE(1, 0, 3, 2)));
+        matches = _mm_add_epi32(matches, _mm_shuffle_epi32(matches, _MM_SHUFFLE(2, 3, 0, 1)));
+        const unsigned found{ static_cast<unsigned>(_mm_cvtsi128_si32(matches)) };
+
+        return orEqual ? SCAN_BLOCK - found : found;
+    }
+    else if constexpr (std::is_same<keyType, double>::value)
+    {
+        const __m128d target{ _mm_set1_pd(x) };
+        __m128i matches{ _mm_setzero_si128() };
+
+        for (unsigned i{ 0 }; i < SCAN_BLOCK; i += 2)
+        {
+            const __m128d block{ _mm_loadu_pd(keys + i) };
+            matches = _mm_sub_epi64(matches, _mm_castpd_si128(orEqual ? _mm_cmpgt_pd(block, target) : _mm_cmplt_pd(block, target)));
+        }
+
+        //Add the two lane counts together. The counts are small, so the low 32 bits hold the sum.
+        matches = _mm_add_epi64(matches, _mm_unpackhi_epi64(matches, matches));
+        const unsigned found{ static_cast<unsigned>(_mm_cvtsi128_si32(matches)) };
+
+        return orEqual ? SCAN_BLOCK - found : found;
+    }
+#endif
+#if B_TREE_SSE42
+    if constexpr (std::is_integral<keyType>::value && sizeof(keyType) == 8)
+    {
+        const __m128i bias{ _mm_set1_epi64x(std::is_signed<keyType>::value ? 0 : LLONG_MIN) };
+        const __m128i target{ _mm_xor_si128(_mm_set1_epi64x(static_cast<long long>(x)), bias) };
+        __m128i matches{ _mm_setzero_si128() };
+
+        for (unsigned i{ 0 }; i < SCAN_BLOCK; i += 2)
+        {
+            const __m128i block{ _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), bias) };
+            matches = _mm_sub_epi64(matches, orEqual ? _mm_cmpgt_epi64(block, target) : _mm_cmpgt_epi64(target, block));
+        }
+
+        matches = _mm_add_epi64(matches, _mm_unpackhi_epi64(matches, matches));
+        const unsigned found{ static_cast<unsigned>(_mm_cvtsi128_si32(matches)) };
+
+        return orEqual ? SCAN_BLOCK - found : found;
+    }
+#endif
+
+    //Portable scan. Comparisons are summed rather than branched on so the compiler is free to vectorize it.
+    unsigned found{ 0 };
+    for (unsigned i{ 0 }; i < SCAN_BLOCK; ++i)
+    {
+        found += orEqual ? !(x < keys[i]) : (keys[i] < x);
+    }
+    return found;
+}
+
+/// <summary>
+/// Counts the keys in a sorted array that are smaller than x, or no larger than x when orEqual is set.
+/// Arithmetic keys are compared a cache line at a time without branches, and the scan stops at the first block
+/// that is not entirely below x. Other key types use a binary search, since their comparisons are too expensive to
+/// spend on keys that cannot matter.
+/// </summary>
+/// <param name="keys"> The sorted keys of a node. </param>
+/// <param name="count"> The number of keys in use. </param>
+/// <param name="x"> The key being located. </param>
+/// <returns> The index of the first key not below x. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+template<bool orEqual>
+unsigned B_Tree<keyType, duplicates, nodeBytes>::rank(const keyType* const keys, const unsigned count, const keyType& x)
+{
+    if constexpr (std::is_arithmetic<keyType>::value)
+    {
+        unsigned position{ 0 };
+
+        while (position + SCAN_BLOCK <= count)
+        {
+            const unsigned below{ countBlock<orEqual>(keys + position, x) };
+
+            position += below;
+            if (below != SCAN_BLOCK)
+            {
+                return position;
+            }
+        }
+
+        //Fewer than a block of keys remain
+        while (position < count && (orEqual ? !(x < keys[position]) : (keys[position] < x)))
+        {
+            ++position;
+        }
+        return position;
+    }
+    else if constexpr (orEqual)
+    {
+        return static_cast<unsigned>(std::upper_bound(keys, keys + count, x) - keys);
+    }
+    else
+    {
+        return static_cast<unsigned>(std::lower_bound(keys, keys + count, x) - keys);
+    }
+}
+
+/// <summary>
+/// Finds the slot of a key in a leaf, or the slot where it belongs.
+/// </summary>
+/// <returns> The number of keys smaller than x. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+unsigned B_Tree<keyType, duplicates, nodeBytes>::lowerBound(const keyType* const keys, const unsigned count, const keyType& x)
+{
+    return rank<false>(keys, count, x);
+}
+
+/// <summary>
+/// Finds the child of an inner node whose subtree may hold a key.
+/// </summary>
+/// <returns> The number of separators no larger than x. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+unsigned B_Tree<keyType, duplicates, nodeBytes>::upperBound(const keyType* const keys, const unsigned count, const keyType& x)
+{
+    return rank<true>(keys, count, x);
+}
+
+/// <summary>
+/// Returns the number of copies of the key in a leaf slot. Always 1 in a Duplicates::UNIQUE tree.
+/// </summary>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+unsigned B_Tree<keyType, duplicates, nodeBytes>::keyCount(const Leaf* const leaf, const unsigned index)
+{
+    if constexpr (COUNTED)
+    {
+        return leaf->counts[index];
+    }
+    else
+    {
+        return 1;
+    }
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Allocates an empty leaf that is not linked to any other leaf.
+/// </summary>
+/// <returns> A pointer to the new leaf. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+typename B_Tree<keyType, duplicates, nodeBytes>::Leaf* B_Tree<keyType, duplicates, nodeBytes>::createLeaf()
+{
+    Leaf* const newLeaf{ new Leaf };
+    newLeaf->numKeys = 0;
+    newLeaf->isLeaf = true;
+    newLeaf->prev = nullptr;
+    newLeaf->next = nullptr;
+    ++numNodes;
+    return newLeaf;
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Allocates an empty inner node.
+/// </summary>
+/// <returns> A pointer to the new inner node. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+typename B_Tree<keyType, duplicates, nodeBytes>::Inner* B_Tree<keyType, duplicates, nodeBytes>::createInner()
+{
+    Inner* const newInner{ new Inner };
+    newInner->numKeys = 0;
+    newInner->isLeaf = false;
+    ++numNodes;
+    return newInner;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Frees a single node as the type it was allocated as. Its children are not freed.
+/// </summary>
+/// <param name="node"> A pointer to the node being freed. </param>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+void B_Tree<keyType, duplicates, nodeBytes>::freeNode(Node* const node)
+{
+    if (node->isLeaf)
+    {
+        delete static_cast<Leaf*>(node);
+    }
+    else
+    {
+        delete static_cast<Inner*>(node);
+    }
+    --numNodes;
+}
+
+/// <summary>
+/// Descends from the root to the leaf whose key range covers x.
+/// </summary>
+/// <param name="x"> The key being searched for. </param>
+/// <returns> A pointer to the leaf that holds x if x is in the tree, nullptr if the tree is empty. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+const typename B_Tree<keyType, duplicates, nodeBytes>::Leaf* B_Tree<keyType, duplicates, nodeBytes>::findLeaf(const keyType& x) const
+{
+    const Node* traverse{ root };
+
+    while (traverse != nullptr && !traverse->isLeaf)
+    {
+        const Inner* const inner{ static_cast<const Inner*>(traverse) };
+        traverse = inner->children[upperBound(inner->keys, inner->numKeys, x)];
+    }
+
+    return static_cast<const Leaf*>(traverse);
+}
+
+/// <summary>
+/// Inserts copies of a key into the subtree rooted at node. A full node is split before the new entry is added and
+/// the upper half is returned through split so the caller can link it into the parent.
+/// </summary>
+/// <param name="node"> The root of the subtree receiving the key. </param>
+/// <param name="x"> The key being inserted. </param>
+/// <param name="copies"> The number of copies being inserted, at least 1. </param>
+/// <param name="split"> Set to the new right sibling of node when node splits, otherwise right is left nullptr. </param>
+/// <returns> False if the key was already present in a Duplicates::UNIQUE tree, otherwise true. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+bool B_Tree<keyType, duplicates, nodeBytes>::insertInto(Node* const node, const keyType& x, const unsigned copies, Split& split)
+{
+    if (node->isLeaf)
+    {
+        Leaf* leaf{ static_cast<Leaf*>(node) };
+        unsigned position{ lowerBound(leaf->keys, leaf->numKeys, x) };
+
+        //An existing key gains copies without using a new slot
+        if (position < leaf->numKeys && !(x < leaf->keys[position]))
+        {
+            if constexpr (COUNTED)
+            {
+                leaf->counts[position] += copies;
+                numKeys += copies;
+                return true;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        if (leaf->numKeys == LEAF_CAPACITY)
+        {
+            splitLeaf(leaf, split);
+
+            //Keys at or past the split point belong to the new right leaf
+            if (position > leaf->numKeys)
+            {
+                position -= leaf->numKeys;
+                leaf = static_cast<Leaf*>(split.right);
+            }
+        }
+
+        //Shift the larger keys up one slot to make room
+        std::move_backward(leaf->keys + position, leaf->keys + leaf->numKeys, leaf->keys + leaf->numKeys + 1);
+        leaf->keys[position] = x;
+        if constexpr (COUNTED)
+        {
+            std::copy_backward(leaf->counts + position, leaf->counts + leaf->numKeys, leaf->counts + leaf->numKeys + 1);
+            leaf->counts[position] = copies;
+        }
+        ++leaf->numKeys;
+
+        //The new key may now be the smallest key of the right half
+        if (split.right != nullptr)
+        {
+            split.separator = static_cast<Leaf*>(split.right)->keys[0];
+        }
+
+        ++numDistinct;
+        numKeys += copies;
+        return true;
+    }
+
+    Inner* inner{ static_cast<Inner*>(node) };
+    unsigned position{ upperBound(inner->keys, inner->numKeys, x) };
+
+    Split childSplit{ keyType{}, nullptr };
+    const bool inserted{ insertInto(inner->children[position], x, copies, childSplit) };
+
+    if (childSplit.right == nullptr)
+    {
+        return inserted;
+    }
+
+    //The child split, so its new sibling and separator are added after it
+    if (inner->numKeys == INNER_CAPACITY)
+    {
+        splitInner(inner, split);
+
+        //Children past the one promoting the separator moved to the new right node
+        if (position > inner->numKeys)
+        {
+            position -= inner->numKeys + 1;
+            inner = static_cast<Inner*>(split.right);
+        }
+    }
+
+    std::move_backward(inner->keys + position, inner->keys + inner->numKeys, inner->keys + inner->numKeys + 1);
+    std::copy_backward(inner->children + position + 1, inner->children + inner->numKeys + 1, inner->children + inner->numKeys + 2);
+    inner->keys[position] = std::move(childSplit.separator);
+    inner->children[position + 1] = childSplit.right;
+    ++inner->numKeys;
+
+    return inserted;
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Moves the upper half of a full leaf into a new leaf linked after it.
+/// </summary>
+/// <param name="leaf"> The full leaf being split. </param>
+/// <param name="split"> Receives the new leaf and its smallest key. </param>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+void B_Tree<keyType, duplicates, nodeBytes>::splitLeaf(Leaf* const leaf, Split& split)
+{
+    Leaf* const right{ createLeaf() };
+    const unsigned keep{ LEAF_CAPACITY - LEAF_CAPACITY / 2 };
+
+    std::move(leaf->keys + keep, leaf->keys + leaf->numKeys, right->keys);
+    if constexpr (COUNTED)
+    {
+        std::copy(leaf->counts + keep, leaf->counts + leaf->numKeys, right->counts);
+    }
+    right->numKeys = static_cast<unsigned short>(leaf->numKeys - keep);
+    leaf->numKeys = static_cast<unsigned short>(keep);
+
+    //Link the new leaf into the leaf list
+    right->prev = leaf;
+    right->next = leaf->next;
+    if (leaf->next != nullptr)
+    {
+        leaf->next->prev = right;
+    }
+    else
+    {
+        tail = right;
+    }
+    leaf->next = right;
+
+    split.separator = right->keys[0];
+    split.right = right;
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Moves the upper half of a full inner node into a new inner node. The middle separator is not kept in either half,
+/// it is passed up to the parent.
+/// </summary>
+/// <param name="inner"> The full inner node being split. </param>
+/// <param name="split"> Receives the new node and the separator between the halves. </param>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+void B_Tree<keyType, duplicates, nodeBytes>::splitInner(Inner* const inner, Split& split)
+{
+    Inner* const right{ createInner() };
+    const unsigned middle{ INNER_CAPACITY / 2 };
+
+    std::move(inner->keys + middle + 1, inner->keys + inner->numKeys, right->keys);
+    std::copy(inner->children + middle + 1, inner->children + inner->numKeys + 1, right->children);
+    right->numKeys = static_cast<unsigned short>(inner->numKeys - middle - 1);
+    inner->numKeys = static_cast<unsigned short>(middle);
+
+    split.separator = std::move(inner->keys[middle]);
+    split.right = right;
+}
+
+/// <summary>
+/// Removes one copy of a key from the subtree rooted at node. Children left with too few keys on the way back up are
+/// refilled from a sibling or merged with one.
+/// </summary>
+/// <param name="node"> The root of the subtree holding the key. </param>
+/// <param name="x"> The key being removed. </param>
+/// <returns> True if a copy of the key was removed, otherwise false. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+bool B_Tree<keyType, duplicates, nodeBytes>::removeFrom(Node* const node, const keyType& x)
+{
+    if (node->isLeaf)
+    {
+        Leaf* const leaf{ static_cast<Leaf*>(node) };
+        const unsigned position{ lowerBound(leaf->keys, leaf->numKeys, x) };
+
+        if (position == leaf->numKeys || x < leaf->keys[position])
+        {
+            return false;
+        }
+
+        --numKeys;
+
+        //A counted key held more than once only loses one copy
+        if constexpr (COUNTED)
+        {
+            if (leaf->counts[position] > 1)
+            {
+                --leaf->counts[position];
+                return true;
+            }
+            std::copy(leaf->counts + position + 1, leaf->counts + leaf->numKeys, leaf->counts + position);
+        }
+        std::move(leaf->keys + position + 1, leaf->keys + leaf->numKeys, leaf->keys + position);
+        --leaf->numKeys;
+        --numDistinct;
+
+        return true;
+    }
+
+    Inner* const inner{ static_cast<Inner*>(node) };
+    const unsigned position{ upperBound(inner->keys, inner->numKeys, x) };
+
+    if (!removeFrom(inner->children[position], x))
+    {
+        return false;
+    }
+
+    if (isUnderfull(inner->children[position]))
+    {
+        fixUnderflow(inner, position);
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Determines if a node other than the root holds fewer keys than allowed.
+/// </summary>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+bool B_Tree<keyType, duplicates, nodeBytes>::isUnderfull(const Node* const node) const
+{
+    return node->numKeys < (node->isLeaf ? MIN_LEAF_KEYS : MIN_INNER_KEYS);
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Refills a child that has one key too few. A sibling with a key to spare gives one up, rotating it through the
+/// parent's separator. Otherwise the child is merged with a sibling and the separator between them is removed
+/// from the parent, which may leave the parent underfull in turn.
+/// </summary>
+/// <param name="parent"> The inner node holding the underfull child. </param>
+/// <param name="position"> The index of the underfull child in parent. </param>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+void B_Tree<keyType, duplicates, nodeBytes>::fixUnderflow(Inner* const parent, const unsigned position)
+{
+    Node* const child{ parent->children[position] };
+    Node* const leftSibling{ (position > 0) ? parent->children[position - 1] : nullptr };
+    Node* const rightSibling{ (position < parent->numKeys) ? parent->children[position + 1] : nullptr };
+
+    if (child->isLeaf)
+    {
+        Leaf* const leaf{ static_cast<Leaf*>(child) };
+
+        //Borrow the largest key of the left sibling
+        if (leftSibling != nullptr && leftSibling->numKeys > MIN_LEAF_KEYS)
+        {
+            Leaf* const left{ static_cast<Leaf*>(leftSibling) };
+
+            std::move_backward(leaf->keys, leaf->keys + leaf->numKeys, leaf->keys + leaf->numKeys + 1);
+            leaf->keys[0] = std::move(left->keys[left->numKeys - 1]);
+            if constexpr (COUNTED)
+            {
+                std::copy_backward(leaf->counts, leaf->counts + leaf->numKeys, leaf->counts + leaf->numKeys + 1);
+                leaf->counts[0] = left->counts[left->numKeys - 1];
+            }
+            --left->numKeys;
+            ++leaf->numKeys;
+
+            parent->keys[position - 1] = leaf->keys[0];
+            return;
+        }
+
+        //Borrow the smallest key of the right sibling
+        if (rightSibling != nullptr && rightSibling->numKeys > MIN_LEAF_KEYS)
+        {
+            Leaf* const right{ static_cast<Leaf*>(rightSibling) };
+
+            leaf->keys[leaf->numKeys] = std::move(right->keys[0]);
+            std::move(right->keys + 1, right->keys + right->numKeys, right->keys);
+            if constexpr (COUNTED)
+            {
+                leaf->counts[leaf->numKeys] = right->counts[0];
+                std::copy(right->counts + 1, right->counts + right->numKeys, right->counts);
+            }
+            --right->numKeys;
+            ++leaf->numKeys;
+
+            parent->keys[position] = right->keys[0];
+            return;
+        }
+    }
+    else
+    {
+        Inner* const inner{ static_cast<Inner*>(child) };
+
+        //Rotate the left sibling's last child through the separator
+        if (leftSibling != nullptr && leftSibling->numKeys > MIN_INNER_KEYS)
+        {
+            Inner* const left{ static_cast<Inner*>(leftSibling) };
+
+            std::move_backward(inner->keys, inner->keys + inner->numKeys, inner->keys + inner->numKeys + 1);
+            std::copy_backward(inner->children, inner->children + inner->numKeys + 1, inner->children + inner->numKeys + 2);
+            inner->keys[0] = std::move(parent->keys[position - 1]);
+            inner->children[0] = left->children[left->numKeys];
+            parent->keys[position - 1] = std::move(left->keys[left->numKeys - 1]);
+            --left->numKeys;
+            ++inner->numKeys;
+            return;
+        }
+
+        //Rotate the right sibling's first child through the separator
+        if (rightSibling != nullptr && rightSibling->numKeys > MIN_INNER_KEYS)
+        {
+            Inner* const right{ static_cast<Inner*>(rightSibling) };
+
+            inner->keys[inner->numKeys] = std::move(parent->keys[position]);
+            inner->children[inner->numKeys + 1] = right->children[0];
+            parent->keys[position] = std::move(right->keys[0]);
+            std::move(right->keys + 1, right->keys + right->numKeys, right->keys);
+            std::copy(right->children + 1, right->children + right->numKeys + 1, right->children);
+            --right->numKeys;
+            ++inner->numKeys;
+            return;
+        }
+    }
+
+    //Neither sibling can spare a key. Merge the right one of the pair into the left one.
+    const unsigned leftIndex{ (leftSibling != nullptr) ? position - 1 : position };
+    Node* const left{ parent->children[leftIndex] };
+    Node* const right{ parent->children[leftIndex + 1] };
+
+    if (left->isLeaf)
+    {
+        Leaf* const leftLeaf{ static_cast<Leaf*>(left) };
+        Leaf* const rightLeaf{ static_cast<Leaf*>(right) };
+
+        std::move(rightLeaf->keys, rightLeaf->keys + rightLeaf->numKeys, leftLeaf->keys + leftLeaf->numKeys);
+        if constexpr (COUNTED)
+        {
+            std::copy(rightLeaf->counts, rightLeaf->counts + rightLeaf->numKeys, leftLeaf->counts + leftLeaf->numKeys);
+        }
+        leftLeaf->numKeys = static_cast<unsigned short>(leftLeaf->numKeys + rightLeaf->numKeys);
+
+        //Unlink the emptied leaf
+        leftLeaf->next = rightLeaf->next;
+        if (rightLeaf->next != nullptr)
+        {
+            rightLeaf->next->prev = leftLeaf;
+        }
+        else
+        {
+            tail = leftLeaf;
+        }
+    }
+    else
+    {
+        Inner* const leftInner{ static_cast<Inner*>(left) };
+        Inner* const rightInner{ static_cast<Inner*>(right) };
+
+        //The separator comes down between the two halves
+        leftInner->keys[leftInner->numKeys] = std::move(parent->keys[leftIndex]);
+        std::move(rightInner->keys, rightInner->keys + rightInner->numKeys, leftInner->keys + leftInner->numKeys + 1);
+        std::copy(rightInner->children, rightInner->children + rightInner->numKeys + 1, leftInner->children + leftInner->numKeys + 1);
+        leftInner->numKeys = static_cast<unsigned short>(leftInner->numKeys + rightInner->numKeys + 1);
+    }
+
+    //Remove the separator and the merged child from the parent
+    std::move(parent->keys + leftIndex + 1, parent->keys + parent->numKeys, parent->keys + leftIndex);
+    std::copy(parent->children + leftIndex + 2, parent->children + parent->numKeys + 1, parent->children + leftIndex + 1);
+    --parent->numKeys;
+
+    freeNode(right);
+}
+
+/// <summary>
+/// Inserts copies of a key and grows the tree by one level if the root splits.
+/// </summary>
+/// <param name="x"> The key being inserted. </param>
+/// <param name="copies"> The number of copies being inserted, at least 1. </param>
+/// <returns> False if the key was already present in a Duplicates::UNIQUE tree, otherwise true. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+bool B_Tree<keyType, duplicates, nodeBytes>::insertCopies(const keyType& x, const unsigned copies)
+{
+    //The first key starts a single leaf tree
+    if (root == nullptr)
+    {
+        head = tail = createLeaf();
+        root = head;
+        height = 0;
+    }
+
+    Split split{ keyType{}, nullptr };
+    const bool inserted{ insertInto(root, x, copies, split) };
+
+    if (split.right != nullptr)
+    {
+        Inner* const newRoot{ createInner() };
+        newRoot->keys[0] = std::move(split.separator);
+        newRoot->children[0] = root;
+        newRoot->children[1] = split.right;
+        newRoot->numKeys = 1;
+        root = newRoot;
+        ++height;
+    }
+
+    return inserted;
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Copies a subtree node for node. Leaves are linked to each other in the order they are created, which is key order.
+/// </summary>
+/// <param name="copyFrom"> The root of the subtree being copied. </param>
+/// <param name="lastLeaf"> The most recently copied leaf, nullptr before the first one. </param>
+/// <returns> A pointer to the root of the copy. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+typename B_Tree<keyType, duplicates, nodeBytes>::Node* B_Tree<keyType, duplicates, nodeBytes>::copySubtree(const Node* const copyFrom, Leaf*& lastLeaf)
+{
+    if (copyFrom->isLeaf)
+    {
+        const Leaf* const from{ static_cast<const Leaf*>(copyFrom) };
+        Leaf* const copyTo{ createLeaf() };
+
+        std::copy(from->keys, from->keys + from->numKeys, copyTo->keys);
+        if constexpr (COUNTED)
+        {
+            std::copy(from->counts, from->counts + from->numKeys, copyTo->counts);
+        }
+        copyTo->numKeys = from->numKeys;
+
+        copyTo->prev = lastLeaf;
+        if (lastLeaf != nullptr)
+        {
+            lastLeaf->next = copyTo;
+        }
+        else
+        {
+            head = copyTo;
+        }
+        lastLeaf = copyTo;
+
+        return copyTo;
+    }
+
+    const Inner* const from{ static_cast<const Inner*>(copyFrom) };
+    Inner* const copyTo{ createInner() };
+
+    std::copy(from->keys, from->keys + from->numKeys, copyTo->keys);
+    copyTo->numKeys = from->numKeys;
+    for (unsigned i{ 0 }; i <= from->numKeys; ++i)
+    {
+        copyTo->children[i] = copySubtree(from->children[i], lastLeaf);
+    }
+
+    return copyTo;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Frees every node of a subtree.
+/// </summary>
+/// <param name="node"> The root of the subtree being freed. </param>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+void B_Tree<keyType, duplicates, nodeBytes>::destroySubtree(Node* const node)
+{
+    if (!node->isLeaf)
+    {
+        Inner* const inner{ static_cast<Inner*>(node) };
+        for (unsigned i{ 0 }; i <= inner->numKeys; ++i)
+        {
+            destroySubtree(inner->children[i]);
+        }
+    }
+
+    freeNode(node);
+}
+
+//****************************************************
+//		Constructors and Destructor definitions
+//****************************************************
+/// <summary>
+/// Default constructor. The empty tree has no nodes.
+/// </summary>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+B_Tree<keyType, duplicates, nodeBytes>::B_Tree()
+    : root{ nullptr }, head{ nullptr }, tail{ nullptr }, numNodes{ 0 }, numDistinct{ 0 }, numKeys{ 0 }, height{ -1 }
+{
+}
+
+/// <summary>
+/// Copy constructor. The node structure of the tree is copied exactly.
+/// </summary>
+/// <param name="copy"> The tree being copied. </param>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+B_Tree<keyType, duplicates, nodeBytes>::B_Tree(const B_Tree& copy) : B_Tree{}
+{
+    *this = copy;
+}
+
+/// <summary>
+/// Move constructor. Takes the nodes of the other tree, leaving it empty. Nothing is allocated or visited.
+/// </summary>
+/// <param name="right"> The tree being moved from. </param>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+B_Tree<keyType, duplicates, nodeBytes>::B_Tree(B_Tree&& right) noexcept : B_Tree{}
+{
+    *this = std::move(right);
+}
+
+/// <summary>
+/// Destructor. Frees every node.
+/// </summary>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+B_Tree<keyType, duplicates, nodeBytes>::~B_Tree()
+{
+    destroyTree();
+}
+
+//***************************************************
+//		Public member function definitions
+//***************************************************
+/// <summary>
+/// Inserts a key into the tree. A key that is already present gains another copy, except in a
+/// Duplicates::UNIQUE tree where it is left alone.
+/// </summary>
+/// <param name="x"> The key being inserted. </param>
+/// <returns> False if the key was rejected as a duplicate, otherwise true. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+bool B_Tree<keyType, duplicates, nodeBytes>::insert(const keyType& x)
+{
+    return insertCopies(x, 1);
+}
+
+/// <summary>
+/// Attempts to remove one copy of a key from the tree. If the key is not present nothing happens.
+/// </summary>
+/// <param name="x"> The key being removed. </param>
+/// <returns> True if a copy of the key was removed, otherwise false. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+bool B_Tree<keyType, duplicates, nodeBytes>::remove(const keyType& x)
+{
+    if (root == nullptr || !removeFrom(root, x))
+    {
+        return false;
+    }
+
+    //An inner root left with a single child is replaced by it, an empty leaf root empties the tree
+    if (!root->isLeaf && root->numKeys == 0)
+    {
+        Node* const oldRoot{ root };
+        root = static_cast<Inner*>(oldRoot)->children[0];
+        freeNode(oldRoot);
+        --height;
+    }
+    else if (root->isLeaf && root->numKeys == 0)
+    {
+        freeNode(root);
+        root = nullptr;
+        head = tail = nullptr;
+        height = -1;
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Determines if the key value specified is in the tree.
+/// </summary>
+/// <param name="keyValue"> The key value that is searched for in the tree </param>
+/// <returns> True if the key value passed is in the tree, otherwise false </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+bool B_Tree<keyType, duplicates, nodeBytes>::containsKey(const keyType& keyValue) const
+{
+    return countKey(keyValue) != 0;
+}
+
+/// <summary>
+/// Counts the copies of a key stored in the tree.
+/// </summary>
+/// <param name="keyValue"> The key value being counted. </param>
+/// <returns> The number of times the key was inserted and not yet removed. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+unsigned B_Tree<keyType, duplicates, nodeBytes>::countKey(const keyType& keyValue) const
+{
+    const Leaf* const leaf{ findLeaf(keyValue) };
+
+    if (leaf == nullptr)
+    {
+        return 0;
+    }
+
+    const unsigned position{ lowerBound(leaf->keys, leaf->numKeys, keyValue) };
+
+    if (position == leaf->numKeys || keyValue < leaf->keys[position])
+    {
+        return 0;
+    }
+
+    return keyCount(leaf, position);
+}
+
+/// <summary>
+/// Checks to see if the tree is empty.
+/// </summary>
+/// <returns> True if the tree is empty, otherwise false </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+bool B_Tree<keyType, duplicates, nodeBytes>::isEmpty() const
+{
+    return root == nullptr;
+}
+
+/// <summary>
+/// Gets the number of leaves and inner nodes in the tree. Each node holds many keys.
+/// </summary>
+/// <returns> The total number of nodes in the tree. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+unsigned B_Tree<keyType, duplicates, nodeBytes>::getNumNodes() const
+{
+    return numNodes;
+}
+
+/// <summary>
+/// Gets the number of keys stored in the tree, counting every copy of a repeated key.
+/// </summary>
+/// <returns> The total number of keys in the tree. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+unsigned B_Tree<keyType, duplicates, nodeBytes>::getNumKeys() const
+{
+    return numKeys;
+}
+
+/// <summary>
+/// Gets the height of the tree. Every leaf is at the same depth, so this is the number of inner levels.
+/// </summary>
+/// <returns> The height of the tree as an int. -1 is returned if the tree is empty. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+int B_Tree<keyType, duplicates, nodeBytes>::getTreeHeight() const
+{
+    return height;
+}
+
+/// <summary>
+/// Displays statistics about the B-tree including total nodes, keys, height and how full the leaves are.
+/// </summary>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+void B_Tree<keyType, duplicates, nodeBytes>::statistics() const
+{
+    unsigned numLeaves{ 0 };
+    for (const Leaf* leaf{ head }; leaf != nullptr; leaf = leaf->next)
+    {
+        ++numLeaves;
+    }
+
+    std::cout << "B-Tree Statistics\n";
+    std::cout << "-------------------------\n";
+    std::cout << std::setw(25) << "Total Nodes: " << getNumNodes() << std::endl;
+    std::cout << std::setw(25) << "Total Keys: " << getNumKeys() << std::endl;
+    std::cout << std::setw(25) << "Tree Height: " << getTreeHeight() << std::endl;
+    std::cout << std::setw(25) << "Keys Per Leaf: " << LEAF_CAPACITY << std::endl;
+    std::cout << std::setw(25) << "Keys Per Inner Node: " << INNER_CAPACITY << std::endl;
+    std::cout << std::setw(25) << "Leaf Fill: "
+              << ((numLeaves == 0) ? 0 : (100 * numDistinct) / (numLeaves * LEAF_CAPACITY)) << "%" << std::endl;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Destroys the tree, freeing every node.
+/// </summary>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+void B_Tree<keyType, duplicates, nodeBytes>::destroyTree()
+{
+    if (root != nullptr)
+    {
+        destroySubtree(root);
+    }
+
+    root = nullptr;
+    head = tail = nullptr;
+    numDistinct = 0;
+    numKeys = 0;
+    height = -1;
+}
+
+/// <summary>
+/// Displays the keys of the tree in ascending or descending order, one copy per line. The leaves are linked in key
+/// order so no recursion is needed.
+/// </summary>
+/// <param name="ord"> Specifies the order in which the tree is displayed. </param>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+void B_Tree<keyType, duplicates, nodeBytes>::displayTree(const Order ord) const
+{
+    if (ord == Order::ASC)
+    {
+        for (const Leaf* leaf{ head }; leaf != nullptr; leaf = leaf->next)
+        {
+            for (unsigned i{ 0 }; i < leaf->numKeys; ++i)
+            {
+                for (unsigned copies{ keyCount(leaf, i) }; copies > 0; --copies)
+                {
+                    std::cout << leaf->keys[i] << std::endl;
+                }
+            }
+        }
+    }
+    else if (ord == Order::DES)
+    {
+        for (const Leaf* leaf{ tail }; leaf != nullptr; leaf = leaf->prev)
+        {
+            for (unsigned i{ leaf->numKeys }; i > 0; --i)
+            {
+                for (unsigned copies{ keyCount(leaf, i - 1) }; copies > 0; --copies)
+                {
+                    std::cout << leaf->keys[i - 1] << std::endl;
+                }
+            }
+        }
+    }
+    else
+    {
+        std::cout << "Order not within the enumerator class." << std::endl;
+    }
+}
+
+/// <summary>
+/// Returns an iterator to the smallest key, or end() if the tree is empty.
+/// </summary>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+typename B_Tree<keyType, duplicates, nodeBytes>::iterator B_Tree<keyType, duplicates, nodeBytes>::begin() const
+{
+    return iterator{ head, 0, this };
+}
+
+/// <summary>
+/// Returns the iterator one past the largest key.
+/// </summary>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+typename B_Tree<keyType, duplicates, nodeBytes>::iterator B_Tree<keyType, duplicates, nodeBytes>::end() const
+{
+    return iterator{ nullptr, 0, this };
+}
+
+/// <summary>
+/// Accesses the smallest key in the tree in constant time. Throws std::out_of_range if the tree is empty.
+/// </summary>
+/// <returns> A constant reference to the smallest key. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+const keyType& B_Tree<keyType, duplicates, nodeBytes>::getMin() const
+{
+    if (head == nullptr)
+    {
+        throw std::out_of_range{ "ERROR: The tree is empty." };
+    }
+
+    return head->keys[0];
+}
+
+/// <summary>
+/// Accesses the largest key in the tree in constant time. Throws std::out_of_range if the tree is empty.
+/// </summary>
+/// <returns> A constant reference to the largest key. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+const keyType& B_Tree<keyType, duplicates, nodeBytes>::getMax() const
+{
+    if (tail == nullptr)
+    {
+        throw std::out_of_range{ "ERROR: The tree is empty." };
+    }
+
+    return tail->keys[tail->numKeys - 1];
+}
+
+//***************************************************
+//		Iterator member function definitions
+//***************************************************
+/// <summary>
+/// Creates an iterator referring to a slot of a leaf.
+/// </summary>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+B_Tree<keyType, duplicates, nodeBytes>::iterator::iterator(const Leaf* const leaf, const unsigned index, const B_Tree* const tree)
+    : leaf{ leaf }, index{ index }, tree{ tree }
+{
+}
+
+/// <summary>
+/// Creates a singular iterator that does not refer to any tree.
+/// </summary>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+B_Tree<keyType, duplicates, nodeBytes>::iterator::iterator() : leaf{ nullptr }, index{ 0 }, tree{ nullptr }
+{
+}
+
+/// <summary>
+/// Accesses the key the iterator refers to.
+/// </summary>
+/// <returns> A constant reference to the key. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+typename B_Tree<keyType, duplicates, nodeBytes>::iterator::reference B_Tree<keyType, duplicates, nodeBytes>::iterator::operator*() const
+{
+    return leaf->keys[index];
+}
+
+/// <summary>
+/// Accesses a member of the key the iterator refers to.
+/// </summary>
+/// <returns> A pointer to the key. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+typename B_Tree<keyType, duplicates, nodeBytes>::iterator::pointer B_Tree<keyType, duplicates, nodeBytes>::iterator::operator->() const
+{
+    return &leaf->keys[index];
+}
+
+/// <summary>
+/// Advances to the next key in ascending order, moving to the next leaf after the last slot.
+/// </summary>
+/// <returns> A reference to this iterator after advancing. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+typename B_Tree<keyType, duplicates, nodeBytes>::iterator& B_Tree<keyType, duplicates, nodeBytes>::iterator::operator++()
+{
+    if (++index == leaf->numKeys)
+    {
+        leaf = leaf->next;
+        index = 0;
+    }
+    return *this;
+}
+
+/// <summary>
+/// Advances to the next key in ascending order.
+/// </summary>
+/// <returns> A copy of the iterator before advancing. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+typename B_Tree<keyType, duplicates, nodeBytes>::iterator B_Tree<keyType, duplicates, nodeBytes>::iterator::operator++(int)
+{
+    iterator before{ *this };
+    ++(*this);
+    return before;
+}
+
+/// <summary>
+/// Moves to the previous key in ascending order. Decrementing end() moves to the largest key.
+/// </summary>
+/// <returns> A reference to this iterator after moving. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+typename B_Tree<keyType, duplicates, nodeBytes>::iterator& B_Tree<keyType, duplicates, nodeBytes>::iterator::operator--()
+{
+    if (leaf == nullptr)
+    {
+        leaf = tree->tail;
+        index = leaf->numKeys;
+    }
+    else if (index == 0)
+    {
+        leaf = leaf->prev;
+        index = leaf->numKeys;
+    }
+    --index;
+    return *this;
+}
+
+/// <summary>
+/// Moves to the previous key in ascending order.
+/// </summary>
+/// <returns> A copy of the iterator before moving. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+typename B_Tree<keyType, duplicates, nodeBytes>::iterator B_Tree<keyType, duplicates, nodeBytes>::iterator::operator--(int)
+{
+    iterator before{ *this };
+    --(*this);
+    return before;
+}
+
+/// <summary>
+/// Two iterators are equal when they refer to the same slot.
+/// </summary>
+/// <param name="right"> The iterator being compared to this one. </param>
+/// <returns> True if both iterators refer to the same position. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+bool B_Tree<keyType, duplicates, nodeBytes>::iterator::operator==(const iterator& right) const
+{
+    return leaf == right.leaf && index == right.index;
+}
+
+/// <summary>
+/// Returns the NOT of operator==.
+/// </summary>
+/// <param name="right"> The iterator being compared to this one. </param>
+/// <returns> True if the iterators refer to different positions. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+bool B_Tree<keyType, duplicates, nodeBytes>::iterator::operator!=(const iterator& right) const
+{
+    return !(*this == right);
+}
+
+//************************************************
+//				Overloaded Operators
+//************************************************
+/// <summary>
+/// Assigns one tree to another. The exact node structure of the tree is copied.
+/// </summary>
+/// <param name="right"> The tree on the right hand side of an assignment statement. (leftTree = rightTree) </param>
+/// <returns> A reference to the tree that has been assigned to. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+B_Tree<keyType, duplicates, nodeBytes>& B_Tree<keyType, duplicates, nodeBytes>::operator=(const B_Tree<keyType, duplicates, nodeBytes>& right)
+{
+    //Check for self assignment
+    if (this != &right)
+    {
+        destroyTree();
+
+        if (right.root != nullptr)
+        {
+            Leaf* lastLeaf{ nullptr };
+            root = copySubtree(right.root, lastLeaf);
+            tail = lastLeaf;
+        }
+
+        numDistinct = right.numDistinct;
+        numKeys = right.numKeys;
+        height = right.height;
+    }
+
+    //Return a reference to the tree that was assigned to. Allows for cascading assignment.
+    return *this;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Move assigns one tree to another. The old nodes of this tree are freed and the nodes of the right tree are taken
+/// over, so the right tree is empty afterwards.
+/// </summary>
+/// <param name="right"> The tree being moved from. </param>
+/// <returns> A reference to the tree that has been assigned to. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+B_Tree<keyType, duplicates, nodeBytes>& B_Tree<keyType, duplicates, nodeBytes>::operator=(B_Tree<keyType, duplicates, nodeBytes>&& right) noexcept
+{
+    if (this != &right)
+    {
+        destroyTree();
+
+        root = std::exchange(right.root, nullptr);
+        head = std::exchange(right.head, nullptr);
+        tail = std::exchange(right.tail, nullptr);
+        numNodes = std::exchange(right.numNodes, 0);
+        numDistinct = std::exchange(right.numDistinct, 0);
+        numKeys = std::exchange(right.numKeys, 0);
+        height = std::exchange(right.height, -1);
+    }
+
+    return *this;
+}
+
+/// <summary>
+/// Adds THIS tree and the right tree parameter. The sum is the tree that results from starting with this tree and
+/// inserting every key of the right tree, with all of its copies, in ascending order.
+/// </summary>
+/// <param name="right"> The tree that is the right summand in an addition operation. </param>
+/// <returns> A copy of the sum of the two trees. This enables cascading. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+B_Tree<keyType, duplicates, nodeBytes> B_Tree<keyType, duplicates, nodeBytes>::operator+(const B_Tree<keyType, duplicates, nodeBytes>& right) const
+{
+    B_Tree<keyType, duplicates, nodeBytes> sumTree{ *this };
+
+    for (const Leaf* leaf{ right.head }; leaf != nullptr; leaf = leaf->next)
+    {
+        for (unsigned i{ 0 }; i < leaf->numKeys; ++i)
+        {
+            if constexpr (COUNTED)
+            {
+                sumTree.insertCopies(leaf->keys[i], leaf->counts[i]);
+            }
+            else
+            {
+                sumTree.insertCopies(leaf->keys[i], 1);
+            }
+        }
+    }
+
+    return sumTree;
+}
+
+/// <summary>
+/// Inserts every key of the right tree, with all of its copies, into THIS tree. Unlike THIS + right, no copy of THIS
+/// tree is made.
+/// </summary>
+/// <param name="right"> The tree on the right hand side of the += operator. </param>
+/// <returns> A reference to THIS tree after the keys have been inserted. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+B_Tree<keyType, duplicates, nodeBytes>& B_Tree<keyType, duplicates, nodeBytes>::operator+=(const B_Tree<keyType, duplicates, nodeBytes>& right)
+{
+    //The leaves of a tree added to itself would split under the loop, so its keys are read from a copy
+    if (this == &right)
+    {
+        const B_Tree<keyType, duplicates, nodeBytes> copy{ right };
+        return *this += copy;
+    }
+
+    for (const Leaf* leaf{ right.head }; leaf != nullptr; leaf = leaf->next)
+    {
+        for (unsigned i{ 0 }; i < leaf->numKeys; ++i)
+        {
+            if constexpr (COUNTED)
+            {
+                insertCopies(leaf->keys[i], leaf->counts[i]);
+            }
+            else
+            {
+                insertCopies(leaf->keys[i], 1);
+            }
+        }
+    }
+
+    return *this;
+}
+
+/// <summary>
+/// Compares two trees to determine if they are equal. Unlike RB_Tree, equality is defined as holding the same keys
+/// with the same number of copies. The node layout depends on the order of past updates and is not compared.
+/// </summary>
+/// <param name="right"> The tree on the right of the equality operation being compared to THIS tree. </param>
+/// <returns> True if the trees hold the same keys, otherwise false. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+bool B_Tree<keyType, duplicates, nodeBytes>::operator==(const B_Tree& right) const
+{
+    if (this == &right)
+    {
+        return true;
+    }
+    if (numKeys != right.numKeys || numDistinct != right.numDistinct)
+    {
+        return false;
+    }
+
+    //Walk both leaf lists in step
+    const Leaf* rightLeaf{ right.head };
+    unsigned rightIndex{ 0 };
+
+    for (const Leaf* leaf{ head }; leaf != nullptr; leaf = leaf->next)
+    {
+        for (unsigned i{ 0 }; i < leaf->numKeys; ++i)
+        {
+            if (leaf->keys[i] != rightLeaf->keys[rightIndex] || keyCount(leaf, i) != keyCount(rightLeaf, rightIndex))
+            {
+                return false;
+            }
+
+            if (++rightIndex == rightLeaf->numKeys)
+            {
+                rightLeaf = rightLeaf->next;
+                rightIndex = 0;
+            }
+        }
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Compares two trees to determine if they are not equal. Returns the NOT of the operator== function.
+/// </summary>
+/// <param name="right"> Tree on the right hand side of the not equal operator. </param>
+/// <returns> True if the trees are not equal, otherwise false. </returns>
+template<typename keyType, Duplicates duplicates, unsigned nodeBytes>
+bool B_Tree<keyType, duplicates, nodeBytes>::operator!=(const B_Tree& right) const
+{
+    return !(*this == right);
+}
@@ -0,0 +1,1212 @@
+//*****************************************************************************
+//  RB_Benchmark.cpp
+//
+//  Benchmark suite comparing RB_Tree and B_Tree against std::set and
+//  std::multiset.
+//
+//  Build:  g++ -O2 -std=c++17 -pthread RB_Benchmark.cpp -o RB_Benchmark
+//          Add -msse4.2 (or -march=native) to scan 64 bit B_Tree keys with SSE.
+//          Add -DRB_TREE_COUNTERS=1 to report rotations per operation.
+//          Add -DRB_TREE_CONCURRENT_READS=1 to enable --readers.
+//
+//  Usage:  RB_Benchmark [--sizes=1000,10000,...] [--max-size=N]
+//                       [--keys=int,u64,str64] [--workloads=random,sorted,...,churn]
+//                       [--containers=rb,rb-counted,rb-unique,rb-bloom,rb-finger,rb-index,avl,wavl,btree,set,multiset]
+//                       [--format=table|csv] [--scaling=1,2,4,8]
+//                       [--readers=1,2,4,8]
+//
+//  Every (container, key type, workload, size) combination runs the phases of
+//  the workload and reports ops/sec, sampled p50/p99 latency and the number of
+//  heap bytes held per key. Tree containers also report their height after
+//  each phase and, when counters are compiled in, rotations per operation.
+//  The churn workload measures in-order scans and lookups on a churned tree
+//  before and after RB_Tree::defragment, in the in-order and vEB layouts.
+//  The misses workload is the random workload with 90% of the lookups for
+//  absent keys. Compare rb with rb-bloom, an RB_Tree with its membership
+//  filter enabled, whose bytes per key include the filter.
+//  The local workload is the random workload with lookups that walk the key
+//  space in steps of at most 8. Compare rb with rb-finger, an RB_Tree in
+//  finger search mode. rb-index is an RB_Tree with its hash index enabled,
+//  whose bytes per key include the index.
+//  --scaling runs only the write scaling benchmark instead: for every size and
+//  thread count, n u64 keys are inserted by that many threads, each into its
+//  own key range, into ShardedRBTree and into one RB_Tree behind a mutex.
+//  --readers runs only the read scaling benchmark: that many threads look up
+//  n keys each while one writer inserts and removes other keys, against
+//  concurrentContainsKey and against an RB_Tree behind a shared_mutex.
+//  --format=csv prints one row per phase with a
+//  stable column layout so results can be diffed and tracked across releases.
+//*****************************************************************************
+#include "RB_Tree.h"
+#include "B_Tree.h"
+#include "ShardedRBTree.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <random>
+#include <set>
+#include <shared_mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+//*****************************************
+//		Heap accounting
+//*****************************************
+//Every allocation made by the process goes through these operators. Live bytes are only tracked while
+//trackAllocations is set so the bookkeeping does not disturb the timed phases.
+namespace
+{
+	std::atomic<bool> trackAllocations{ false };
+	std::atomic<long long> liveBytes{ 0 };
+
+	//Size header placed in front of every block so operator delete knows how much to subtract
+	constexpr std::size_t allocationHeader{ alignof(std::max_align_t) };
+}
+
+void* operator new(std::size_t size)
+{
+	void* block{ std::malloc(size + allocationHeader) };
+	if (block == nullptr)
+	{
+		throw std::bad_alloc{};
+	}
+
+	*static_cast<std::size_t*>(block) = size;
+	if (trackAllocations.load(std::memory_order_relaxed))
+	{
+		liveBytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+	}
+
+	return static_cast<char*>(block) + allocationHeader;
+}
+
+void operator delete(void* ptr) noexcept
+{
+	if (ptr == nullptr)
+	{
+		return;
+	}
+
+	void* block{ static_cast<char*>(ptr) - allocationHeader };
+	if (trackAllocations.load(std::memory_order_relaxed))
+	{
+		liveBytes.fetch_sub(static_cast<long long>(*static_cast<std::size_t*>(block)), std::memory_order_relaxed);
+	}
+
+	std::free(block);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+	operator delete(ptr);
+}
+
+//Over-aligned types, such as the blocks of RB_Tree's membership filter. The header is one alignment unit, so the
+//block handed out keeps the alignment.
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	const std::size_t align{ static_cast<std::size_t>(alignment) };
+	const std::size_t header{ std::max(align, allocationHeader) };
+	void* block{ std::aligned_alloc(header, (size + 2 * header - 1) / header * header) };
+	if (block == nullptr)
+	{
+		throw std::bad_alloc{};
+	}
+
+	*static_cast<std::size_t*>(block) = size;
+	if (trackAllocations.load(std::memory_order_relaxed))
+	{
+		liveBytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+	}
+
+	return static_cast<char*>(block) + header;
+}
+
+void operator delete(void* ptr, std::align_val_t alignment) noexcept
+{
+	if (ptr == nullptr)
+	{
+		return;
+	}
+
+	void* block{ static_cast<char*>(ptr) - std::max(static_cast<std::size_t>(alignment), allocationHeader) };
+	if (trackAllocations.load(std::memory_order_relaxed))
+	{
+		liveBytes.fetch_sub(static_cast<long long>(*static_cast<std::size_t*>(block)), std::memory_order_relaxed);
+	}
+
+	std::free(block);
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept
+{
+	operator delete(ptr, alignment);
+}
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	//***************************************
+	//			Key generation
+	//***************************************
+	//Maps a 64-bit id onto each benchmarked key type. The mapping is monotonic so sorted ids produce sorted keys.
+	template<typename keyType>
+	struct KeyMaker;
+
+	template<>
+	struct KeyMaker<int>
+	{
+		static const char* name() { return "int"; }
+		static int make(std::uint64_t id) { return static_cast<int>(id); }
+	};
+
+	template<>
+	struct KeyMaker<std::uint64_t>
+	{
+		static const char* name() { return "u64"; }
+		static std::uint64_t make(std::uint64_t id) { return id * 0x9E3779B1ull; }
+	};
+
+	//64 byte string keys: the id zero padded to 64 characters, which defeats the small string optimization
+	template<>
+	struct KeyMaker<std::string>
+	{
+		static const char* name() { return "str64"; }
+		static std::string make(std::uint64_t id)
+		{
+			std::string digits{ std::to_string(id) };
+			return std::string(64 - digits.size(), '0') + digits;
+		}
+	};
+
+	/// <summary>
+	/// Zipf distributed ranks in [0, n) using the generator from Gray et al. ("Quickly generating billion-record
+	/// synthetic databases"). Rank 0 is the most popular. Setup is O(n), sampling is O(1).
+	/// </summary>
+	class ZipfGenerator
+	{
+	private:
+		std::uint64_t n;
+		double theta;
+		double alpha;
+		double zetan;
+		double eta;
+		std::uniform_real_distribution<double> uniform{ 0.0, 1.0 };
+
+	public:
+		ZipfGenerator(std::uint64_t items, double skew) : n{ items }, theta{ skew }
+		{
+			zetan = 0.0;
+			for (std::uint64_t i{ 1 }; i <= n; ++i)
+			{
+				zetan += 1.0 / std::pow(static_cast<double>(i), theta);
+			}
+
+			const double zeta2{ 1.0 + 1.0 / std::pow(2.0, theta) };
+			alpha = 1.0 / (1.0 - theta);
+			eta = (1.0 - std::pow(2.0 / static_cast<double>(n), 1.0 - theta)) / (1.0 - zeta2 / zetan);
+		}
+
+		template<typename Engine>
+		std::uint64_t operator()(Engine& engine)
+		{
+			const double u{ uniform(engine) };
+			const double uz{ u * zetan };
+
+			if (uz < 1.0)
+			{
+				return 0;
+			}
+			if (uz < 1.0 + std::pow(0.5, theta))
+			{
+				return 1;
+			}
+
+			const std::uint64_t rank{ static_cast<std::uint64_t>(static_cast<double>(n) * std::pow(eta * u - eta + 1.0, alpha)) };
+			return (rank < n) ? rank : n - 1;
+		}
+	};
+
+	//Scatters Zipf ranks across the key space so the hot keys are not all adjacent. 2654435761 is prime, so
+	//multiplication by it is a bijection modulo any n it does not divide.
+	std::uint64_t scatter(std::uint64_t rank, std::uint64_t n)
+	{
+		return (rank * 2654435761ull) % n;
+	}
+
+	//***************************************
+	//			Container adapters
+	//***************************************
+	//Uniform interface over the containers being compared
+	template<typename keyType, Duplicates duplicates = Duplicates::MULTI_NODE, Balance balance = Balance::RED_BLACK>
+	struct RBTreeAdapter
+	{
+		RB_Tree<keyType, duplicates, balance> tree;
+
+		static const char* name()
+		{
+			switch (balance)
+			{
+			case Balance::AVL:  return "avl";
+			case Balance::WAVL: return "wavl";
+			default:            break;
+			}
+
+			switch (duplicates)
+			{
+			case Duplicates::COUNTED: return "rb-counted";
+			case Duplicates::UNIQUE:  return "rb-unique";
+			default:                  return "rb";
+			}
+		}
+
+		void insert(const keyType& key) { tree.insert(key); }
+		bool find(const keyType& key) const { return tree.containsKey(key); }
+		bool erase(const keyType& key) { return tree.remove(key); }
+		std::size_t size() const { return tree.getNumKeys(); }
+		int height() const { return tree.getTreeHeight(); }
+		static constexpr bool defragments{ true };
+		void defragment(const Layout layout) { tree.defragment(layout); }
+
+		std::uint64_t rotations() const
+		{
+			const OperationCounters counters{ tree.getCounters() };
+			return counters.leftRotations + counters.rightRotations;
+		}
+	};
+
+	//RB_Tree with the membership filter in front of its lookups
+	template<typename keyType>
+	struct BloomTreeAdapter : RBTreeAdapter<keyType>
+	{
+		BloomTreeAdapter() { this->tree.setMembershipFilter(true); }
+		static const char* name() { return "rb-bloom"; }
+	};
+
+	//RB_Tree whose lookups start from the previous one
+	template<typename keyType>
+	struct FingerTreeAdapter : RBTreeAdapter<keyType>
+	{
+		FingerTreeAdapter() { this->tree.setFingerSearch(true); }
+		static const char* name() { return "rb-finger"; }
+	};
+
+	//RB_Tree whose exact lookups go through its hash index
+	template<typename keyType>
+	struct IndexedTreeAdapter : RBTreeAdapter<keyType>
+	{
+		IndexedTreeAdapter() { this->tree.setHashIndex(true); }
+		static const char* name() { return "rb-index"; }
+	};
+
+	template<typename keyType>
+	struct BTreeAdapter
+	{
+		B_Tree<keyType> tree;
+
+		static const char* name() { return "btree"; }
+		void insert(const keyType& key) { tree.insert(key); }
+		bool find(const keyType& key) const { return tree.containsKey(key); }
+		bool erase(const keyType& key) { return tree.remove(key); }
+		std::size_t size() const { return tree.getNumKeys(); }
+		int height() const { return tree.getTreeHeight(); }
+		static constexpr bool defragments{ false };
+		void defragment(const Layout) {}
+		std::uint64_t rotations() const { return 0; }
+	};
+
+	template<typename keyType>
+	struct SetAdapter
+	{
+		std::set<keyType> tree;
+
+		static const char* name() { return "set"; }
+		void insert(const keyType& key) { tree.insert(key); }
+		bool find(const keyType& key) const { return tree.find(key) != tree.end(); }
+		bool erase(const keyType& key) { return tree.erase(key) != 0; }
+		std::size_t size() const { return tree.size(); }
+		int height() const { return -1; }
+		static constexpr bool defragments{ false };
+		void defragment(const Layout) {}
+		std::uint64_t rotations() const { return 0; }
+	};
+
+	template<typename keyType>
+	struct MultisetAdapter
+	{
+		std::multiset<keyType> tree;
+
+		static const char* name() { return "multiset"; }
+		void insert(const keyType& key) { tree.insert(key); }
+		bool find(const keyType& key) const { return tree.find(key) != tree.end(); }
+
+		//Removes a single instance to match RB_Tree::remove
+		bool erase(const keyType& key)
+		{
+			auto position{ tree.find(key) };
+			if (position == tree.end())
+			{
+				return false;
+			}
+			tree.erase(position);
+			return true;
+		}
+
+		std::size_t size() const { return tree.size(); }
+		int height() const { return -1; }
+		static constexpr bool defragments{ false };
+		void defragment(const Layout) {}
+		std::uint64_t rotations() const { return 0; }
+	};
+
+	//***************************************
+	//			Measurement
+	//***************************************
+	//One row of output
+	struct Result
+	{
+		std::string container;
+		std::string keyType;
+		std::string workload;
+		std::string phase;
+		std::uint64_t size;
+		std::uint64_t ops;
+		double seconds;
+		double p50ns;
+		double p99ns;
+		double bytesPerKey;
+		std::uint64_t hits;
+		int height;                 //Tree height after the phase, -1 when the container does not expose it
+		double rotationsPerOp;      //0 unless the tree was built with RB_TREE_COUNTERS
+	};
+
+	//Every sampleStride-th operation is timed individually. Timing every operation would make the clock the
+	//dominant cost for small keys, so the latency figures include the overhead of one clock read pair.
+	constexpr std::uint64_t sampleStride{ 32 };
+
+	/// <summary>
+	/// Runs op(i) for every i in [0, count), measuring total time and sampling per operation latency.
+	/// </summary>
+	template<typename Operation>
+	void measure(Result& result, std::uint64_t count, Operation op)
+	{
+		std::vector<double> samples;
+		samples.reserve(static_cast<std::size_t>(count / sampleStride + 1));
+
+		std::uint64_t hits{ 0 };
+		const Clock::time_point start{ Clock::now() };
+
+		for (std::uint64_t i{ 0 }; i < count; ++i)
+		{
+			if (i % sampleStride == 0)
+			{
+				const Clock::time_point before{ Clock::now() };
+				hits += op(i) ? 1 : 0;
+				const Clock::time_point after{ Clock::now() };
+				samples.push_back(std::chrono::duration<double, std::nano>(after - before).count());
+			}
+			else
+			{
+				hits += op(i) ? 1 : 0;
+			}
+		}
+
+		result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+		result.ops = count;
+		result.hits = hits;
+
+		if (!samples.empty())
+		{
+			const std::size_t p50{ samples.size() / 2 };
+			const std::size_t p99{ std::min(samples.size() - 1, samples.size() * 99 / 100) };
+
+			std::nth_element(samples.begin(), samples.begin() + p50, samples.end());
+			result.p50ns = samples[p50];
+			std::nth_element(samples.begin(), samples.begin() + p99, samples.end());
+			result.p99ns = samples[p99];
+		}
+	}
+
+	/// <summary>
+	/// Records the shape of the container after a phase: its height and the rotations performed per operation
+	/// since rotationsBefore was read.
+	/// </summary>
+	template<typename Adapter>
+	void recordShape(Result& result, const Adapter& container, const std::uint64_t rotationsBefore)
+	{
+		result.height = container.height();
+		result.rotationsPerOp = (result.ops == 0) ? 0.0 :
+			static_cast<double>(container.rotations() - rotationsBefore) / static_cast<double>(result.ops);
+	}
+
+	//Identifies the order in which keys are presented to the container
+	enum class Workload { RANDOM, SORTED, REVERSE, ZIPF, MIXED, CHURN, MISSES, LOCAL };
+
+	const char* workloadName(const Workload workload)
+	{
+		switch (workload)
+		{
+		case Workload::RANDOM:  return "random";
+		case Workload::SORTED:  return "sorted";
+		case Workload::REVERSE: return "reverse";
+		case Workload::ZIPF:    return "zipf";
+		case Workload::CHURN:   return "churn";
+		case Workload::MISSES:  return "misses";
+		case Workload::LOCAL:   return "local";
+		default:                return "mixed";
+		}
+	}
+
+	/// <summary>
+	/// Produces the sequence of ids inserted by a workload. Uniform workloads insert each of the ids [0, n) once,
+	/// the Zipf workload draws n ids with repetition so popular keys are inserted many times. The misses workload
+	/// inserts every tenth id of [0, 10n), so the absent keys it looks up fall between present ones.
+	/// </summary>
+	std::vector<std::uint64_t> insertionIds(const Workload workload, const std::uint64_t n, std::mt19937_64& engine)
+	{
+		std::vector<std::uint64_t> ids(static_cast<std::size_t>(n));
+
+		if (workload == Workload::ZIPF)
+		{
+			ZipfGenerator zipf{ n, 0.99 };
+			for (std::uint64_t& id : ids)
+			{
+				id = scatter(zipf(engine), n);
+			}
+			return ids;
+		}
+
+		const std::uint64_t spacing{ (workload == Workload::MISSES) ? 10u : 1u };
+		for (std::uint64_t i{ 0 }; i < n; ++i)
+		{
+			ids[static_cast<std::size_t>(i)] = i * spacing;
+		}
+
+		if (workload == Workload::REVERSE)
+		{
+			std::reverse(ids.begin(), ids.end());
+		}
+		else if (workload != Workload::SORTED)
+		{
+			std::shuffle(ids.begin(), ids.end(), engine);
+		}
+
+		return ids;
+	}
+
+	template<typename keyType>
+	std::vector<keyType> makeKeys(const std::vector<std::uint64_t>& ids)
+	{
+		std::vector<keyType> keys;
+		keys.reserve(ids.size());
+		for (const std::uint64_t id : ids)
+		{
+			keys.push_back(KeyMaker<keyType>::make(id));
+		}
+		return keys;
+	}
+
+	/// <summary>
+	/// Measures a full in-order scan, one key per operation, and n lookups, then appends a row for each.
+	/// </summary>
+	template<typename Adapter, typename keyType>
+	void measureScanAndLookup(Adapter& container, const std::vector<keyType>& probes, const std::string& suffix,
+							  Result& row, std::vector<Result>& results)
+	{
+		const std::uint64_t n{ static_cast<std::uint64_t>(probes.size()) };
+
+		//Every scanned key is compared with a probe, so the keys are read and the scan cannot be optimized away
+		row.phase = "scan" + suffix;
+		auto position{ container.tree.begin() };
+		measure(row, n, [&](std::uint64_t i)
+		{
+			if (position == container.tree.end())
+			{
+				position = container.tree.begin();
+			}
+			const bool below{ *position < probes[static_cast<std::size_t>(i)] };
+			++position;
+			return below;
+		});
+		recordShape(row, container, container.rotations());
+		results.push_back(row);
+
+		row.phase = "lookup" + suffix;
+		measure(row, n, [&](std::uint64_t i)
+		{
+			return container.find(probes[static_cast<std::size_t>(i)]);
+		});
+		recordShape(row, container, container.rotations());
+		results.push_back(row);
+	}
+
+	/// <summary>
+	/// Runs the churn workload. The container is built in random order and then churned: n times a random key is
+	/// removed and a new one inserted, so node addresses end up unrelated to key order. Scans and lookups are
+	/// measured before and after defragmenting into the in-order layout and then the vEB layout. Containers without
+	/// defragment repeat the same measurements as a baseline.
+	/// </summary>
+	template<typename Adapter, typename keyType>
+	void runChurn(Adapter& container, const std::vector<keyType>& inserted, const std::vector<keyType>& probes,
+				  std::mt19937_64& engine, Result& row, std::vector<Result>& results)
+	{
+		const std::uint64_t n{ static_cast<std::uint64_t>(inserted.size()) };
+
+		for (const keyType& key : inserted)
+		{
+			container.insert(key);
+		}
+
+		//Fresh keys come from the upper half of the id space, which the build did not use
+		std::vector<std::uint64_t> freshIds(static_cast<std::size_t>(n));
+		for (std::uint64_t i{ 0 }; i < n; ++i)
+		{
+			freshIds[static_cast<std::size_t>(i)] = n + i;
+		}
+		const std::vector<keyType> fresh{ makeKeys<keyType>(freshIds) };
+
+		std::vector<keyType> live{ inserted };
+		std::vector<std::size_t> victims(static_cast<std::size_t>(n));
+		for (std::size_t& victim : victims)
+		{
+			victim = static_cast<std::size_t>(engine() % n);
+		}
+
+		row.phase = "churn";
+		std::uint64_t rotationsBefore{ container.rotations() };
+		measure(row, n, [&](std::uint64_t i)
+		{
+			keyType& victim{ live[victims[static_cast<std::size_t>(i)]] };
+			const bool removed{ container.erase(victim) };
+			victim = fresh[static_cast<std::size_t>(i)];
+			container.insert(victim);
+			return removed;
+		});
+		recordShape(row, container, rotationsBefore);
+		results.push_back(row);
+
+		measureScanAndLookup(container, probes, "-pre", row, results);
+
+		const Layout layouts[]{ Layout::IN_ORDER, Layout::VEB };
+		const char* const suffixes[]{ "-in", "-veb" };
+
+		for (std::size_t i{ 0 }; i < 2; ++i)
+		{
+			//One timed call; ops is set to the number of keys afterwards so the rate reads as keys per second
+			row.phase = std::string{ "defrag" } + suffixes[i];
+			measure(row, 1, [&](std::uint64_t)
+			{
+				container.defragment(layouts[i]);
+				return true;
+			});
+			row.ops = container.size();
+			recordShape(row, container, container.rotations());
+			if (Adapter::defragments)
+			{
+				results.push_back(row);
+			}
+
+			measureScanAndLookup(container, probes, suffixes[i], row, results);
+		}
+	}
+
+	/// <summary>
+	/// Runs one workload against one container type and appends a result row per phase.
+	/// Insert/lookup/remove workloads build the container in workload order, perform n lookups of which about half
+	/// hit (a tenth for the misses workload), then remove every inserted key in random order. The mixed workload preloads n keys and then performs
+	/// n operations: 60% lookups, 20% inserts and 20% removes over a key space of 2n.
+	/// </summary>
+	template<typename Adapter, typename keyType>
+	void runWorkload(const Workload workload, const std::uint64_t n, std::vector<Result>& results)
+	{
+		std::mt19937_64 engine{ 0x5EED + n };
+		Result row{ Adapter::name(), KeyMaker<keyType>::name(), workloadName(workload), "", n, 0, 0.0, 0.0, 0.0, 0.0, 0, -1, 0.0 };
+
+		//Generate all keys before any timing starts
+		const std::vector<keyType> inserted{ makeKeys<keyType>(insertionIds(workload, n, engine)) };
+
+		//Lookups follow the insertion skew for the Zipf workload and are uniform over twice the key space otherwise.
+		//The misses workload draws them from ten times the key space, so nine in ten are absent. The local workload
+		//walks twice the key space in random steps of at most 8, so each lookup lands near the previous one.
+		std::vector<std::uint64_t> probeIds(static_cast<std::size_t>(n));
+		if (workload == Workload::ZIPF)
+		{
+			probeIds = insertionIds(workload, n, engine);
+		}
+		else if (workload == Workload::MISSES)
+		{
+			for (std::uint64_t& id : probeIds)
+			{
+				id = engine() % (10 * n);
+			}
+		}
+		else if (workload == Workload::LOCAL)
+		{
+			std::uint64_t id{ engine() % (2 * n) };
+			for (std::uint64_t& probeId : probeIds)
+			{
+				id = (id + 2 * n + engine() % 17 - 8) % (2 * n);
+				probeId = id;
+			}
+		}
+		else
+		{
+			for (std::uint64_t& id : probeIds)
+			{
+				id = engine() % (2 * n);
+			}
+		}
+		const std::vector<keyType> probes{ makeKeys<keyType>(probeIds) };
+
+		Adapter container;
+
+		if (workload == Workload::CHURN)
+		{
+			runChurn(container, inserted, probes, engine, row, results);
+			return;
+		}
+
+		if (workload == Workload::MIXED)
+		{
+			for (const keyType& key : inserted)
+			{
+				container.insert(key);
+			}
+
+			std::vector<unsigned char> kinds(static_cast<std::size_t>(n));
+			for (unsigned char& kind : kinds)
+			{
+				kind = static_cast<unsigned char>(engine() % 10);
+			}
+
+			row.phase = "mixed";
+			const std::uint64_t rotationsBefore{ container.rotations() };
+			measure(row, n, [&](std::uint64_t i)
+			{
+				const keyType& key{ probes[static_cast<std::size_t>(i)] };
+				const unsigned char kind{ kinds[static_cast<std::size_t>(i)] };
+
+				if (kind < 6)
+				{
+					return container.find(key);
+				}
+				if (kind < 8)
+				{
+					container.insert(key);
+					return true;
+				}
+				return container.erase(key);
+			});
+			recordShape(row, container, rotationsBefore);
+			results.push_back(row);
+			return;
+		}
+
+		//Insert phase. Heap accounting brackets the build so bytes per key covers nodes and key owned storage.
+		liveBytes.store(0);
+		trackAllocations.store(true);
+
+		row.phase = "insert";
+		std::uint64_t rotationsBefore{ container.rotations() };
+		measure(row, n, [&](std::uint64_t i)
+		{
+			container.insert(inserted[static_cast<std::size_t>(i)]);
+			return true;
+		});
+
+		trackAllocations.store(false);
+		recordShape(row, container, rotationsBefore);
+		row.bytesPerKey = (container.size() == 0) ? 0.0 : static_cast<double>(liveBytes.load()) / static_cast<double>(container.size());
+		results.push_back(row);
+		row.bytesPerKey = 0.0;
+
+		//Lookup phase
+		row.phase = "lookup";
+		rotationsBefore = container.rotations();
+		measure(row, n, [&](std::uint64_t i)
+		{
+			return container.find(probes[static_cast<std::size_t>(i)]);
+		});
+		recordShape(row, container, rotationsBefore);
+		results.push_back(row);
+
+		//Remove phase, in an order unrelated to the insertion order
+		std::vector<std::size_t> removalOrder(inserted.size());
+		for (std::size_t i{ 0 }; i < removalOrder.size(); ++i)
+		{
+			removalOrder[i] = i;
+		}
+		std::shuffle(removalOrder.begin(), removalOrder.end(), engine);
+
+		row.phase = "remove";
+		rotationsBefore = container.rotations();
+		measure(row, n, [&](std::uint64_t i)
+		{
+			return container.erase(inserted[removalOrder[static_cast<std::size_t>(i)]]);
+		});
+		recordShape(row, container, rotationsBefore);
+		results.push_back(row);
+	}
+
+	//***************************************
+	//			Write scaling
+	//***************************************
+	//One RB_Tree behind a single mutex, the baseline ShardedRBTree is compared with
+	struct LockedTreeAdapter
+	{
+		RB_Tree<std::uint64_t> tree;
+		std::mutex lock;
+
+		static const char* name() { return "rb-locked"; }
+
+		void insert(const std::uint64_t key)
+		{
+			std::lock_guard<std::mutex> guard{ lock };
+			tree.insert(key);
+		}
+	};
+
+	struct ShardedAdapter
+	{
+		ShardedRBTree<std::uint64_t> tree;
+
+		static const char* name() { return "sharded"; }
+		void insert(const std::uint64_t key) { tree.insert(key); }
+	};
+
+	/// <summary>
+	/// Inserts n keys from the given number of threads and appends one row. Thread t inserts the keys of ids
+	/// [t * n / threads, (t + 1) * n / threads) in random order, so the threads write to disjoint key ranges.
+	/// The threads wait for a common start signal, and the time runs from that signal until the last one finishes.
+	/// </summary>
+	template<typename Adapter>
+	void runScaling(const std::uint64_t n, const unsigned threads, std::vector<Result>& results)
+	{
+		std::mt19937_64 engine{ 0x5EED + n };
+		std::vector<std::vector<std::uint64_t>> keys(threads);
+
+		for (unsigned t{ 0 }; t < threads; ++t)
+		{
+			for (std::uint64_t id{ t * n / threads }; id < (t + 1) * n / threads; ++id)
+			{
+				keys[t].push_back(KeyMaker<std::uint64_t>::make(id));
+			}
+			std::shuffle(keys[t].begin(), keys[t].end(), engine);
+		}
+
+		Adapter container;
+		std::atomic<bool> start{ false };
+		std::vector<std::thread> writers;
+
+		for (unsigned t{ 0 }; t < threads; ++t)
+		{
+			writers.emplace_back([&container, &start, &keys, t]()
+			{
+				while (!start.load(std::memory_order_acquire))
+				{
+					std::this_thread::yield();
+				}
+				for (const std::uint64_t key : keys[t])
+				{
+					container.insert(key);
+				}
+			});
+		}
+
+		const Clock::time_point begin{ Clock::now() };
+		start.store(true, std::memory_order_release);
+		for (std::thread& writer : writers)
+		{
+			writer.join();
+		}
+
+		Result row{ Adapter::name(), KeyMaker<std::uint64_t>::name(), "scaling", "insert-" + std::to_string(threads) + "t",
+					n, n, std::chrono::duration<double>(Clock::now() - begin).count(), 0.0, 0.0, 0.0, n, -1, 0.0 };
+		results.push_back(row);
+	}
+
+#if RB_TREE_CONCURRENT_READS
+	//***************************************
+	//			Read scaling
+	//***************************************
+	//Readers share a reader-writer lock with the writer, the baseline for concurrentContainsKey
+	struct SharedLockAdapter
+	{
+		RB_Tree<std::uint64_t> tree;
+		std::shared_mutex lock;
+
+		static const char* name() { return "rb-rwlock"; }
+
+		bool find(const std::uint64_t key)
+		{
+			std::shared_lock<std::shared_mutex> guard{ lock };
+			return tree.containsKey(key);
+		}
+		void insert(const std::uint64_t key)
+		{
+			std::unique_lock<std::shared_mutex> guard{ lock };
+			tree.insert(key);
+		}
+		void erase(const std::uint64_t key)
+		{
+			std::unique_lock<std::shared_mutex> guard{ lock };
+			tree.remove(key);
+		}
+	};
+
+	struct EpochReadAdapter
+	{
+		RB_Tree<std::uint64_t> tree;
+
+		static const char* name() { return "rb-epoch"; }
+
+		bool find(const std::uint64_t key) { return tree.concurrentContainsKey(key); }
+		void insert(const std::uint64_t key) { tree.insert(key); }
+		void erase(const std::uint64_t key) { tree.remove(key); }
+	};
+
+	/// <summary>
+	/// Looks up n keys from each of the given number of reader threads while one writer thread keeps inserting and
+	/// removing keys, and appends one row. The tree starts with the keys of the even ids in [0, 2n), the readers look
+	/// those up in random order and the writer churns the keys of the odd ids until the last reader finishes.
+	/// </summary>
+	template<typename Adapter>
+	void runReaders(const std::uint64_t n, const unsigned readers, std::vector<Result>& results)
+	{
+		std::mt19937_64 engine{ 0x5EED + n };
+		std::vector<std::uint64_t> probes;
+
+		Adapter container;
+		for (std::uint64_t id{ 0 }; id < 2 * n; id += 2)
+		{
+			probes.push_back(KeyMaker<std::uint64_t>::make(id));
+			container.insert(probes.back());
+		}
+		std::shuffle(probes.begin(), probes.end(), engine);
+
+		std::atomic<bool> start{ false };
+		std::atomic<bool> stop{ false };
+		std::atomic<std::uint64_t> hits{ 0 };
+		std::vector<std::thread> threads;
+
+		for (unsigned t{ 0 }; t < readers; ++t)
+		{
+			threads.emplace_back([&container, &start, &hits, &probes, t]()
+			{
+				while (!start.load(std::memory_order_acquire))
+				{
+					std::this_thread::yield();
+				}
+				std::uint64_t found{ 0 };
+				for (std::size_t i{ 0 }; i < probes.size(); ++i)
+				{
+					found += container.find(probes[(i + t * probes.size() / 8) % probes.size()]);
+				}
+				hits.fetch_add(found);
+			});
+		}
+
+		std::thread writer{ [&container, &start, &stop, &engine, n]()
+		{
+			while (!start.load(std::memory_order_acquire))
+			{
+				std::this_thread::yield();
+			}
+			while (!stop.load(std::memory_order_acquire))
+			{
+				const std::uint64_t key{ KeyMaker<std::uint64_t>::make(2 * (engine() % n) + 1) };
+				if (engine() & 1)
+				{
+					container.insert(key);
+				}
+				else
+				{
+					container.erase(key);
+				}
+			}
+		} };
+
+		const Clock::time_point begin{ Clock::now() };
+		start.store(true, std::memory_order_release);
+		for (std::thread& reader : threads)
+		{
+			reader.join();
+		}
+		const double seconds{ std::chrono::duration<double>(Clock::now() - begin).count() };
+		stop.store(true, std::memory_order_release);
+		writer.join();
+
+		Result row{ Adapter::name(), KeyMaker<std::uint64_t>::name(), "readers", "lookup-" + std::to_string(readers) + "t",
+					n, n * readers, seconds, 0.0, 0.0, 0.0, hits.load(), -1, 0.0 };
+		results.push_back(row);
+	}
+#endif
+
+	//***************************************
+	//			Command line
+	//***************************************
+	struct Options
+	{
+		std::vector<std::uint64_t> sizes{ 1000, 10000, 100000, 1000000 };
+		std::vector<std::string> keys{ "int", "u64", "str64" };
+		std::vector<std::string> workloads{ "random", "sorted", "reverse", "zipf", "mixed", "churn", "misses", "local" };
+		std::vector<std::string> containers{ "rb", "rb-counted", "rb-unique", "rb-bloom", "rb-finger", "rb-index", "avl", "wavl", "btree", "set", "multiset" };
+		std::vector<unsigned> scalingThreads;
+		std::vector<unsigned> readerThreads;
+		bool csv{ false };
+	};
+
+	std::vector<std::string> splitList(const std::string& list)
+	{
+		std::vector<std::string> items;
+		std::stringstream stream{ list };
+		std::string item;
+		while (std::getline(stream, item, ','))
+		{
+			if (!item.empty())
+			{
+				items.push_back(item);
+			}
+		}
+		return items;
+	}
+
+	bool contains(const std::vector<std::string>& list, const std::string& item)
+	{
+		return std::find(list.begin(), list.end(), item) != list.end();
+	}
+
+	Options parseOptions(int argc, char* argv[])
+	{
+		Options options;
+
+		for (int i{ 1 }; i < argc; ++i)
+		{
+			const std::string arg{ argv[i] };
+			const std::size_t equals{ arg.find('=') };
+			const std::string name{ arg.substr(0, equals) };
+			const std::string value{ (equals == std::string::npos) ? "" : arg.substr(equals + 1) };
+
+			if (name == "--sizes")
+			{
+				options.sizes.clear();
+				for (const std::string& size : splitList(value))
+				{
+					options.sizes.push_back(static_cast<std::uint64_t>(std::stod(size)));
+				}
+			}
+			else if (name == "--max-size")
+			{
+				//Decades from 1e3 up to and including the requested maximum, e.g. --max-size=1e8
+				const std::uint64_t maxSize{ static_cast<std::uint64_t>(std::stod(value)) };
+				options.sizes.clear();
+				for (std::uint64_t size{ 1000 }; size <= maxSize; size *= 10)
+				{
+					options.sizes.push_back(size);
+				}
+			}
+			else if (name == "--keys")
+			{
+				options.keys = splitList(value);
+			}
+			else if (name == "--workloads")
+			{
+				options.workloads = splitList(value);
+			}
+			else if (name == "--containers")
+			{
+				options.containers = splitList(value);
+			}
+			else if (name == "--scaling")
+			{
+				for (const std::string& threads : splitList(value))
+				{
+					options.scalingThreads.push_back(static_cast<unsigned>(std::stoul(threads)));
+				}
+			}
+			else if (name == "--readers")
+			{
+#if RB_TREE_CONCURRENT_READS
+				for (const std::string& threads : splitList(value))
+				{
+					options.readerThreads.push_back(static_cast<unsigned>(std::stoul(threads)));
+				}
+#else
+				std::cerr << "--readers needs a build with -DRB_TREE_CONCURRENT_READS=1" << std::endl;
+				std::exit(1);
+#endif
+			}
+			else if (name == "--format")
+			{
+				options.csv = (value == "csv");
+			}
+			else
+			{
+				std::cerr << "Unknown option: " << arg << std::endl;
+				std::exit(1);
+			}
+		}
+
+		return options;
+	}
+
+	template<typename keyType>
+	void runKeyType(const Options& options, std::vector<Result>& results)
+	{
+		const Workload workloads[]{ Workload::RANDOM, Workload::SORTED, Workload::REVERSE, Workload::ZIPF, Workload::MIXED,
+									Workload::CHURN, Workload::MISSES, Workload::LOCAL };
+
+		for (const std::uint64_t size : options.sizes)
+		{
+			for (const Workload workload : workloads)
+			{
+				if (!contains(options.workloads, workloadName(workload)))
+				{
+					continue;
+				}
+
+				if (contains(options.containers, "rb"))
+				{
+					runWorkload<RBTreeAdapter<keyType>, keyType>(workload, size, results);
+				}
+				if (contains(options.containers, "rb-counted"))
+				{
+					runWorkload<RBTreeAdapter<keyType, Duplicates::COUNTED>, keyType>(workload, size, results);
+				}
+				if (contains(options.containers, "rb-unique"))
+				{
+					runWorkload<RBTreeAdapter<keyType, Duplicates::UNIQUE>, keyType>(workload, size, results);
+				}
+				if (contains(options.containers, "rb-bloom"))
+				{
+					runWorkload<BloomTreeAdapter<keyType>, keyType>(workload, size, results);
+				}
+				if (contains(options.containers, "rb-finger"))
+				{
+					runWorkload<FingerTreeAdapter<keyType>, keyType>(workload, size, results);
+				}
+				if (contains(options.containers, "rb-index"))
+				{
+					runWorkload<IndexedTreeAdapter<keyType>, keyType>(workload, size, results);
+				}
+				if (contains(options.containers, "avl"))
+				{
+					runWorkload<RBTreeAdapter<keyType, Duplicates::MULTI_NODE, Balance::AVL>, keyType>(workload, size, results);
+				}
+				if (contains(options.containers, "wavl"))
+				{
+					runWorkload<RBTreeAdapter<keyType, Duplicates::MULTI_NODE, Balance::WAVL>, keyType>(workload, size, results);
+				}
+				if (contains(options.containers, "btree"))
+				{
+					runWorkload<BTreeAdapter<keyType>, keyType>(workload, size, results);
+				}
+				if (contains(options.containers, "set"))
+				{
+					runWorkload<SetAdapter<keyType>, keyType>(workload, size, results);
+				}
+				if (contains(options.containers, "multiset"))
+				{
+					runWorkload<MultisetAdapter<keyType>, keyType>(workload, size, results);
+				}
+			}
+		}
+	}
+
+	void printResults(const std::vector<Result>& results, const bool csv)
+	{
+		if (csv)
+		{
+			//Schema version first so downstream tooling can detect layout changes
+			std::cout << "schema,container,key,workload,phase,size,ops,seconds,ops_per_sec,p50_ns,p99_ns,bytes_per_key,hits,height,rotations_per_op\n";
+			for (const Result& r : results)
+			{
+				std::cout << 2 << ',' << r.container << ',' << r.keyType << ',' << r.workload << ',' << r.phase << ','
+						  << r.size << ',' << r.ops << ',' << r.seconds << ',' << (r.ops / r.seconds) << ','
+						  << r.p50ns << ',' << r.p99ns << ',' << r.bytesPerKey << ',' << r.hits << ','
+						  << r.height << ',' << r.rotationsPerOp << '\n';
+			}
+			return;
+		}
+
+		std::cout << std::left << std::setw(12) << "container" << std::setw(7) << "key" << std::setw(9) << "workload"
+				  << std::setw(12) << "phase" << std::right << std::setw(11) << "size" << std::setw(14) << "ops/sec"
+				  << std::setw(10) << "p50 ns" << std::setw(10) << "p99 ns" << std::setw(12) << "bytes/key"
+				  << std::setw(8) << "height" << std::setw(10) << "rot/op" << '\n';
+
+		for (const Result& r : results)
+		{
+			std::cout << std::left << std::setw(12) << r.container << std::setw(7) << r.keyType << std::setw(9) << r.workload
+					  << std::setw(12) << r.phase << std::right << std::setw(11) << r.size
+					  << std::setw(14) << std::fixed << std::setprecision(0) << (r.ops / r.seconds)
+					  << std::setw(10) << r.p50ns << std::setw(10) << r.p99ns
+					  << std::setw(12) << std::setprecision(1) << r.bytesPerKey
+					  << std::setw(8) << r.height << std::setw(10) << std::setprecision(3) << r.rotationsPerOp << '\n';
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	const Options options{ parseOptions(argc, argv) };
+	std::vector<Result> results;
+
+	if (!options.scalingThreads.empty())
+	{
+		for (const std::uint64_t size : options.sizes)
+		{
+			for (const unsigned threads : options.scalingThreads)
+			{
+				runScaling<LockedTreeAdapter>(size, threads, results);
+				runScaling<ShardedAdapter>(size, threads, results);
+			}
+		}
+
+		printResults(results, options.csv);
+		return 0;
+	}
+
+#if RB_TREE_CONCURRENT_READS
+	if (!options.readerThreads.empty())
+	{
+		for (const std::uint64_t size : options.sizes)
+		{
+			for (const unsigned readers : options.readerThreads)
+			{
+				runReaders<SharedLockAdapter>(size, readers, results);
+				runReaders<EpochReadAdapter>(size, readers, results);
+			}
+		}
+
+		printResults(results, options.csv);
+		return 0;
+	}
+#endif
+
+	if (contains(options.keys, "int"))
+	{
+		runKeyType<int>(options, results);
+	}
+	if (contains(options.keys, "u64"))
+	{
+		runKeyType<std::uint64_t>(options, results);
+	}
+	if (contains(options.keys, "str64"))
+	{
+		runKeyType<std::string>(options, results);
+	}
+
+	printResults(results, options.csv);
+
+	return 0;
+}
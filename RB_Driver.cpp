@@ -1,5 +1,10 @@
 #include "RB_Tree.h"
+#include "B_Tree.h"
+#include "ShardedRBTree.h"
+#include "SmallRBTree.h"
 #include <iostream>
+#include <sstream>
+#include <string>
 
 int main()
 {
@@ -160,7 +165,7 @@ int main()
 
 	//TEST OPERATOR!=
 
-	std::cout << (t1 != t3);
+	std::cout << (t1 != t3) << std::endl;
 
 	//TEST OPERATOR+=
 	t1.destroyTree();
@@ -178,5 +183,366 @@ int main()
 
 	t1 += t2;
 
+	//TEST HINTED INSERT (sorted keys appended at the hint, then a key placed before its hint)
+	t1.destroyTree();
+
+	RB_Tree<int>::iterator hint{ t1.end() };
+	for (int i{ 0 }; i < 10; ++i)
+	{
+		hint = t1.insert(hint, i * 10);
+	}
+	t1.insert(t1.begin(), -5);
+
+	t1.displayTree(Order::ASC);
+
+	//TEST GETMIN/GETMAX/POPMIN/POPMAX
+	std::cout << t1.getMin() << " " << t1.getMax() << std::endl;
+	std::cout << t1.popMin() << " " << t1.popMax() << std::endl;
+	std::cout << t1.getMin() << " " << t1.getMax() << std::endl;
+
+	//TEST DUPLICATE POLICIES (three distinct keys inserted ten times)
+	RB_Tree<int, Duplicates::COUNTED> counted;
+	RB_Tree<int, Duplicates::UNIQUE> unique;
+
+	for (int i{ 0 }; i < 10; ++i)
+	{
+		counted.insert(i % 3);
+		unique.insert(i % 3);
+	}
+
+	//3 nodes holding 10 keys, 4 of them zeros
+	std::cout << counted.getNumNodes() << " " << counted.getNumKeys() << " " << counted.countKey(0) << std::endl;
+	//3 nodes holding 3 keys
+	std::cout << unique.getNumNodes() << " " << unique.getNumKeys() << std::endl;
+
+	//TEST BALANCE POLICIES (1023 sorted keys give a perfect tree of height 9 under AVL and WAVL)
+	RB_Tree<int, Duplicates::MULTI_NODE, Balance::AVL> avl;
+	RB_Tree<int, Duplicates::MULTI_NODE, Balance::WAVL> wavl;
+
+	for (int i{ 0 }; i < 1023; ++i)
+	{
+		avl.insert(i);
+		wavl.insert(i);
+	}
+	std::cout << avl.getTreeHeight() << " " << wavl.getTreeHeight() << std::endl;
+
+	for (int i{ 0 }; i < 1023; i += 2)
+	{
+		avl.remove(i);
+		wavl.remove(i);
+	}
+	avl.statistics();
+	wavl.statistics();
+
+	//TEST B_TREE (same keys as the addition test, then removal down to a single leaf)
+	B_Tree<int> b1;
+	B_Tree<int> b2;
+
+	for (int key : { 15, 24, 14, 10, 9, 5, 12 })
+	{
+		b1.insert(key);
+	}
+	for (int key : { 3, 17, 10, 10, 19, 21, 4 })
+	{
+		b2.insert(key);
+	}
+
+	B_Tree<int> b3{ b1 + b2 };
+	b3.displayTree(Order::ASC);
+	std::cout << (b3 == b1 + b2) << (b3 != b1) << std::endl;
+
+	for (int i{ 0 }; i < 1000; ++i)
+	{
+		b1.insert(i);
+	}
+	for (int i{ 0 }; i < 990; ++i)
+	{
+		b1.remove(i);
+	}
+	b1.statistics();
+
+	//TEST NODE HANDLES (move 24 to another tree, change a key in place, then merge the rest)
+	t1.destroyTree();
+	t2.destroyTree();
+
+	for (int key : { 15, 24, 14, 10 })
+	{
+		t1.insert(key);
+	}
+	t2.insert(3);
+
+	RB_Tree<int>::NodeHandle handle{ t1.extract(24) };
+	t2.insert(std::move(handle));
+
+	handle = t1.extract(t1.begin());
+	handle.key() = 11;
+	t1.insert(std::move(handle));
+
+	t2.merge(t1);
+	std::cout << t1.isEmpty() << " " << t1.extract(1).empty() << std::endl;
+	t2.displayTree(Order::ASC);
+
+	//TEST MEMORY USAGE/SHRINKTOFIT (node bytes before and after removing most keys, then compacting)
+	t1.destroyTree();
+	for (int i{ 0 }; i < 1000; ++i)
+	{
+		t1.insert(i);
+	}
+	const std::size_t fullBytes{ t1.memoryUsage().nodeBytes };
+	for (int i{ 0 }; i < 900; ++i)
+	{
+		t1.remove(i);
+	}
+	t1.shrinkToFit();
+	std::cout << (fullBytes / t1.memoryUsage().nodeBytes) << " " << t1.getNumNodes() << " " << t1.getMin() << std::endl;
+
+	//TEST LAZY DELETION (removals leave tombstones until a quarter of the nodes are tombstones, then the tree is compacted)
+	t1.destroyTree();
+	t1.setLazyDeletion(true);
+	for (int i{ 0 }; i < 100; ++i)
+	{
+		t1.insert(i);
+	}
+	for (int i{ 0 }; i < 30; ++i)
+	{
+		t1.remove(i);
+		if (i == 24)
+		{
+			//25 tombstones, nothing unlinked yet
+			std::cout << t1.getNumNodes() << " " << t1.getNumKeys() << " " << t1.getMin() << std::endl;
+		}
+	}
+	t1.compact();
+	std::cout << t1.getNumNodes() << " " << t1.getNumTombstones() << " " << t1.containsKey(29) << std::endl;
+
+	//TEST APPLY (the insert and remove of 7 cancel, so only 3 is added)
+	t1.destroyTree();
+	t1.setLazyDeletion(false);
+	t1.insert(5);
+
+	const std::vector<bool> results{ t1.apply({ { OpType::INSERT, 7 }, { OpType::CONTAINS, 5 }, { OpType::REMOVE, 7 },
+		{ OpType::CONTAINS, 7 }, { OpType::INSERT, 3 }, { OpType::REMOVE, 9 } }) };
+	for (const bool result : results)
+	{
+		std::cout << result;
+	}
+	std::cout << " " << t1.getNumNodes() << std::endl;
+
+	//TEST DEFRAGMENT (the keys and shape are unchanged, whole and in time slices)
+	t1.destroyTree();
+	for (int i{ 0 }; i < 1000; ++i)
+	{
+		t1.insert((i * 7919) % 1000);
+	}
+	t2 = t1;
+	t1.defragment(Layout::VEB);
+	while (!t1.defragmentFor(std::chrono::microseconds{ 10 }, Layout::IN_ORDER))
+	{
+	}
+	std::cout << (t1 == t2) << " " << t1.getMin() << " " << t1.getMax() << std::endl;
+
+	//TEST SHARDED TREE (10000 keys spread over four shards, then a range query crossing shards)
+	ShardedRBTree<int> sharded{ 4 };
+	for (int i{ 0 }; i < 10000; ++i)
+	{
+		sharded.insert((i * 7919) % 10000);
+	}
+	int inRange{ 0 };
+	sharded.forEachInRange(4990, 5009, [&inRange](const int&) { ++inRange; });
+	std::cout << sharded.getShardSizes().size() << " " << sharded.getNumKeys() << " " << inRange << std::endl;
+
+	//TEST INTERVAL TREE (intervals containing a point, then intervals overlapping a range)
+	RB_Tree<Interval<int>> intervals;
+	for (const Interval<int> interval : { Interval<int>{ 15, 20 }, { 10, 30 }, { 17, 19 }, { 5, 20 }, { 12, 15 }, { 30, 40 } })
+	{
+		intervals.insert(interval);
+	}
+	for (const Interval<int>& interval : intervals.overlapping(16))
+	{
+		std::cout << interval << " ";
+	}
+	std::cout << intervals.overlapping(31, 35).size() << " " << intervals.overlapping(41, 50).size() << std::endl;
+
+	//TEST SMALL TREE (eight keys fit inline, the ninth moves them into a tree, removals move them back)
+	SmallRBTree<int> small;
+	for (int i{ 0 }; i < 9; ++i)
+	{
+		small.insert(i * 3);
+		if (i == 7)
+		{
+			std::cout << small.isInline() << " ";
+		}
+	}
+	std::cout << small.isInline() << " ";
+	for (int i{ 0 }; i < 5; ++i)
+	{
+		small.remove(i * 3);
+	}
+	std::cout << small.isInline() << " " << small.getNumKeys() << " " << small.containsKey(21) << std::endl;
+
+	//TEST DEFERRED TEARDOWN (destroyTree unlinks the nodes at once, later inserts free them 64 at a time)
+	RB_Tree<int> pending;
+	pending.setTeardown(Teardown::DEFERRED);
+	for (int i{ 0 }; i < 1000; ++i)
+	{
+		pending.insert(i);
+	}
+	pending.destroyTree();
+	std::cout << pending.isEmpty() << " " << pending.getNumPendingNodes() << " ";
+	pending.insert(1);
+	pending.insert(2);
+	std::cout << pending.getNumPendingNodes() << " ";
+	pending.finishTeardown();
+	std::cout << pending.getNumPendingNodes() << " " << pending.getNumKeys() << std::endl;
+
+	//TEST SET ALGEBRA (multiples of 2 and of 3 below 30: both, only of 2, exactly one of them)
+	RB_Tree<int> evens;
+	RB_Tree<int> triples;
+	for (int i{ 0 }; i < 30; ++i)
+	{
+		if (i % 2 == 0)
+		{
+			evens.insert(i);
+		}
+		if (i % 3 == 0)
+		{
+			triples.insert(i);
+		}
+	}
+	std::cout << (evens & triples).getNumKeys() << " " << (evens - triples).getNumKeys() << " "
+	          << (evens ^ triples).getNumKeys() << std::endl;
+	evens -= triples;
+	std::cout << evens.containsKey(6) << " " << evens.containsKey(4) << std::endl;
+
+	//TEST EMPLACE (keys built in their node or moved in, a rejected key is left with the caller)
+	RB_Tree<std::string, Duplicates::UNIQUE> names;
+	std::string name{ "red" };
+	names.insert(std::move(name));
+	names.emplace(5, 'b');
+	name = "red";
+	std::cout << names.insert(std::move(name)) << " " << name << " " << names.containsKey("bbbbb") << " "
+	          << names.getNumKeys() << std::endl;
+
+	//TEST MEMBERSHIP FILTER (lookups of absent keys are answered by the filter, present keys are still found)
+	RB_Tree<int> filtered;
+	filtered.setMembershipFilter(true);
+	for (int i{ 0 }; i < 1000; i += 2)
+	{
+		filtered.insert(i);
+	}
+	filtered.remove(500);
+	int filteredFound{ 0 };
+	for (int i{ 0 }; i < 1000; ++i)
+	{
+		filteredFound += filtered.containsKey(i);
+	}
+	std::cout << filtered.isMembershipFilter() << " " << filteredFound << " " << (filtered.memoryUsage().filterBytes > 0) << std::endl;
+
+	//TEST FINGER SEARCH (ascending lookups start next to the previous key, so almost none of them climb to the root)
+	RB_Tree<int> fingered;
+	fingered.setFingerSearch(true);
+	for (int i{ 0 }; i < 1000; ++i)
+	{
+		fingered.insert(i);
+	}
+	fingered.resetFingerStats();
+	int fingerFound{ 0 };
+	for (int i{ 0 }; i < 1000; ++i)
+	{
+		fingerFound += fingered.containsKey(i);
+	}
+	fingered.remove(500);
+	const FingerStats fingerStats{ fingered.getFingerStats() };
+	std::cout << fingerFound << " " << fingered.containsKey(500) << " " << fingered.containsKey(501) << " "
+		<< (fingerStats.hitRate() > 0.9) << std::endl;
+
+	//TEST HASH INDEX (lookups and removes go through the index while iteration still follows the keys in order)
+	RB_Tree<int> indexed;
+	indexed.setHashIndex(true);
+	for (int i{ 999 }; i >= 0; --i)
+	{
+		indexed.insert(i);
+	}
+	int indexRemoved{ 0 };
+	for (int i{ 0 }; i < 1000; i += 3)
+	{
+		indexRemoved += indexed.remove(i);
+	}
+	int indexInOrder{ 1 };
+	int previousKey{ -1 };
+	for (const int key : indexed)
+	{
+		indexInOrder = indexInOrder && previousKey < key && key % 3 != 0;
+		previousKey = key;
+	}
+	std::cout << indexed.isHashIndex() << " " << indexRemoved << " " << indexed.containsKey(3) << " " << indexed.containsKey(4) << " "
+		<< indexInOrder << " " << (indexed.memoryUsage().indexBytes > 0) << std::endl;
+
+	//TEST BOUNDED CAPACITY (a top-10 of 0..999 keeps 990..999, and smaller keys are turned away once it is full)
+	RB_Tree<int> topTen;
+	topTen.setCapacity(10, Eviction::SMALLEST);
+	for (int i{ 0 }; i < 1000; ++i)
+	{
+		topTen.insert((i * 7919) % 1000);
+	}
+	const bool lateSmallKey{ topTen.insert(5) };
+	std::cout << topTen.getNumKeys() << " " << *topTen.begin() << " " << lateSmallKey << " " << topTen.containsKey(999) << std::endl;
+
+#if RB_TREE_CONCURRENT_READS
+	//TEST CONCURRENT READERS (a reader keeps finding every even key while the writer adds and removes odd keys)
+	t1.destroyTree();
+	for (int i{ 0 }; i < 1000; i += 2)
+	{
+		t1.insert(i);
+	}
+
+	bool allFound{ true };
+	std::thread reader{ [&t1, &allFound]()
+	{
+		for (int pass{ 0 }; pass < 20; ++pass)
+		{
+			for (int i{ 0 }; i < 1000; i += 2)
+			{
+				allFound = allFound && t1.concurrentContainsKey(i);
+			}
+		}
+	} };
+	for (int i{ 0 }; i < 20000; ++i)
+	{
+		if (i % 2 == 0)
+		{
+			t1.insert((i * 7919) % 1000 | 1);
+		}
+		else
+		{
+			t1.remove((i * 7919) % 1000 | 1);
+		}
+	}
+	reader.join();
+	std::cout << allFound << " " << t1.concurrentContainsKey(1001) << std::endl;
+#endif
+
+#if RB_TREE_TRACE
+	//TEST TRACE (three operations are recorded and read back in order)
+	std::stringstream traceStream;
+	{
+		TraceRecorder recorder{ traceStream };
+		RB_Tree<int> traced;
+		traced.setTraceRecorder(&recorder);
+		traced.insert(7);
+		traced.containsKey(7);
+		traced.remove(7);
+	}
+	TraceReader traceReader{ traceStream };
+	OpType tracedType{};
+	unsigned long long tracedGap{ 0 };
+	int tracedKey{ 0 };
+	while (traceReader.next(tracedType, tracedGap, &tracedKey))
+	{
+		std::cout << static_cast<int>(tracedType) << ":" << tracedKey << " ";
+	}
+	std::cout << std::endl;
+#endif
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,515 @@
+//*****************************************************************************
+//  RB_Replay.cpp
+//
+//  Replays an operation trace recorded by TraceRecorder against RB_Tree and,
+//  as a baseline, std::set or std::multiset, so changes can be judged against
+//  production access patterns and incidents can be reproduced offline.
+//
+//  Build:  g++ -O2 -std=c++17 RB_Replay.cpp -o RB_Replay
+//          Add -DRB_TREE_COUNTERS=1 to report the tree's operation counters.
+//
+//  Record: build the application with -DRB_TREE_TRACE=1, open a std::ofstream
+//          in binary mode, wrap it in a TraceRecorder and pass that to
+//          setTraceRecorder on the trees of interest.
+//
+//  Usage:  RB_Replay trace.bin [--key=i32|u32|i64|u64|f64] [--baseline]
+//                              [--repeat=N]
+//
+//  The trace is loaded into memory first, then replayed from an empty
+//  container at full speed, ignoring the recorded gaps between operations,
+//  into an RB_Tree with the recorded Duplicates policy and Balance scheme.
+//  Keys are read as signed integers of the recorded size unless --key names
+//  another type of that size. Every container is replayed twice: once
+//  without per operation timing for throughput (the best of --repeat runs),
+//  and once with every operation timed for the latency histograms, which
+//  therefore include the cost of one clock read pair. --baseline also
+//  replays into std::set for Duplicates::UNIQUE traces and std::multiset
+//  otherwise.
+//*****************************************************************************
+#include "RB_Tree.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <set>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace
+{
+	using Clock = std::chrono::steady_clock;
+
+	//***************************************
+	//			Trace loading
+	//***************************************
+	template<typename keyType>
+	struct TracedOperation
+	{
+		OpType type;
+		keyType key;
+	};
+
+	//A trace held in memory so reading it does not disturb the timed replay
+	template<typename keyType>
+	struct LoadedTrace
+	{
+		std::vector<TracedOperation<keyType>> operations;
+		unsigned long long recordedNanoseconds{ 0 };    //Time from the first to the last recorded operation
+		std::uint64_t counts[3]{};                      //Operations of each OpType
+	};
+
+	template<typename keyType>
+	LoadedTrace<keyType> loadTrace(TraceReader& reader)
+	{
+		LoadedTrace<keyType> trace;
+		TracedOperation<keyType> operation;
+		unsigned long long gap{ 0 };
+		bool first{ true };
+
+		while (reader.next(operation.type, gap, &operation.key))
+		{
+			//The first gap runs from the start of recording, not from an operation
+			if (!first)
+			{
+				trace.recordedNanoseconds += gap;
+			}
+			first = false;
+
+			++trace.counts[static_cast<int>(operation.type)];
+			trace.operations.push_back(operation);
+		}
+
+		return trace;
+	}
+
+	//***************************************
+	//			Latency histogram
+	//***************************************
+	//Log-linear histogram of nanosecond latencies: exact below 8 ns, then 8 buckets per power of two, so every bucket
+	//is within 12.5% of its lower bound. Memory use does not grow with the length of the trace.
+	class Histogram
+	{
+	private:
+		static constexpr int subBuckets{ 8 };
+		static constexpr int numBuckets{ 64 * subBuckets };
+
+		std::uint64_t buckets[numBuckets]{};
+		std::uint64_t count{ 0 };
+		double totalNanoseconds{ 0.0 };
+		std::uint64_t maxNanoseconds{ 0 };
+
+		static int bucketOf(const std::uint64_t nanoseconds)
+		{
+			if (nanoseconds < subBuckets)
+			{
+				return static_cast<int>(nanoseconds);
+			}
+
+			int exponent{ 63 };
+			while ((nanoseconds >> exponent) == 0)
+			{
+				--exponent;
+			}
+			const int sub{ static_cast<int>((nanoseconds >> (exponent - 3)) & (subBuckets - 1)) };
+			return (exponent - 2) * subBuckets + sub;
+		}
+
+		//Smallest latency that falls into a bucket
+		static std::uint64_t lowerBound(const int bucket)
+		{
+			if (bucket < subBuckets)
+			{
+				return static_cast<std::uint64_t>(bucket);
+			}
+
+			const int exponent{ bucket / subBuckets + 2 };
+			return (std::uint64_t{ 1 } << exponent) + static_cast<std::uint64_t>(bucket % subBuckets) * (std::uint64_t{ 1 } << (exponent - 3));
+		}
+
+	public:
+		void add(const std::uint64_t nanoseconds)
+		{
+			++buckets[bucketOf(nanoseconds)];
+			++count;
+			totalNanoseconds += static_cast<double>(nanoseconds);
+			maxNanoseconds = std::max(maxNanoseconds, nanoseconds);
+		}
+
+		std::uint64_t getCount() const { return count; }
+		double mean() const { return (count == 0) ? 0.0 : totalNanoseconds / static_cast<double>(count); }
+		std::uint64_t max() const { return maxNanoseconds; }
+
+		//Upper bound of the bucket holding the given fraction of the samples
+		std::uint64_t percentile(const double fraction) const
+		{
+			const std::uint64_t rank{ static_cast<std::uint64_t>(fraction * static_cast<double>(count)) };
+			std::uint64_t seen{ 0 };
+
+			for (int bucket{ 0 }; bucket < numBuckets; ++bucket)
+			{
+				seen += buckets[bucket];
+				if (seen > rank)
+				{
+					return std::min(lowerBound(bucket + 1), maxNanoseconds);
+				}
+			}
+			return maxNanoseconds;
+		}
+
+		void merge(const Histogram& other)
+		{
+			for (int bucket{ 0 }; bucket < numBuckets; ++bucket)
+			{
+				buckets[bucket] += other.buckets[bucket];
+			}
+			count += other.count;
+			totalNanoseconds += other.totalNanoseconds;
+			maxNanoseconds = std::max(maxNanoseconds, other.maxNanoseconds);
+		}
+
+		//Prints the samples grouped by power of two, skipping empty ranges. Latencies reach 2^63 ns only in theory.
+		void print() const
+		{
+			for (int exponent{ 0 }; exponent < 63; ++exponent)
+			{
+				const std::uint64_t low{ (exponent == 0) ? 0 : (std::uint64_t{ 1 } << exponent) };
+				const std::uint64_t high{ std::uint64_t{ 1 } << (exponent + 1) };
+				std::uint64_t inRange{ 0 };
+
+				for (int bucket{ bucketOf(low) }; bucket < numBuckets && lowerBound(bucket) < high; ++bucket)
+				{
+					inRange += buckets[bucket];
+				}
+
+				if (inRange != 0)
+				{
+					std::cout << "      [" << std::setw(9) << low << ", " << std::setw(9) << high << ") ns "
+							  << std::setw(12) << inRange << std::setw(8) << std::fixed << std::setprecision(2)
+							  << (100.0 * static_cast<double>(inRange) / static_cast<double>(count)) << "%\n";
+				}
+			}
+		}
+	};
+
+	//***************************************
+	//			Replay targets
+	//***************************************
+	//Uniform interface over the containers a trace is replayed into
+	template<typename keyType, Duplicates duplicates, Balance balance>
+	struct TreeTarget
+	{
+		RB_Tree<keyType, duplicates, balance> tree;
+
+		static std::string name()
+		{
+			const char* const balanceNames[]{ "red-black", "avl", "wavl" };
+			const char* const duplicatesNames[]{ "multi-node", "counted", "unique" };
+			return std::string{ "RB_Tree (" } + balanceNames[static_cast<int>(balance)] + ", " +
+				   duplicatesNames[static_cast<int>(duplicates)] + ")";
+		}
+
+		bool insert(const keyType& key) { return tree.insert(key); }
+		bool remove(const keyType& key) { return tree.remove(key); }
+		bool contains(const keyType& key) const { return tree.containsKey(key); }
+		std::size_t size() const { return tree.getNumKeys(); }
+
+		void printCounters(const std::uint64_t operations) const
+		{
+#if RB_TREE_COUNTERS
+			const OperationCounters counters{ tree.getCounters() };
+			const double perOperation{ 1.0 / static_cast<double>(std::max<std::uint64_t>(operations, 1)) };
+
+			std::cout << "    counters: rotations "
+					  << (counters.leftRotations + counters.rightRotations) * perOperation << "/op, comparisons "
+					  << (counters.searchComparisons + counters.insertComparisons) * perOperation << "/op, allocations "
+					  << counters.nodeAllocations << ", frees " << counters.nodeFrees << ", max descent "
+					  << counters.maxDescentDepth << '\n';
+#else
+			(void)operations;
+			std::cout << "    counters: not compiled in, build with -DRB_TREE_COUNTERS=1\n";
+#endif
+		}
+	};
+
+	template<typename keyType, bool unique>
+	struct SetTarget
+	{
+		typename std::conditional<unique, std::set<keyType>, std::multiset<keyType>>::type tree;
+
+		static std::string name() { return unique ? "std::set" : "std::multiset"; }
+		bool insert(const keyType& key) { tree.insert(key); return true; }
+
+		//Removes a single instance to match RB_Tree::remove
+		bool remove(const keyType& key)
+		{
+			const auto position{ tree.find(key) };
+			if (position == tree.end())
+			{
+				return false;
+			}
+			tree.erase(position);
+			return true;
+		}
+
+		bool contains(const keyType& key) const { return tree.find(key) != tree.end(); }
+		std::size_t size() const { return tree.size(); }
+		void printCounters(const std::uint64_t) const {}
+	};
+
+	//***************************************
+	//			Replay
+	//***************************************
+	struct Options
+	{
+		std::string path;
+		std::string key;
+		bool baseline{ false };
+		unsigned repeat{ 1 };
+	};
+
+	//Applies one traced operation. The results are summed so the compiler cannot drop the lookups.
+	template<typename Target, typename keyType>
+	bool apply(Target& target, const TracedOperation<keyType>& operation)
+	{
+		switch (operation.type)
+		{
+		case OpType::INSERT:   return target.insert(operation.key);
+		case OpType::REMOVE:   return target.remove(operation.key);
+		default:               return target.contains(operation.key);
+		}
+	}
+
+	template<typename Target, typename keyType>
+	void replay(const LoadedTrace<keyType>& trace, const Options& options)
+	{
+		const std::uint64_t numOperations{ trace.operations.size() };
+		double bestSeconds{ 0.0 };
+		std::uint64_t hits{ 0 };
+		std::size_t finalSize{ 0 };
+
+		//Throughput: no clock reads inside the loop
+		for (unsigned run{ 0 }; run < options.repeat; ++run)
+		{
+			Target target;
+			hits = 0;
+
+			const Clock::time_point start{ Clock::now() };
+			for (const TracedOperation<keyType>& operation : trace.operations)
+			{
+				hits += apply(target, operation);
+			}
+			const double seconds{ std::chrono::duration<double>(Clock::now() - start).count() };
+
+			if (run == 0 || seconds < bestSeconds)
+			{
+				bestSeconds = seconds;
+			}
+			finalSize = target.size();
+
+			if (run + 1 == options.repeat)
+			{
+				std::cout << Target::name() << ": " << std::fixed << std::setprecision(0)
+						  << (static_cast<double>(numOperations) / bestSeconds) << " ops/sec, "
+						  << std::setprecision(1) << (bestSeconds * 1e9 / static_cast<double>(std::max<std::uint64_t>(numOperations, 1)))
+						  << " ns/op, " << hits << " successful, final size " << finalSize << '\n';
+				target.printCounters(numOperations);
+			}
+		}
+
+		//Latency: every operation timed
+		Target target;
+		Histogram histograms[3];
+		for (const TracedOperation<keyType>& operation : trace.operations)
+		{
+			const Clock::time_point start{ Clock::now() };
+			hits += apply(target, operation);
+			const Clock::time_point end{ Clock::now() };
+			histograms[static_cast<int>(operation.type)].add(static_cast<std::uint64_t>(
+				std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count()));
+		}
+
+		const char* const typeNames[]{ "insert", "remove", "contains" };
+		Histogram all;
+		std::cout << "    " << std::left << std::setw(10) << "operation" << std::right << std::setw(12) << "count"
+				  << std::setw(10) << "mean ns" << std::setw(9) << "p50" << std::setw(9) << "p90" << std::setw(9) << "p99"
+				  << std::setw(9) << "p99.9" << std::setw(11) << "max" << '\n';
+		for (int type{ 0 }; type < 3; ++type)
+		{
+			const Histogram& histogram{ histograms[type] };
+			all.merge(histogram);
+			if (histogram.getCount() == 0)
+			{
+				continue;
+			}
+
+			std::cout << "    " << std::left << std::setw(10) << typeNames[type] << std::right << std::setw(12)
+					  << histogram.getCount() << std::setw(10) << std::fixed << std::setprecision(1) << histogram.mean()
+					  << std::setw(9) << histogram.percentile(0.5) << std::setw(9) << histogram.percentile(0.9)
+					  << std::setw(9) << histogram.percentile(0.99) << std::setw(9) << histogram.percentile(0.999)
+					  << std::setw(11) << histogram.max() << '\n';
+		}
+		std::cout << "    latency histogram, all operations:\n";
+		all.print();
+
+		//Keep the lookups observable
+		if (hits == static_cast<std::uint64_t>(-1))
+		{
+			std::cout << hits;
+		}
+	}
+
+	template<typename keyType, Duplicates duplicates, Balance balance>
+	void replayAll(const LoadedTrace<keyType>& trace, const Options& options)
+	{
+		replay<TreeTarget<keyType, duplicates, balance>>(trace, options);
+		if (options.baseline)
+		{
+			replay<SetTarget<keyType, duplicates == Duplicates::UNIQUE>>(trace, options);
+		}
+	}
+
+	template<typename keyType, Duplicates duplicates>
+	void dispatchBalance(const LoadedTrace<keyType>& trace, const Balance balance, const Options& options)
+	{
+		switch (balance)
+		{
+		case Balance::AVL:  replayAll<keyType, duplicates, Balance::AVL>(trace, options); break;
+		case Balance::WAVL: replayAll<keyType, duplicates, Balance::WAVL>(trace, options); break;
+		default:            replayAll<keyType, duplicates, Balance::RED_BLACK>(trace, options); break;
+		}
+	}
+
+	template<typename keyType>
+	void run(TraceReader& reader, const Options& options)
+	{
+		const LoadedTrace<keyType> trace{ loadTrace<keyType>(reader) };
+		const double recordedSeconds{ static_cast<double>(trace.recordedNanoseconds) * 1e-9 };
+
+		std::cout << "trace: " << trace.operations.size() << " operations (" << trace.counts[0] << " inserts, "
+				  << trace.counts[1] << " removes, " << trace.counts[2] << " lookups), recorded over " << std::fixed
+				  << std::setprecision(3) << recordedSeconds << " s";
+		if (recordedSeconds > 0.0)
+		{
+			std::cout << " (" << std::setprecision(0) << (static_cast<double>(trace.operations.size()) / recordedSeconds)
+					  << " ops/sec)";
+		}
+		std::cout << '\n';
+
+		switch (reader.getDuplicates())
+		{
+		case Duplicates::COUNTED: dispatchBalance<keyType, Duplicates::COUNTED>(trace, reader.getBalance(), options); break;
+		case Duplicates::UNIQUE:  dispatchBalance<keyType, Duplicates::UNIQUE>(trace, reader.getBalance(), options); break;
+		default:                  dispatchBalance<keyType, Duplicates::MULTI_NODE>(trace, reader.getBalance(), options); break;
+		}
+	}
+
+	Options parseOptions(int argc, char* argv[])
+	{
+		Options options;
+
+		for (int i{ 1 }; i < argc; ++i)
+		{
+			const std::string arg{ argv[i] };
+			const std::size_t equals{ arg.find('=') };
+			const std::string name{ arg.substr(0, equals) };
+			const std::string value{ (equals == std::string::npos) ? "" : arg.substr(equals + 1) };
+
+			if (name == "--key")
+			{
+				options.key = value;
+			}
+			else if (name == "--baseline")
+			{
+				options.baseline = true;
+			}
+			else if (name == "--repeat")
+			{
+				options.repeat = std::max(1u, static_cast<unsigned>(std::stoul(value)));
+			}
+			else if (options.path.empty() && arg.compare(0, 2, "--") != 0)
+			{
+				options.path = arg;
+			}
+			else
+			{
+				std::cerr << "Unknown option: " << arg << std::endl;
+				std::exit(1);
+			}
+		}
+
+		if (options.path.empty())
+		{
+			std::cerr << "Usage: RB_Replay trace.bin [--key=i32|u32|i64|u64|f64] [--baseline] [--repeat=N]" << std::endl;
+			std::exit(1);
+		}
+
+		return options;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options{ parseOptions(argc, argv) };
+
+	std::ifstream input{ options.path, std::ios::binary };
+	if (!input)
+	{
+		std::cerr << "Cannot open " << options.path << std::endl;
+		return 1;
+	}
+
+	try
+	{
+		TraceReader reader{ input };
+
+		if (options.key.empty())
+		{
+			options.key = (reader.getKeySize() == 4) ? "i32" : "i64";
+		}
+
+		const std::size_t keySize{ (options.key == "i32" || options.key == "u32") ? 4u : 8u };
+		if (keySize != reader.getKeySize())
+		{
+			std::cerr << "The trace holds " << reader.getKeySize() << " byte keys, --key=" << options.key
+					  << " does not match" << std::endl;
+			return 1;
+		}
+
+		if (options.key == "i32")
+		{
+			run<std::int32_t>(reader, options);
+		}
+		else if (options.key == "u32")
+		{
+			run<std::uint32_t>(reader, options);
+		}
+		else if (options.key == "i64")
+		{
+			run<std::int64_t>(reader, options);
+		}
+		else if (options.key == "u64")
+		{
+			run<std::uint64_t>(reader, options);
+		}
+		else if (options.key == "f64")
+		{
+			run<double>(reader, options);
+		}
+		else
+		{
+			std::cerr << "Unknown key type: " << options.key << std::endl;
+			return 1;
+		}
+	}
+	catch (const std::exception& error)
+	{
+		std::cerr << error.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
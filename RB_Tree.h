@@ -1,507 +1,6027 @@
 #pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <initializer_list>
 #include <iostream>
 #include <iomanip>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 //Enumerated type for the color of nodes in RB-Tree
-enum class Color { RED = 0, BLACK = 1 };
+enum class Color : unsigned char { RED = 0, BLACK = 1 };
 
 //Enumerated type for the order type of the tree. In this case, ascending or descending order.
 enum class Order { ASC = 0, DES = 1 };
 
-template<typename keyType>
-class RB_Tree
-{
-private:
+//Enumerated type for the way the tree stores equal keys. MULTI_NODE gives every inserted key its own node,
+//COUNTED keeps one node per distinct key with a repeat count and UNIQUE ignores keys that are already in the tree.
+enum class Duplicates { MULTI_NODE = 0, COUNTED = 1, UNIQUE = 2 };
 
-	//Red-Black tree node structure
-    struct RB_Node
-    {
-        Color nodeColor;    //Color of the node. Either Color::RED or Color::BLACK
-        keyType key;        //Data contained in the node
-        RB_Node* parent;    //Pointer to the node's parent
-        RB_Node* left;      //Pointer to the node's left child
-        RB_Node* right;     //Pointer to the node's right child
-    };
+//Enumerated type for the balancing scheme of the tree. RED_BLACK uses node colors, AVL keeps subtree heights within
+//one of each other and WAVL (weak AVL) uses rank differences of 1 or 2, which behaves like AVL when there are no
+//deletions and needs at most two rotations per update.
+enum class Balance { RED_BLACK = 0, AVL = 1, WAVL = 2 };
 
-    RB_Node* root;      //Pointer to the root of the tree
+//Enumerated type for the kind of an operation passed to RB_Tree::apply.
+enum class OpType { INSERT = 0, REMOVE = 1, CONTAINS = 2 };
 
-    //Pointer to the tree's NIL node. The tree has a unique sentinel node called NIL node to represent all leaves
-    //NIL's nodeColor is black and the rest of its attributes are immaterial
-    RB_Node* const NIL;
+//Enumerated type for the memory order RB_Tree::defragment places nodes in. IN_ORDER follows the keys, DEPTH_FIRST
+//places every node before its left and then its right subtree, and VEB (van Emde Boas) splits the tree at half its
+//height, recursively, so each small subtree a search passes through sits in one block.
+enum class Layout { IN_ORDER = 0, DEPTH_FIRST = 1, VEB = 2 };
 
-    unsigned numRedNodes;    //Number of red nodes in the tree
-    unsigned numBlackNodes;  //Number of black nodes in the tree
+//Enumerated type for the way RB_Tree::destroyTree and the destructor free the tree's nodes. IMMEDIATE frees them before
+//returning. DEFERRED unlinks them in O(1) and frees a bounded number during each later insert and remove. BACKGROUND
+//unlinks them in O(1) and hands them to the BackgroundReclaimer thread.
+enum class Teardown { IMMEDIATE = 0, DEFERRED = 1, BACKGROUND = 2 };
 
-    //Private member functions
-    void transplant(RB_Node* const, RB_Node* const);
-    RB_Node* search(RB_Node*, const keyType&) const;
-    RB_Node* minimum(RB_Node*) const;
-    void leftRotate(RB_Node* const);
-    void rightRotate(RB_Node* const);
-    void insertFixup(RB_Node*);
-    void deleteFixup(RB_Node*);
-    void RB_insert(RB_Node*);
-    void RB_delete(RB_Node*);
-    int maximum(const int, const int) const;
-    int calculateSubtreeHeight(const RB_Node* const) const;
-	void copyTree(RB_Node*, RB_Node*, RB_Node*);
-	void traverseInsert(const RB_Node* const, const RB_Node* const);
-	bool compareSubtrees(const RB_Node*, const RB_Node*, RB_Node* const) const;
-	void ascending(const RB_Node* const) const;
-	void descending(const RB_Node* const) const;
+//Enumerated type for the keys a bounded RB_Tree gives up to make room, see RB_Tree::setCapacity. SMALLEST keeps the
+//largest keys, as a top-K or a window over increasing keys needs, and LARGEST keeps the smallest.
+enum class Eviction { SMALLEST = 0, LARGEST = 1 };
+
+//Operation counters are compiled in only when RB_TREE_COUNTERS is defined to a non-zero value before this header is
+//included. When disabled the counting statements expand to nothing and getCounters() always reports zeros.
+#ifndef RB_TREE_COUNTERS
+#define RB_TREE_COUNTERS 0
+#endif
+
+#if RB_TREE_COUNTERS
+#define RB_TREE_COUNT(counter) (++counters.counter)
+#define RB_TREE_COUNT_ADD(counter, amount) (counters.counter += (amount))
+#define RB_TREE_COUNT_MAX(counter, value) (counters.counter = ((value) > counters.counter) ? (value) : counters.counter)
+#else
+#define RB_TREE_COUNT(counter) ((void)0)
+#define RB_TREE_COUNT_ADD(counter, amount) ((void)0)
+#define RB_TREE_COUNT_MAX(counter, value) ((void)(value))
+#endif
+
+//Operation tracing is compiled in only when RB_TREE_TRACE is defined to a non-zero value before this header is included.
+//A tree with trivially copyable keys then records every insert, remove and containsKey call into the TraceRecorder
+//passed to setTraceRecorder, along with every other change to its keys as the inserts and removes that replay it:
+//each operation of a batch passed to apply, the keys taken by popMin, popMax and extract, the keys gained by
+//inserting a node handle, the keys merge moves between trees (recorded by both) and the keys a bounded tree evicts.
+//Inserts a full bounded tree turns away change nothing and are not recorded. Wholesale changes are not recorded
+//either: destroyTree, release, swap, assignment and the compound set operators, except for -= when it removes keys
+//one at a time. When disabled the recording statements expand to nothing.
+#ifndef RB_TREE_TRACE
+#define RB_TREE_TRACE 0
+#endif
+
+#if RB_TREE_TRACE
+#define RB_TREE_TRACE_OP(type, key) traceOperation((type), (key))
+#define RB_TREE_TRACE_COPIES(type, key, copies) traceOperation((type), (key), (copies))
+#else
+#define RB_TREE_TRACE_OP(type, key) ((void)0)
+#define RB_TREE_TRACE_COPIES(type, key, copies) ((void)0)
+#endif
+
+//Concurrent readers are compiled in only when RB_TREE_CONCURRENT_READS is defined to a non-zero value before this
+//header is included. A tree then allows one writer thread to run alongside any number of threads calling
+//concurrentContainsKey. Every other member function belongs to the writer thread, and extract, merge, insertion of a
+//node handle, operator=, swap, release, shrinkToFit and defragment also require that no readers are running.
+//Every node carries a version that is odd while the writer rewrites its links, so a reader only has to check the
+//nodes it passed, not every change anywhere in the tree.
+#ifndef RB_TREE_CONCURRENT_READS
+#define RB_TREE_CONCURRENT_READS 0
+#endif
+
+#if RB_TREE_CONCURRENT_READS
+//Node field that reader threads load while the writer thread changes it. Loads use acquire and stores use release
+//order, so a reader that follows a link also sees everything the writer stored in the node before linking it. On x86
+//both compile to plain moves.
+template<typename T>
+class SharedField
+{
+private:
+    std::atomic<T> value;
 
 public:
-    //Default Constructor
-    RB_Tree();
+    SharedField() : value{ T{} } {}
+    SharedField(const SharedField& other) : value{ other.value.load(std::memory_order_acquire) } {}
+    SharedField& operator=(const SharedField& other) { return (*this = static_cast<T>(other)); }
+    SharedField& operator=(const T newValue) { value.store(newValue, std::memory_order_release); return *this; }
+    operator T() const { return value.load(std::memory_order_acquire); }
+    T operator->() const { return value.load(std::memory_order_acquire); }
+};
+#endif
 
-    //Copy Constructor
-    RB_Tree(const RB_Tree&);
+//Snapshot of the work done by a tree since construction or the last call to resetCounters()
+struct OperationCounters
+{
+    unsigned long long leftRotations{ 0 };        //Calls to leftRotate
+    unsigned long long rightRotations{ 0 };       //Calls to rightRotate
+    unsigned long long insertFixupCase1{ 0 };     //insertFixup iterations that recolored (red uncle)
+    unsigned long long insertFixupCase2{ 0 };     //insertFixup iterations that needed the extra rotation of case 2
+    unsigned long long insertFixupCase3{ 0 };     //insertFixup iterations that ended with the case 3 rotation
+    unsigned long long deleteFixupCase1{ 0 };     //deleteFixup iterations with a red sibling
+    unsigned long long deleteFixupCase2{ 0 };     //deleteFixup iterations that recolored the sibling and moved up
+    unsigned long long deleteFixupCase3{ 0 };     //deleteFixup iterations that rotated the sibling (case 3)
+    unsigned long long deleteFixupCase4{ 0 };     //deleteFixup iterations that terminated with case 4
+    unsigned long long searchComparisons{ 0 };    //Key comparisons made by search
+    unsigned long long insertComparisons{ 0 };    //Key comparisons made while finding insert positions
+    unsigned long long nodeAllocations{ 0 };      //Nodes allocated, not counting the NIL node
+    unsigned long long nodeFrees{ 0 };            //Nodes freed, not counting the NIL node
+    unsigned long long maxDescentDepth{ 0 };      //Most nodes visited by a single search or insert descent
+    unsigned long long filterRejections{ 0 };     //Lookups the membership filter answered without searching
+    unsigned long long filterRebuilds{ 0 };       //Times the membership filter was resized and refilled
+    unsigned long long evictions{ 0 };            //Keys a bounded tree removed to make room for larger or smaller ones
+    unsigned long long capacityRejections{ 0 };   //Inserts a full bounded tree turned away, since their key would be evicted
+};
 
-    //Destructor
-    ~RB_Tree();
+//Work done by finger searches, as reported by RB_Tree::getFingerStats()
+struct FingerStats
+{
+    unsigned long long lookups{ 0 };        //Searches that started from the finger
+    unsigned long long hits{ 0 };           //Searches that found the key's range below the root, so never reached it
+    unsigned long long nodesVisited{ 0 };   //Nodes the searches climbed to and descended through
 
-	//Public member functions
-    void insert(const keyType x);
-    bool remove(const keyType x);
-    bool containsKey(const keyType x) const;
-    bool isEmpty() const;
-    unsigned getNumRedNodes() const;
-    unsigned getNumBlackNodes() const;
-    unsigned getNumNodes() const;
-    int getTreeHeight() const;
-    void statistics() const;
-    void destroyTree();
-	void displayTree(const Order) const;
+    double hitRate() const
+    {
+        return (lookups == 0) ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+    }
+};
 
-    //Overloaded Operators
-    RB_Tree<keyType>& operator=(const RB_Tree<keyType>&);
-	RB_Tree<keyType> operator+(const RB_Tree<keyType>&) const;
-	RB_Tree<keyType>& operator+=(const RB_Tree<keyType>&);
-	bool operator==(const RB_Tree&) const;
-	bool operator!=(const RB_Tree&) const;
+//Breakdown of the heap memory held by a tree, as reported by RB_Tree::memoryUsage()
+struct MemoryUsage
+{
+    std::size_t nodeBytes{ 0 };         //Size of the nodes holding keys, including padding
+    std::size_t sentinelBytes{ 0 };     //Size of the NIL node, which RB_Tree keeps in the tree object
+    std::size_t allocatorBytes{ 0 };    //Estimated allocator headers and rounding for every node allocation
+    std::size_t keyHeapBytes{ 0 };      //Heap memory owned by the keys themselves, as reported by KeyHeapUsage
+    std::size_t filterBytes{ 0 };       //Bits of the membership filter, 0 unless it is enabled
+    std::size_t indexBytes{ 0 };        //Slots of the hash index, 0 unless it is enabled
+
+    std::size_t totalBytes() const
+    {
+        return nodeBytes + sentinelBytes + allocatorBytes + keyHeapBytes + filterBytes + indexBytes;
+    }
 };
 
-//***************************************************
-//		Private member function definitions
-//***************************************************
-/// <summary>
-/// Replaces one subtree as a child of its parent with another subtree.
-/// Replaces the subtree rooted at node u with the subtree rooted at node v
-/// </summary>
-/// <param name="u"> A pointer to the node being replaced </param>
-/// <param name="v"> A pointer to the node replacing v in the tree </param>
+//Customization point describing heap memory owned by a key. Specialize it for key types that allocate, setting
+//ownsHeap to true. bytes reports the memory a key owns and shrink releases any spare capacity it holds.
 template<typename keyType>
-void RB_Tree<keyType>::transplant(RB_Node* const u, RB_Node* const v)
+struct KeyHeapUsage
 {
-    //Check if we want to transplant the root, a left child or a right child
-    if (u->parent == NIL)
+    static constexpr bool ownsHeap{ false };
+
+    static std::size_t bytes(const keyType&)
     {
-        //v becomes the new root
-        root = v;
+        return 0;
     }
-    else if (u == u->parent->left)
+
+    static void shrink(keyType&)
     {
-        //v becomes the left child of u's parent
-        u->parent->left = v;
     }
-    else
+};
+
+//Strings own a heap buffer once they outgrow the buffer inside the string object
+template<typename charType, typename traits, typename allocator>
+struct KeyHeapUsage<std::basic_string<charType, traits, allocator>>
+{
+    static constexpr bool ownsHeap{ true };
+
+    static std::size_t bytes(const std::basic_string<charType, traits, allocator>& key)
     {
-        //v becomes the right child of u's parent
-        u->parent->right = v;
+        const std::size_t inlineCapacity{ std::basic_string<charType, traits, allocator>{}.capacity() };
+        return (key.capacity() > inlineCapacity) ? (key.capacity() + 1) * sizeof(charType) : 0;
     }
 
-    //set v's parent to u's parent
-    //Note: Even if v is NIL this operation will not cause problems
-    v->parent = u->parent;
-}
+    static void shrink(std::basic_string<charType, traits, allocator>& key)
+    {
+        key.shrink_to_fit();
+    }
+};
 
-/// <summary>
-/// Searches the tree for a specified key value. Returns NIL if the value is not found.
-/// </summary>
-/// <param name="traverse"> A pointer used to a node in the tree. This pointer traverses the tree being searched. </param>
-/// <param name="keyValue"> The value being searched for in the tree. </param>
-/// <returns> A pointer to the node containing the specified key value. </returns>
-template<typename keyType>
-typename RB_Tree<keyType>::RB_Node* RB_Tree<keyType>::search(RB_Node* traverse, const keyType& keyValue) const
+//Customization point giving the hash the membership filter and the hash index use for a key. Keys std::hash supports are hashed with
+//it. Specialize it for other key types, setting available to true. Keys that compare equal must hash equally.
+template<typename keyType, typename = void>
+struct KeyHash
 {
-	//Continue to search for the value as long as traverse does not point to NIL or 
-	//the node with the key being searched for
-    while (traverse != NIL && keyValue != traverse->key)
+    static constexpr bool available{ false };
+
+    static std::uint64_t hash(const keyType&)
     {
-		//Determine if the key being searched for might be in the current node's left or right subtree
-        if (keyValue < traverse->key)
-        {
-            traverse = traverse->left;
-        }
-        else
-        {
-            traverse = traverse->right;
-        }
+        return 0;
     }
+};
 
-	//Return either NIL or a pointer to the node with the specified key
-    return traverse;
-}
-
-/// <summary>
-/// Returns a pointer to the node with the smallest value in the tree.
-/// </summary>
-/// <param name="traverse"> Pointer that traverses the tree until the minimum is reached. </param>
-/// <returns> Pointer to the node with the smallest value in the tree. </returns>
 template<typename keyType>
-typename RB_Tree<keyType>::RB_Node* RB_Tree<keyType>::minimum(RB_Node* traverse) const
+struct KeyHash<keyType, std::void_t<decltype(std::hash<keyType>{}(std::declval<const keyType&>()))>>
 {
-	//As long as the current node contains a left child, move the pointer to the left child
-    while (traverse->left != NIL)
+    static constexpr bool available{ true };
+
+    static std::uint64_t hash(const keyType& key)
     {
-        traverse = traverse->left;
+        return static_cast<std::uint64_t>(std::hash<keyType>{}(key));
     }
+};
 
-	return traverse;
+//Closed interval [low, high] used as the key of an interval tree. low must not be greater than high. Intervals are
+//ordered by their low endpoint and then by their high endpoint.
+template<typename endpointType>
+struct Interval
+{
+    endpointType low;   //Start of the interval
+    endpointType high;  //End of the interval, included in it
+
+    bool operator<(const Interval& other) const
+    {
+        return (low < other.low) || (!(other.low < low) && high < other.high);
+    }
+
+    bool operator==(const Interval& other) const
+    {
+        return !(low < other.low) && !(other.low < low) && !(high < other.high) && !(other.high < high);
+    }
+
+    bool operator!=(const Interval& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+template<typename endpointType>
+std::ostream& operator<<(std::ostream& out, const Interval<endpointType>& interval)
+{
+    return out << '[' << interval.low << ", " << interval.high << ']';
 }
 
-//NOTE: An exception is thrown if the pivot's right child is NIL
-/// <summary>
-/// Performs a left rotation about the pivot node. Assumes the pivot's right child is not NIL.
-/// Only node pointers are changed, no other attributes are affected.
-/// The pivot's right child takes the pivot's position in the tree. The pivot becomes the left child of its right child.
-/// The left subtree of the pivot's right child becomes the pivot's right subtree.
-/// </summary>
-/// <param name="pivot"> A pointer to the node the rotation takes place about. </param>
+//Tells RB_Tree whether its keys are intervals. A tree of Interval keys keeps the largest high endpoint of every
+//subtree in its nodes and answers overlapping queries.
 template<typename keyType>
-void RB_Tree<keyType>::leftRotate(RB_Node* const pivot)
+struct IntervalTraits
 {
-    //If pivot is the NIL node, the rotation does nothing
-    if (pivot != NIL)
-    {
-        RB_Node* const prc{ pivot->right };    //The pivot's right child. Becomes the root of the rotated subtree
+    static constexpr bool isInterval{ false };
+    using endpointType = keyType;
+};
 
-        //If pivot's right child is the NIL node then the rotation will break the tree at the position
-        //of the pivot. An exception is thrown to prevent the rotated subtree from being cut off.
-        if (prc == NIL)
-        {
-            throw std::exception{ "ERROR: The pivot's right child cannot be NIL." };
-        }
+template<typename endpoint>
+struct IntervalTraits<Interval<endpoint>>
+{
+    static constexpr bool isInterval{ true };
+    using endpointType = endpoint;
+};
 
-        //prc's left subtree becomes the pivot's right subtree
-        pivot->right = prc->left;
+//Thread that frees the nodes trees using Teardown::BACKGROUND hand off, shared by every tree. It starts with the first
+//hand-off and is never destroyed, so trees destroyed during static destruction can still hand off their nodes. Call
+//drain() before destroying anything a pending hand-off uses, such as the memory resource of a pmr tree.
+class BackgroundReclaimer
+{
+private:
+    std::mutex lock;                        //Guards jobs and busy
+    std::condition_variable jobsReady;      //Signalled when a job is queued
+    std::condition_variable jobsDone;       //Signalled when the queue is empty and no job is running
+    std::deque<std::function<void()>> jobs; //Hand-offs waiting to be freed, oldest first
+    bool busy;                              //True while the thread runs a job
 
-        //If prc's left subtree is not NIL, the pivot becomes the parent of prc's left subtree
-        if (prc->left != NIL)
-        {
-            prc->left->parent = pivot;
-        }
+    BackgroundReclaimer();
+    void run();
 
-        //Determine if the pivot is the root, a left child, or a right child. The pivot's right child becomes the
-        //tree's new root if the pivot is the tree's root, otherwise it becomes the child of the pivot's parent
-        if (pivot->parent == NIL)
-        {
-            root = prc;
-        }
-        else if (pivot == pivot->parent->left)
-        {
-            pivot->parent->left = prc;
-        }
-        else //if (pivot == pivot->parent->right)
-        {
-            pivot->parent->right = prc;
-        }
+public:
+    BackgroundReclaimer(const BackgroundReclaimer&) = delete;
+    BackgroundReclaimer& operator=(const BackgroundReclaimer&) = delete;
 
-        //The pivot's parent becomes the parent of the pivot's right child
-        prc->parent = pivot->parent;
+    static BackgroundReclaimer& instance();
+    void submit(std::function<void()> job);
+    void drain();
+};
 
-        //The pivot becomes the left child of prc
-        prc->left = pivot;
-        pivot->parent = prc;
-    }
+/// <summary>
+/// Starts the reclaimer thread. The thread is detached because the reclaimer is never destroyed.
+/// </summary>
+inline BackgroundReclaimer::BackgroundReclaimer() : busy{ false }
+{
+    std::thread{ &BackgroundReclaimer::run, this }.detach();
 }
 
-//NOTE: An exception is thrown if the pivot's left child is NIL
 /// <summary>
-/// Performs a right rotation about the pivot node. Assumes the pivot's left child is not NIL.
-/// Only node pointers are changed. No other attributes are affected.
-/// The pivot's left child takes the pivot's position in the tree. The pivot becomes the right child of its left child.
-/// The right subtree of the pivot's left child becomes the pivot's left subtree.
+/// Body of the reclaimer thread. Runs queued jobs one at a time, oldest first, without holding the lock.
 /// </summary>
-/// <param name="pivot"> A pointer to the node the rotation takes place about. </param>
-template<typename keyType>
-void RB_Tree<keyType>::rightRotate(RB_Node* const pivot)
+inline void BackgroundReclaimer::run()
 {
-    //If pivot is the NIL node, the rotation does nothing
-    if (pivot != NIL)
-    {
-        RB_Node* plc{ pivot->left };    //The pivot's left child. Becomes the root of the rotated subtree
+    std::unique_lock<std::mutex> guard{ lock };
 
-        //If pivot's left child is the NIL node then the rotation will break the tree at the position
-         //of the pivot. An exception is thrown to prevent the rotated subtree from being cut off.
-        if (plc == NIL)
-        {
-            throw std::exception{ "ERROR: The pivot's left child cannot be NIL." };
-        }
+    while (true)
+    {
+        jobsReady.wait(guard, [this] { return !jobs.empty(); });
 
-        //The right subtree of plc becomes pivot's left subtree
-        pivot->left = plc->right;
+        std::function<void()> job{ std::move(jobs.front()) };
+        jobs.pop_front();
+        busy = true;
+        guard.unlock();
 
-        //If plc's right subtree is not NIL, its parent becomes the pivot
-        if (plc->right != NIL)
-        {
-            plc->right->parent = pivot;
-        }
+        job();
+        job = nullptr;
 
-        //Determine if the pivot is the root of the tree, a right child, or a left child. If the pivot is
-        //the root, plc becomes the new root, otherwise the parent of the pivot becomes plc's parent
-        if (pivot->parent == NIL)
-        {
-            root = plc;
-        }
-        else if (pivot == pivot->parent->left)
-        {
-            pivot->parent->left = plc;
-        }
-        else //if (pivot == pivot->parent->right)
+        guard.lock();
+        busy = false;
+        if (jobs.empty())
         {
-            pivot->parent->right = plc;
+            jobsDone.notify_all();
         }
+    }
+}
 
-        //The pivot's parent becomes plc's parent
-        plc->parent = pivot->parent;
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Accesses the reclaimer shared by every tree, starting it on first use. It is allocated and never freed, see the
+/// class comment.
+/// </summary>
+/// <returns> A reference to the reclaimer. </returns>
+inline BackgroundReclaimer& BackgroundReclaimer::instance()
+{
+    static BackgroundReclaimer* const reclaimer{ new BackgroundReclaimer };
+    return *reclaimer;
+}
 
-        //The pivot becomes plc's right child
-        plc->right = pivot;
-        pivot->parent = plc;
+/// <summary>
+/// Queues a job for the reclaimer thread and returns without waiting for it.
+/// </summary>
+/// <param name="job"> The work to run on the reclaimer thread. </param>
+inline void BackgroundReclaimer::submit(std::function<void()> job)
+{
+    {
+        std::lock_guard<std::mutex> guard{ lock };
+        jobs.push_back(std::move(job));
     }
+    jobsReady.notify_one();
 }
 
 /// <summary>
-/// Restores the properties of Red-Black trees after an insertion is made.
+/// Waits until every job queued so far has finished.
 /// </summary>
-/// <param name="insertedNode"> A pointer to the node being inserted </param>
-template<typename keyType>
-void RB_Tree<keyType>::insertFixup(RB_Node* insertedNode)
+inline void BackgroundReclaimer::drain()
 {
-    //Increment the number of red nodes
-    ++numRedNodes;
+    std::unique_lock<std::mutex> guard{ lock };
+    jobsDone.wait(guard, [this] { return jobs.empty() && !busy; });
+}
 
-    //Note: The inserted node is always red.
-    //If the inserted node's parent is red we are in violation the property 4
-    while (insertedNode->parent->nodeColor == Color::RED)
+/// <summary>
+/// Spreads the bits of a hash, since std::hash of an integer is often the integer itself. This is the finalizer of
+/// MurmurHash3.
+/// </summary>
+/// <param name="hash"> The key's hash. </param>
+/// <returns> The mixed hash. </returns>
+inline std::uint64_t mixHash(std::uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xFF51AFD7ED558CCDull;
+    hash ^= hash >> 33;
+    hash *= 0xC4CEB9FE1A85EC53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+//Blocked Bloom filter in front of a tree's lookups, see RB_Tree::setMembershipFilter. A key sets one bit in each of
+//the eight words of a single 64 byte block, so testing a key reads one cache line. The filter is sized for a number
+//of keys and is meant to be refilled from the tree once more keys than that have been added. Bits are never
+//cleared, so a removed key only raises the false positive rate until then. Keys go in as hashes.
+class MembershipFilter
+{
+private:
+    struct alignas(64) Block
+    {
+        std::uint64_t words[8];
+    };
+
+    std::vector<Block> blocks;  //The filter's bits, empty while it holds nothing
+    unsigned bitsPerKey;        //Bits per key the filter is sized with, 0 while it is disabled
+    unsigned capacity;          //Keys the blocks were sized for
+    unsigned numAdded;          //Keys added since the blocks were sized, removed keys included
+
+    //Odd multipliers taking the bit set in each word from the low half of a key's hash
+    static constexpr std::uint32_t salts[8]{ 0x47B6137Bu, 0x44974D91u, 0x8824AD5Bu, 0xA2B7289Du,
+                                             0x705495C7u, 0x2DF1424Bu, 0x9EFC4947u, 0x5C6BFB31u };
+
+public:
+    MembershipFilter();
+
+    void setBitsPerKey(const unsigned bits);
+    void reset(const unsigned keys);
+    void clear();
+    void add(const std::uint64_t hash);
+    bool mayContain(const std::uint64_t hash) const;
+    bool isEnabled() const;
+    unsigned getBitsPerKey() const;
+    bool isFull() const;
+    std::size_t bytes() const;
+};
+
+/// <summary>
+/// Creates a disabled filter holding no bits.
+/// </summary>
+inline MembershipFilter::MembershipFilter() : bitsPerKey{ 0 }, capacity{ 0 }, numAdded{ 0 }
+{
+}
+
+/// <summary>
+/// Sets the bits per key and drops the bits held. 0 disables the filter.
+/// </summary>
+/// <param name="bits"> Bits of filter per key it is sized for. </param>
+inline void MembershipFilter::setBitsPerKey(const unsigned bits)
+{
+    clear();
+    bitsPerKey = bits;
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Replaces the bits with an empty filter sized for a number of keys. If the allocation throws the filter is unchanged.
+/// </summary>
+/// <param name="keys"> The number of keys the filter is sized for. </param>
+inline void MembershipFilter::reset(const unsigned keys)
+{
+    const std::size_t bits{ static_cast<std::size_t>(keys) * bitsPerKey };
+    std::vector<Block> sized(std::max<std::size_t>(1, (bits + 511) / 512), Block{});
+
+    blocks.swap(sized);
+    capacity = keys;
+    numAdded = 0;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Frees the bits. The filter lets every key through until it is reset.
+/// </summary>
+inline void MembershipFilter::clear()
+{
+    std::vector<Block>{}.swap(blocks);
+    capacity = 0;
+    numAdded = 0;
+}
+
+/// <summary>
+/// Sets the bits of a key. A filter with no bits ignores it.
+/// </summary>
+/// <param name="hash"> The key's hash. </param>
+inline void MembershipFilter::add(const std::uint64_t hash)
+{
+    if (blocks.empty())
+    {
+        return;
+    }
+
+    //The high half picks the block, the low half the bit in each word
+    const std::uint64_t mixed{ mixHash(hash) };
+    Block& block{ blocks[static_cast<std::size_t>(((mixed >> 32) * blocks.size()) >> 32)] };
+    const std::uint32_t low{ static_cast<std::uint32_t>(mixed) };
+
+    for (unsigned i{ 0 }; i < 8; ++i)
+    {
+        block.words[i] |= 1ull << ((low * salts[i]) >> 26);
+    }
+    ++numAdded;
+}
+
+/// <summary>
+/// Tests the bits of a key. False means the key was never added since the filter was reset. A filter with no bits
+/// returns true for every key.
+/// </summary>
+/// <param name="hash"> The key's hash. </param>
+/// <returns> False if the key is certainly absent, true if it may be present. </returns>
+inline bool MembershipFilter::mayContain(const std::uint64_t hash) const
+{
+    if (blocks.empty())
+    {
+        return true;
+    }
+
+    const std::uint64_t mixed{ mixHash(hash) };
+    const Block& block{ blocks[static_cast<std::size_t>(((mixed >> 32) * blocks.size()) >> 32)] };
+    const std::uint32_t low{ static_cast<std::uint32_t>(mixed) };
+
+    //Combining the words without branching keeps the probe to one predictable branch
+    std::uint64_t missing{ 0 };
+    for (unsigned i{ 0 }; i < 8; ++i)
+    {
+        missing |= ~block.words[i] & (1ull << ((low * salts[i]) >> 26));
+    }
+    return missing == 0;
+}
+
+/// <summary>
+/// Tells whether the filter is enabled, whether or not it holds bits yet.
+/// </summary>
+/// <returns> True if bits per key is not 0. </returns>
+inline bool MembershipFilter::isEnabled() const
+{
+    return bitsPerKey != 0;
+}
+
+/// <summary>
+/// Returns the bits per key the filter is sized with.
+/// </summary>
+/// <returns> The bits per key, 0 while the filter is disabled. </returns>
+inline unsigned MembershipFilter::getBitsPerKey() const
+{
+    return bitsPerKey;
+}
+
+/// <summary>
+/// Tells whether the filter should be refilled before adding another key: it holds no bits, or as many keys as it
+/// was sized for.
+/// </summary>
+/// <returns> True if the filter is full. </returns>
+inline bool MembershipFilter::isFull() const
+{
+    return blocks.empty() || numAdded >= capacity;
+}
+
+/// <summary>
+/// Returns the heap memory held by the filter's bits.
+/// </summary>
+/// <returns> The size of the blocks in bytes. </returns>
+inline std::size_t MembershipFilter::bytes() const
+{
+    return blocks.capacity() * sizeof(Block);
+}
+
+//Hash index from keys to the nodes holding them, see RB_Tree::setHashIndex. Open addressing with linear probing over
+//a power of two number of slots. Next to each slot is a one byte tag: 0 while the slot is empty, 1 once its entry
+//has been removed, and otherwise the top bit with seven bits of the key's hash, so a probe only reads the nodes whose
+//tag matches. Every node linked into the tree has an entry, tombstones and equal keys included. The table doubles
+//once three quarters of its slots are in use, dropping the removed entries.
+template<typename keyType, typename nodeType>
+class NodeIndex
+{
+private:
+    static constexpr std::uint8_t emptyTag{ 0 };
+    static constexpr std::uint8_t removedTag{ 1 };
+
+    std::vector<nodeType*> slots;       //Node of each slot, meaningful where the tag marks an entry
+    std::vector<std::uint8_t> tags;     //State of each slot and seven bits of the hash of its key
+    std::size_t numEntries;             //Slots holding a node
+    std::size_t numUsed;                //Slots holding a node or a removed entry
+    bool enabled;                       //True while the tree keeps the index up to date
+
+    static std::uint64_t hashOf(const keyType& key);
+    static std::uint8_t tagOf(const std::uint64_t mixed);
+    std::size_t slotOf(const nodeType* const node) const;
+    void place(nodeType* const node);
+
+public:
+    NodeIndex();
+
+    void setEnabled(const bool on);
+    void reset(const std::size_t keys);
+    void clear();
+    void add(nodeType* const node);
+    void erase(const nodeType* const node);
+    void exchange(nodeType* const a, nodeType* const b);
+    nodeType* find(const keyType& key) const;
+    bool isEnabled() const;
+    std::size_t bytes() const;
+};
+
+/// <summary>
+/// Creates a disabled index holding no slots.
+/// </summary>
+template<typename keyType, typename nodeType>
+NodeIndex<keyType, nodeType>::NodeIndex() : numEntries{ 0 }, numUsed{ 0 }, enabled{ false }
+{
+}
+
+/// <summary>
+/// Returns the mixed hash of a key, whose low bits pick its first slot and whose high bits make its tag.
+/// </summary>
+/// <param name="key"> The key. </param>
+/// <returns> The mixed hash. </returns>
+template<typename keyType, typename nodeType>
+std::uint64_t NodeIndex<keyType, nodeType>::hashOf(const keyType& key)
+{
+    return mixHash(KeyHash<keyType>::hash(key));
+}
+
+/// <summary>
+/// Returns the tag of an entry from its mixed hash.
+/// </summary>
+/// <param name="mixed"> The mixed hash of the entry's key. </param>
+/// <returns> The top bit and the seven highest bits of the hash. </returns>
+template<typename keyType, typename nodeType>
+std::uint8_t NodeIndex<keyType, nodeType>::tagOf(const std::uint64_t mixed)
+{
+    return static_cast<std::uint8_t>(0x80 | (mixed >> 57));
+}
+
+/// <summary>
+/// Finds the slot of a node's entry, comparing addresses rather than keys. The node must have an entry.
+/// </summary>
+/// <param name="node"> The node. </param>
+/// <returns> The index of its slot. </returns>
+template<typename keyType, typename nodeType>
+std::size_t NodeIndex<keyType, nodeType>::slotOf(const nodeType* const node) const
+{
+    const std::uint64_t mixed{ hashOf(node->key) };
+    const std::uint8_t tag{ tagOf(mixed) };
+    const std::size_t mask{ slots.size() - 1 };
+
+    std::size_t slot{ static_cast<std::size_t>(mixed) & mask };
+    while (tags[slot] != tag || slots[slot] != node)
+    {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/// <summary>
+/// Puts an entry for a node in the first slot that does not hold one, without growing the table.
+/// </summary>
+/// <param name="node"> The node. </param>
+template<typename keyType, typename nodeType>
+void NodeIndex<keyType, nodeType>::place(nodeType* const node)
+{
+    const std::uint64_t mixed{ hashOf(node->key) };
+    const std::size_t mask{ slots.size() - 1 };
+
+    std::size_t slot{ static_cast<std::size_t>(mixed) & mask };
+    while (tags[slot] != emptyTag && tags[slot] != removedTag)
+    {
+        slot = (slot + 1) & mask;
+    }
+
+    numUsed += (tags[slot] == emptyTag) ? 1 : 0;
+    ++numEntries;
+    tags[slot] = tagOf(mixed);
+    slots[slot] = node;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Turns the index on or off and drops its entries. The tree refills an index it turns on.
+/// </summary>
+/// <param name="on"> True to enable the index. </param>
+template<typename keyType, typename nodeType>
+void NodeIndex<keyType, nodeType>::setEnabled(const bool on)
+{
+    clear();
+    enabled = on;
+}
+
+//NOTE: Memory is allocated and freed in this function
+/// <summary>
+/// Replaces the entries with an empty table of at least twice as many slots as a number of keys. If the allocation
+/// throws the index is unchanged.
+/// </summary>
+/// <param name="keys"> The number of keys the table is sized for. </param>
+template<typename keyType, typename nodeType>
+void NodeIndex<keyType, nodeType>::reset(const std::size_t keys)
+{
+    std::size_t numSlots{ 16 };
+    while (numSlots < 2 * keys)
+    {
+        numSlots *= 2;
+    }
+
+    std::vector<nodeType*> sizedSlots(numSlots, nullptr);
+    std::vector<std::uint8_t> sizedTags(numSlots, emptyTag);
+
+    slots.swap(sizedSlots);
+    tags.swap(sizedTags);
+    numEntries = 0;
+    numUsed = 0;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Frees the slots. The index keeps its setting and finds nothing until nodes are added.
+/// </summary>
+template<typename keyType, typename nodeType>
+void NodeIndex<keyType, nodeType>::clear()
+{
+    std::vector<nodeType*>{}.swap(slots);
+    std::vector<std::uint8_t>{}.swap(tags);
+    numEntries = 0;
+    numUsed = 0;
+}
+
+//NOTE: Memory is allocated and freed in this function
+/// <summary>
+/// Adds an entry for a node. A table three quarters in use is first rebuilt with twice as many slots as entries,
+/// which keeps the cost amortized O(1). Throws std::bad_alloc, leaving the index unchanged, if that fails.
+/// </summary>
+/// <param name="node"> The node. </param>
+template<typename keyType, typename nodeType>
+void NodeIndex<keyType, nodeType>::add(nodeType* const node)
+{
+    if (4 * (numUsed + 1) > 3 * slots.size())
+    {
+        std::vector<nodeType*> oldSlots;
+        std::vector<std::uint8_t> oldTags;
+        const std::size_t keys{ numEntries + 1 };
+
+        oldSlots.swap(slots);
+        oldTags.swap(tags);
+        try
+        {
+            reset(keys);
+        }
+        catch (...)
+        {
+            slots.swap(oldSlots);
+            tags.swap(oldTags);
+            throw;
+        }
+
+        for (std::size_t slot{ 0 }; slot < oldSlots.size(); ++slot)
+        {
+            if (oldTags[slot] != emptyTag && oldTags[slot] != removedTag)
+            {
+                place(oldSlots[slot]);
+            }
+        }
+    }
+
+    place(node);
+}
+
+/// <summary>
+/// Removes the entry of a node. The slot becomes empty again if it ends a probe sequence. An index with no slots
+/// ignores the call.
+/// </summary>
+/// <param name="node"> The node, which must have an entry. </param>
+template<typename keyType, typename nodeType>
+void NodeIndex<keyType, nodeType>::erase(const nodeType* const node)
+{
+    if (slots.empty())
+    {
+        return;
+    }
+
+    const std::size_t slot{ slotOf(node) };
+
+    if (tags[(slot + 1) & (slots.size() - 1)] == emptyTag)
+    {
+        tags[slot] = emptyTag;
+        --numUsed;
+    }
+    else
+    {
+        tags[slot] = removedTag;
+    }
+    --numEntries;
+}
+
+/// <summary>
+/// Swaps the entries of two nodes whose contents are about to be swapped, so each key keeps pointing to the node
+/// that will hold it. An index with no slots ignores the call.
+/// </summary>
+/// <param name="a"> The first node, which must have an entry. </param>
+/// <param name="b"> The second node, which must have an entry. </param>
+template<typename keyType, typename nodeType>
+void NodeIndex<keyType, nodeType>::exchange(nodeType* const a, nodeType* const b)
+{
+    if (slots.empty())
+    {
+        return;
+    }
+
+    std::swap(slots[slotOf(a)], slots[slotOf(b)]);
+}
+
+/// <summary>
+/// Finds a node holding a key. Which one is unspecified when several nodes hold it.
+/// </summary>
+/// <param name="key"> The key being searched for. </param>
+/// <returns> A node holding the key, which may be a tombstone, or nullptr. </returns>
+template<typename keyType, typename nodeType>
+nodeType* NodeIndex<keyType, nodeType>::find(const keyType& key) const
+{
+    if (slots.empty())
+    {
+        return nullptr;
+    }
+
+    const std::uint64_t mixed{ hashOf(key) };
+    const std::uint8_t tag{ tagOf(mixed) };
+    const std::size_t mask{ slots.size() - 1 };
+
+    for (std::size_t slot{ static_cast<std::size_t>(mixed) & mask }; tags[slot] != emptyTag; slot = (slot + 1) & mask)
+    {
+        if (tags[slot] == tag && key == slots[slot]->key)
+        {
+            return slots[slot];
+        }
+    }
+    return nullptr;
+}
+
+/// <summary>
+/// Tells whether the tree keeps the index up to date.
+/// </summary>
+/// <returns> True if the index is enabled. </returns>
+template<typename keyType, typename nodeType>
+bool NodeIndex<keyType, nodeType>::isEnabled() const
+{
+    return enabled;
+}
+
+/// <summary>
+/// Returns the heap memory held by the index's slots and tags.
+/// </summary>
+/// <returns> The size of the table in bytes. </returns>
+template<typename keyType, typename nodeType>
+std::size_t NodeIndex<keyType, nodeType>::bytes() const
+{
+    return slots.capacity() * sizeof(nodeType*) + tags.capacity();
+}
+
+//Writes the operations of one or more trees of the same type to a binary trace, in the order they were called. The
+//trace starts with a 12 byte header: the characters RBTR, the format version, the Duplicates and Balance of the tree
+//as one byte each, a zero byte and the key size as 4 bytes. Every operation follows as its OpType in one byte, the
+//nanoseconds since the previous operation as an unsigned LEB128 varint and the bytes of the key. Numbers are in the
+//byte order of the recording machine. Records are buffered and written in blocks; write errors are left in the state
+//of the stream. A recorder is not thread safe.
+class TraceRecorder
+{
+private:
+    static constexpr std::size_t flushBytes{ 1 << 16 }; //Buffered bytes that trigger a write
+
+    std::ostream& output;                               //Stream receiving the trace
+    std::vector<char> buffer;                           //Bytes not yet written
+    std::chrono::steady_clock::time_point last;         //Time of the previous record, or of begin
+    bool started;                                       //True once the header has been buffered
+    std::uint32_t keySize;                              //Size of the recorded keys
+    Duplicates traceDuplicates;                         //Duplicates policy of the recorded trees
+    Balance traceBalance;                               //Balancing scheme of the recorded trees
+    unsigned long long numRecords;                      //Operations recorded so far
+
+    void appendVarint(unsigned long long);
+
+public:
+    static constexpr std::uint8_t version{ 1 };
+
+    explicit TraceRecorder(std::ostream& output);
+    TraceRecorder(const TraceRecorder&) = delete;
+    TraceRecorder& operator=(const TraceRecorder&) = delete;
+    ~TraceRecorder();
+
+    void begin(const std::size_t size, const Duplicates duplicates, const Balance balance);
+    template<typename keyType>
+    void record(const OpType type, const keyType& key);
+    void flush();
+    unsigned long long getNumRecords() const;
+};
+
+/// <summary>
+/// Creates a recorder writing to a stream, which should be opened in binary mode. Nothing is written until begin.
+/// </summary>
+/// <param name="output"> The stream receiving the trace. It must outlive the recorder. </param>
+inline TraceRecorder::TraceRecorder(std::ostream& output) : output{ output }, started{ false }, keySize{ 0 },
+    traceDuplicates{ Duplicates::MULTI_NODE }, traceBalance{ Balance::RED_BLACK }, numRecords{ 0 }
+{
+    buffer.reserve(flushBytes + 64);
+}
+
+/// <summary>
+/// Writes the records still buffered.
+/// </summary>
+inline TraceRecorder::~TraceRecorder()
+{
+    flush();
+}
+
+/// <summary>
+/// Appends an unsigned LEB128 varint: seven bits per byte, lowest first, with the top bit set on every byte but the
+/// last. Gaps under 128 ns take one byte and gaps under 16 us two.
+/// </summary>
+/// <param name="value"> The number being appended. </param>
+inline void TraceRecorder::appendVarint(unsigned long long value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<char>(value));
+}
+
+/// <summary>
+/// Buffers the header the first time it is called. Later calls only check that the tree records the same type of keys,
+/// so several trees can share a recorder. Throws std::invalid_argument if they differ.
+/// </summary>
+/// <param name="size"> The size of the tree's keys. </param>
+/// <param name="duplicates"> The Duplicates policy of the tree. </param>
+/// <param name="balance"> The balancing scheme of the tree. </param>
+inline void TraceRecorder::begin(const std::size_t size, const Duplicates duplicates, const Balance balance)
+{
+    if (started)
+    {
+        if (size != keySize || duplicates != traceDuplicates || balance != traceBalance)
+        {
+            throw std::invalid_argument{ "ERROR: The trace already records a different type of tree." };
+        }
+        return;
+    }
+
+    keySize = static_cast<std::uint32_t>(size);
+    traceDuplicates = duplicates;
+    traceBalance = balance;
+
+    const char header[8]{ 'R', 'B', 'T', 'R', static_cast<char>(version), static_cast<char>(duplicates),
+                          static_cast<char>(balance), 0 };
+    buffer.insert(buffer.end(), header, header + sizeof(header));
+    const char* const sizeBytes{ reinterpret_cast<const char*>(&keySize) };
+    buffer.insert(buffer.end(), sizeBytes, sizeBytes + sizeof(keySize));
+
+    started = true;
+    last = std::chrono::steady_clock::now();
+}
+
+/// <summary>
+/// Appends one operation to the trace. begin must have been called with the size of keyType.
+/// </summary>
+/// <param name="type"> The kind of operation. </param>
+/// <param name="key"> The key the operation was called with. </param>
+template<typename keyType>
+void TraceRecorder::record(const OpType type, const keyType& key)
+{
+    static_assert(std::is_trivially_copyable<keyType>::value, "Only trivially copyable keys can be traced.");
+
+    if (!started || sizeof(keyType) != keySize)
+    {
+        throw std::logic_error{ "ERROR: The trace recorder was not started for this key type." };
+    }
+
+    const std::chrono::steady_clock::time_point now{ std::chrono::steady_clock::now() };
+    buffer.push_back(static_cast<char>(type));
+    appendVarint(static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count()));
+    last = now;
+
+    const char* const bytes{ reinterpret_cast<const char*>(&key) };
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(keyType));
+    ++numRecords;
+
+    if (buffer.size() >= flushBytes)
+    {
+        flush();
+    }
+}
+
+/// <summary>
+/// Writes the buffered records to the stream and flushes it.
+/// </summary>
+inline void TraceRecorder::flush()
+{
+    if (!buffer.empty())
+    {
+        output.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        buffer.clear();
+    }
+    output.flush();
+}
+
+/// <summary>
+/// Accessor function for the numRecords member
+/// </summary>
+/// <returns> The number of operations recorded. </returns>
+inline unsigned long long TraceRecorder::getNumRecords() const
+{
+    return numRecords;
+}
+
+//Reads a trace written by TraceRecorder one operation at a time. Throws std::runtime_error if the stream does not hold
+//a trace of a known version or ends in the middle of a record.
+class TraceReader
+{
+private:
+    std::istream& input;        //Stream holding the trace
+    std::uint32_t keySize;      //Size of the recorded keys
+    Duplicates traceDuplicates; //Duplicates policy of the recorded trees
+    Balance traceBalance;       //Balancing scheme of the recorded trees
+
+public:
+    explicit TraceReader(std::istream& input);
+
+    std::size_t getKeySize() const;
+    Duplicates getDuplicates() const;
+    Balance getBalance() const;
+    bool next(OpType& type, unsigned long long& nanoseconds, void* const key);
+};
+
+/// <summary>
+/// Reads and checks the header of a trace.
+/// </summary>
+/// <param name="input"> The stream holding the trace, opened in binary mode. It must outlive the reader. </param>
+inline TraceReader::TraceReader(std::istream& input) : input{ input }, keySize{ 0 }
+{
+    char header[8]{};
+    input.read(header, sizeof(header));
+    input.read(reinterpret_cast<char*>(&keySize), sizeof(keySize));
+
+    if (!input || std::memcmp(header, "RBTR", 4) != 0 || header[4] != static_cast<char>(TraceRecorder::version) ||
+        header[5] > static_cast<char>(Duplicates::UNIQUE) || header[6] > static_cast<char>(Balance::WAVL) || keySize == 0)
+    {
+        throw std::runtime_error{ "ERROR: The stream does not hold a trace of a known version." };
+    }
+
+    traceDuplicates = static_cast<Duplicates>(header[5]);
+    traceBalance = static_cast<Balance>(header[6]);
+}
+
+/// <summary>
+/// Accessor function for the keySize member
+/// </summary>
+/// <returns> The size of the recorded keys in bytes. </returns>
+inline std::size_t TraceReader::getKeySize() const
+{
+    return keySize;
+}
+
+/// <summary>
+/// Accessor function for the traceDuplicates member
+/// </summary>
+/// <returns> The Duplicates policy of the recorded trees. </returns>
+inline Duplicates TraceReader::getDuplicates() const
+{
+    return traceDuplicates;
+}
+
+/// <summary>
+/// Accessor function for the traceBalance member
+/// </summary>
+/// <returns> The balancing scheme of the recorded trees. </returns>
+inline Balance TraceReader::getBalance() const
+{
+    return traceBalance;
+}
+
+/// <summary>
+/// Reads the next operation of the trace.
+/// </summary>
+/// <param name="type"> Receives the kind of operation. </param>
+/// <param name="nanoseconds"> Receives the time since the previous operation was called. </param>
+/// <param name="key"> Receives the bytes of the key, getKeySize() of them. </param>
+/// <returns> True if an operation was read, false at the end of the trace. </returns>
+inline bool TraceReader::next(OpType& type, unsigned long long& nanoseconds, void* const key)
+{
+    const int typeByte{ input.get() };
+    if (typeByte == std::char_traits<char>::eof())
+    {
+        return false;
+    }
+    if (typeByte > static_cast<int>(OpType::CONTAINS))
+    {
+        throw std::runtime_error{ "ERROR: The trace holds an unknown operation." };
+    }
+    type = static_cast<OpType>(typeByte);
+
+    nanoseconds = 0;
+    for (int shift{ 0 }; ; shift += 7)
+    {
+        const int byte{ input.get() };
+        if (byte == std::char_traits<char>::eof() || shift > 63)
+        {
+            throw std::runtime_error{ "ERROR: The trace ends in the middle of an operation." };
+        }
+        nanoseconds |= static_cast<unsigned long long>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0)
+        {
+            break;
+        }
+    }
+
+    input.read(static_cast<char*>(key), keySize);
+    if (!input)
+    {
+        throw std::runtime_error{ "ERROR: The trace ends in the middle of an operation." };
+    }
+
+    return true;
+}
+
+//Nodes are obtained from Allocator, rebound to the node type through std::allocator_traits, which also decides whether
+//the allocator follows the tree through copies, moves and swaps. Its pointer type must be a raw pointer.
+template<typename keyType, Duplicates duplicates = Duplicates::MULTI_NODE, Balance balance = Balance::RED_BLACK,
+         typename Allocator = std::allocator<keyType>>
+class RB_Tree
+{
+private:
+
+    //Repeat count of a node's key. Only nodes of a tree using Duplicates::COUNTED carry one.
+    struct KeyCount
+    {
+        unsigned count;     //Number of copies of the key stored in the node, at least 1
+    };
+    struct NoKeyCount
+    {
+    };
+
+    //Rank of a node in an AVL or WAVL tree. For AVL the rank is the height of the node's subtree, for both schemes
+    //leaves have rank 0 and the NIL node has rank -1. Red-Black trees use the node color instead.
+    struct NodeRank
+    {
+        signed char rank;
+    };
+    struct NoNodeRank
+    {
+    };
+
+    using endpointType = typename IntervalTraits<keyType>::endpointType;
+    static constexpr bool intervalKeys{ IntervalTraits<keyType>::isInterval };
+
+    //Largest high endpoint of the intervals in a node's subtree, tombstones included. Only nodes of a tree of
+    //Interval keys carry one. It lets an overlap query skip every subtree that ends before the query starts.
+    struct MaxEndpoint
+    {
+        endpointType maxHigh;
+    };
+    struct NoMaxEndpoint
+    {
+    };
+
+    //Types of the node fields concurrent readers follow. Plain fields unless RB_TREE_CONCURRENT_READS is enabled.
+    struct RB_Node;
+#if RB_TREE_CONCURRENT_READS
+    using Link = SharedField<RB_Node*>;
+    using Flag = SharedField<bool>;
+    using Version = SharedField<unsigned>;
+#else
+    using Link = RB_Node*;
+    using Flag = bool;
+#endif
+
+	//Red-Black tree node structure
+    struct RB_Node : std::conditional<duplicates == Duplicates::COUNTED, KeyCount, NoKeyCount>::type,
+                     std::conditional<balance == Balance::RED_BLACK, NoNodeRank, NodeRank>::type,
+                     std::conditional<intervalKeys, MaxEndpoint, NoMaxEndpoint>::type
+    {
+        Color nodeColor;    //Color of the node. Either Color::RED or Color::BLACK. Always black in AVL and WAVL trees
+        Flag tombstone;     //True if the node's key was removed in lazy deletion mode but the node is still linked
+#if RB_TREE_CONCURRENT_READS
+        Version version;    //Odd while the writer rewrites the node's links, advanced by two for every change
+#endif
+        keyType key;        //Data contained in the node
+        Link parent;        //Pointer to the node's parent
+        Link left;          //Pointer to the node's left child
+        Link right;         //Pointer to the node's right child
+
+        RB_Node() = default;
+
+        //Constructs the key in place from the arguments, leaving the other fields for resetLinks to set
+        template<typename... Args>
+        explicit RB_Node(std::in_place_t, Args&&... args) : key(std::forward<Args>(args)...) {}
+    };
+
+    using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<RB_Node>;
+    using NodeTraits = std::allocator_traits<NodeAllocator>;
+    static_assert(std::is_same<typename NodeTraits::pointer, RB_Node*>::value,
+                  "RB_Tree requires an allocator whose pointer type is a raw pointer.");
+
+    NodeAllocator nodeAllocator;    //Allocates and frees every node of the tree. The NIL node is not allocated
+
+    Link root;          //Pointer to the root of the tree
+    RB_Node* leftmost;  //Pointer to the node with the smallest key, NIL when the tree is empty
+    RB_Node* rightmost; //Pointer to the node with the largest key, NIL when the tree is empty
+
+    //The tree's NIL node. It is part of the tree object rather than allocated, so an empty tree owns no heap memory
+    RB_Node sentinel;
+
+    //Pointer to the tree's NIL node. The tree has a unique sentinel node called NIL node to represent all leaves
+    //NIL's nodeColor is black and the rest of its attributes are immaterial
+    RB_Node* const NIL;
+
+    unsigned numRedNodes;    //Number of red nodes in the tree. Always 0 in AVL and WAVL trees
+    unsigned numBlackNodes;  //Number of black nodes in the tree. Counts every node in AVL and WAVL trees
+    unsigned numRepeats;     //Copies of keys beyond the first held in node counts. Always 0 unless Duplicates::COUNTED
+    unsigned numTombstones;  //Nodes still linked into the tree whose key was removed in lazy deletion mode
+
+    bool lazyDeletion;       //True if remove marks nodes as tombstones instead of unlinking them
+    double compactThreshold; //Fraction of tombstone nodes at which remove calls compact()
+
+    Teardown teardown;                  //How destroyTree and the destructor free the tree's nodes
+    unsigned teardownChunk;             //Pending nodes freed by each insert and remove under Teardown::DEFERRED
+    std::vector<RB_Node*> pendingNodes; //Unlinked subtrees still to be freed, then children of freed nodes
+    unsigned numPendingNodes;           //Nodes in the pending subtrees
+
+    MembershipFilter filter;            //Lets lookups of absent keys return without searching, disabled by default
+
+    bool fingerSearch;                  //True if lookups start from the finger instead of the root
+    mutable RB_Node* finger;            //Node the last lookup, insert or removal ended near, NIL when there is none
+    mutable FingerStats fingerStats;    //Work done by finger searches since the last resetFingerStats
+    NodeIndex<keyType, RB_Node> hashIndex;  //Finds the node holding a key without searching, disabled by default
+
+    unsigned capacity;                  //Most keys the tree holds before inserts evict, 0 for no bound
+    Eviction eviction;                  //Which end of the tree a full bounded tree evicts from
+
+    //Progress of an incremental defragmentation. Slot i is the i-th lowest node address and is meant to hold the
+    //i-th node of the layout. Nodes before next are in place.
+    struct DefragmentPlan
+    {
+        std::vector<RB_Node*> slots;    //Addresses of the tree's nodes in ascending order
+        std::vector<unsigned> occupant; //Layout position of the node stored in each slot
+        std::vector<unsigned> location; //Slot holding the node at each layout position
+        std::size_t next;               //First layout position that may not be in place yet
+        unsigned long long version;     //Value of structureVersion the plan was made for
+        Layout layout;                  //Layout the plan moves the nodes into
+    };
+
+    unsigned long long structureVersion;            //Changed whenever nodes are linked into or unlinked from the tree
+    std::unique_ptr<DefragmentPlan> defragmentPlan; //Plan of an unfinished defragmentFor, null when there is none
+
+#if RB_TREE_COUNTERS
+    mutable OperationCounters counters;  //Work done by the tree. Mutable so const lookups can be counted
+#endif
+
+#if RB_TREE_TRACE
+    TraceRecorder* traceRecorder{ nullptr };  //Recorder receiving the tree's operations, null when not recording
+#endif
+
+#if RB_TREE_CONCURRENT_READS
+    static constexpr unsigned maxReaderSlots{ 64 };     //Reader threads beyond this many share slots
+    static constexpr std::size_t retireBatch{ 1024 };   //Retired nodes that make the writer wait out a grace period
+    static constexpr unsigned maxReaderDepth{ 128 };    //Longer descents can only come from racing a rotation
+    static constexpr unsigned maxReaderVisits{ 256 };   //Nodes a reader checks before falling back to writeSequence
+    static constexpr unsigned maxOptimisticReads{ 8 };  //Failed checks before a reader falls back to writeSequence
+
+    //Readers inside concurrentContainsKey, counted under the parity of the epoch they entered in. Every thread has its
+    //own slot on its own cache line, so readers never write to memory another reader writes to.
+    struct alignas(64) ReaderSlot
+    {
+        std::atomic<unsigned> readers[2];
+    };
+
+    mutable ReaderSlot readerSlots[maxReaderSlots]{};   //Reader counts, indexed by readerSlotIndex()
+    std::atomic<unsigned long long> readerEpoch{ 0 };   //Advanced by the writer to start a grace period
+    std::atomic<unsigned long long> writeSequence{ 0 }; //Odd while the writer is rewriting links anywhere in the tree
+    std::vector<RB_Node*> retiredNodes;                 //Unlinked nodes that readers may still be looking at
+#endif
+
+    //Private member functions
+    void transplant(RB_Node* const, RB_Node* const);
+    RB_Node* search(RB_Node*, const keyType&) const;
+    RB_Node* minimum(RB_Node*) const;
+    RB_Node* maximum(RB_Node*) const;
+    RB_Node* successor(const RB_Node*) const;
+    RB_Node* predecessor(const RB_Node*) const;
+    template<typename... Args>
+    RB_Node* allocateNode(Args&&...);
+    void freeNode(RB_Node* const);
+    void adoptNodes(RB_Tree&);
+    void relinkSentinel(RB_Node* const, const RB_Node* const);
+    template<typename... Args>
+    RB_Node* createNode(Args&&...);
+    void resetLinks(RB_Node* const);
+    void updateMaxHigh(RB_Node* const);
+    void updateMaxHighToRoot(RB_Node*);
+    void collectOverlapping(const RB_Node* const, const endpointType&, const endpointType&, std::vector<keyType>&) const;
+    void leftRotate(RB_Node* const);
+    void rightRotate(RB_Node* const);
+    void insertFixup(RB_Node*);
+    void deleteFixup(RB_Node*);
+    void updateHeight(RB_Node* const);
+    RB_Node* avlBalanceNode(RB_Node*);
+    void avlRebalance(RB_Node*);
+    void wavlInsertFixup(RB_Node*);
+    void wavlDeleteFixup(RB_Node*);
+    RB_Node* findInsertPosition(const keyType&, RB_Node*&, bool&);
+    RB_Node* findSplicePosition(const keyType&, RB_Node*&, bool&);
+    RB_Node* searchLive(const keyType&) const;
+    RB_Node* locate(const keyType&) const;
+    RB_Node* searchFromFinger(const keyType&) const;
+    RB_Node* firstLive(RB_Node*) const;
+    RB_Node* lastLive(RB_Node*) const;
+    void eraseKey(RB_Node* const, const bool allowCompact = true);
+    bool addDuplicate(RB_Node* const);
+    unsigned keyCount(const RB_Node* const) const;
+    void attachNode(RB_Node* const, RB_Node* const, const bool);
+    void detachNode(RB_Node*);
+    void RB_delete(RB_Node*);
+    void disposeNode(RB_Node* const);
+    void beginWrite(std::initializer_list<RB_Node*> nodes = {});
+    void endWrite(std::initializer_list<RB_Node*> nodes = {});
+    void markChanging(RB_Node* const);
+    void markChanged(RB_Node* const);
+#if RB_TREE_TRACE
+    void traceOperation(const OpType, const keyType&, const unsigned copies = 1) const;
+#endif
+#if RB_TREE_CONCURRENT_READS
+    static unsigned readerSlotIndex();
+    void waitForReaders();
+    bool searchOptimistic(const keyType&, bool&) const;
+    bool searchSequenced(const keyType&, bool&) const;
+#endif
+    int maximum(const int, const int) const;
+    int calculateSubtreeHeight(const RB_Node* const) const;
+	void copyTree(RB_Node*, RB_Node*, RB_Node*);
+    RB_Node* relocateSubtree(RB_Node* const, RB_Node* const);
+    void freeSubtree(RB_Node* const);
+    static std::size_t freeDetached(NodeAllocator&, std::vector<RB_Node*>&, const RB_Node* const, const std::size_t);
+    void continueTeardown();
+    void handOffPending();
+    static std::size_t allocationOverhead(const std::size_t);
+    void collectLive(RB_Node* const, RB_Node*&, RB_Node*&, unsigned&);
+    RB_Node* buildBalanced(RB_Node*&, const unsigned, const int, const int);
+    void collectPreorder(RB_Node* const, std::vector<RB_Node*>&) const;
+    void collectVeb(RB_Node* const, const int, std::vector<RB_Node*>&) const;
+    void collectVebBottoms(RB_Node* const, const int, const int, std::vector<RB_Node*>&) const;
+    std::unique_ptr<DefragmentPlan> planDefragment(const Layout) const;
+    bool stepDefragment(DefragmentPlan&, const std::chrono::steady_clock::time_point* const);
+    void swapSlots(RB_Node* const, RB_Node* const);
+    void relinkSlot(RB_Node* const, const bool);
+    static int floorLog2(unsigned);
+	void traverseInsert(const RB_Node* const, const RB_Node* const);
+    template<typename K>
+    bool insertKey(K&&);
+    void addToFilter(const keyType&);
+    void refillFilter();
+    bool filterExcludes(const keyType&) const;
+    void addToIndex(RB_Node* const);
+    void rebuildIndex();
+    RB_Node* evictionCandidate() const;
+    bool rejectsKey(const keyType&) const;
+    void evictOverflow();
+
+    //Set operation computed by combineTrees
+    enum class SetOperation { INTERSECTION = 0, DIFFERENCE = 1, SYMMETRIC_DIFFERENCE = 2 };
+
+    RB_Tree combineTrees(const RB_Tree&, const SetOperation) const;
+    RB_Node* lowerBoundFrom(RB_Node*, const keyType&) const;
+    RB_Node* boundFrom(RB_Node*, const keyType&) const;
+    void appendCopy(RB_Node*&, RB_Node*&, unsigned&, const keyType&, const unsigned);
+    void linkBalanced(RB_Node*, const unsigned);
+    static bool preferGalloping(const unsigned, const unsigned);
+	bool compareSubtrees(const RB_Node*, const RB_Node*, RB_Node* const) const;
+	void ascending(const RB_Node* const) const;
+	void descending(const RB_Node* const) const;
+
+public:
+    //Bidirectional iterator visiting the keys in ascending order. Keys cannot be modified through an iterator.
+    //Iterators stay valid until the node they refer to is removed from the tree.
+    class iterator
+    {
+    private:
+        friend class RB_Tree;
+
+        const RB_Node* node;    //Node the iterator refers to. The tree's NIL node represents end()
+        const RB_Tree* tree;    //Tree the node belongs to
+
+        iterator(const RB_Node* const, const RB_Tree* const);
+
+    public:
+        using iterator_category = std::bidirectional_iterator_tag;
+        using value_type = keyType;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const keyType*;
+        using reference = const keyType&;
+
+        iterator();
+        reference operator*() const;
+        pointer operator->() const;
+        unsigned count() const;
+        iterator& operator++();
+        iterator operator++(int);
+        iterator& operator--();
+        iterator operator--(int);
+        bool operator==(const iterator&) const;
+        bool operator!=(const iterator&) const;
+    };
+    using const_iterator = iterator;
+
+    //Owning handle to a node that has been extracted from a tree. The node keeps its key, and in a
+    //Duplicates::COUNTED tree its count, so it can be linked into any tree of the same type whose allocator compares
+    //equal without allocating. A handle that still owns its node frees it with a copy of its tree's allocator.
+    class NodeHandle
+    {
+    private:
+        friend class RB_Tree;
+
+        RB_Node* node;                          //Detached node owned by the handle, nullptr when the handle is empty
+        std::optional<NodeAllocator> allocator; //Allocator the node came from, empty when the handle is empty
+
+        NodeHandle(RB_Node* const, const NodeAllocator&);
+        void release();
+
+    public:
+        NodeHandle();
+        NodeHandle(NodeHandle&&) noexcept;
+        NodeHandle(const NodeHandle&) = delete;
+        ~NodeHandle();
+
+        NodeHandle& operator=(NodeHandle&&) noexcept;
+        NodeHandle& operator=(const NodeHandle&) = delete;
+
+        bool empty() const;
+        explicit operator bool() const;
+        keyType& key() const;
+    };
+
+    //One operation of a batch passed to apply
+    struct Operation
+    {
+        OpType type;    //Whether the key is inserted, removed or looked up
+        keyType key;    //Key the operation acts on
+    };
+
+    using allocator_type = Allocator;
+
+    //Default Constructor
+    RB_Tree();
+
+    //Allocator Constructor
+    explicit RB_Tree(const Allocator&);
+
+    //Copy Constructors
+    RB_Tree(const RB_Tree&);
+    RB_Tree(const RB_Tree&, const Allocator&);
+
+    //Move Constructor
+    RB_Tree(RB_Tree&&) noexcept;
+
+    //Destructor
+    ~RB_Tree();
+
+	//Public member functions
+    bool insert(const keyType& x);
+    bool insert(keyType&& x);
+    template<typename... Args>
+    bool emplace(Args&&... args);
+    iterator insert(iterator hint, const keyType& x);
+    iterator insert(iterator hint, keyType&& x);
+    bool insert(NodeHandle&& handle);
+    bool remove(const keyType& x);
+    NodeHandle extract(const keyType& x);
+    NodeHandle extract(iterator position);
+    void merge(RB_Tree& other);
+    std::vector<bool> apply(const std::vector<Operation>& batch);
+    bool containsKey(const keyType& x) const;
+#if RB_TREE_CONCURRENT_READS
+    bool concurrentContainsKey(const keyType& x) const;
+    void reclaim();
+#endif
+#if RB_TREE_TRACE
+    void setTraceRecorder(TraceRecorder* const recorder);
+#endif
+    unsigned countKey(const keyType& x) const;
+    bool isEmpty() const;
+    unsigned getNumRedNodes() const;
+    unsigned getNumBlackNodes() const;
+    unsigned getNumNodes() const;
+    unsigned getNumKeys() const;
+    int getTreeHeight() const;
+    void statistics() const;
+    void destroyTree();
+    void release();
+    void swap(RB_Tree& other);
+    Allocator getAllocator() const;
+	void displayTree(const Order) const;
+    OperationCounters getCounters() const;
+    void resetCounters();
+    MemoryUsage memoryUsage() const;
+    void shrinkToFit();
+    void setLazyDeletion(const bool enabled, const double threshold = 0.25);
+    bool isLazyDeletion() const;
+    unsigned getNumTombstones() const;
+    void compact();
+    void setTeardown(const Teardown policy, const unsigned chunk = 64);
+    Teardown getTeardown() const;
+    unsigned getNumPendingNodes() const;
+    void finishTeardown();
+    void setMembershipFilter(const bool enabled, const unsigned bitsPerKey = 10);
+    bool isMembershipFilter() const;
+    void setFingerSearch(const bool enabled);
+    bool isFingerSearch() const;
+    FingerStats getFingerStats() const;
+    void resetFingerStats();
+    void setHashIndex(const bool enabled);
+    bool isHashIndex() const;
+    void setCapacity(const unsigned maxKeys, const Eviction evict = Eviction::SMALLEST);
+    unsigned getCapacity() const;
+    Eviction getEviction() const;
+    void defragment(const Layout layout = Layout::IN_ORDER);
+    bool defragmentFor(const std::chrono::microseconds timeSlice, const Layout layout = Layout::IN_ORDER);
+    iterator begin() const;
+    iterator end() const;
+    std::vector<keyType> overlapping(const endpointType point) const;
+    std::vector<keyType> overlapping(const endpointType low, const endpointType high) const;
+    iterator lowerBound(const keyType& x) const;
+    iterator upperBound(const keyType& x) const;
+    const keyType& getMin() const;
+    const keyType& getMax() const;
+    keyType popMin();
+    keyType popMax();
+
+    //Overloaded Operators
+    RB_Tree<keyType, duplicates, balance, Allocator>& operator=(const RB_Tree<keyType, duplicates, balance, Allocator>&);
+    RB_Tree<keyType, duplicates, balance, Allocator>& operator=(RB_Tree<keyType, duplicates, balance, Allocator>&&);
+	RB_Tree<keyType, duplicates, balance, Allocator> operator+(const RB_Tree<keyType, duplicates, balance, Allocator>&) const;
+	RB_Tree<keyType, duplicates, balance, Allocator>& operator+=(const RB_Tree<keyType, duplicates, balance, Allocator>&);
+	RB_Tree<keyType, duplicates, balance, Allocator> operator&(const RB_Tree<keyType, duplicates, balance, Allocator>&) const;
+	RB_Tree<keyType, duplicates, balance, Allocator>& operator&=(const RB_Tree<keyType, duplicates, balance, Allocator>&);
+	RB_Tree<keyType, duplicates, balance, Allocator> operator-(const RB_Tree<keyType, duplicates, balance, Allocator>&) const;
+	RB_Tree<keyType, duplicates, balance, Allocator>& operator-=(const RB_Tree<keyType, duplicates, balance, Allocator>&);
+	RB_Tree<keyType, duplicates, balance, Allocator> operator^(const RB_Tree<keyType, duplicates, balance, Allocator>&) const;
+	RB_Tree<keyType, duplicates, balance, Allocator>& operator^=(const RB_Tree<keyType, duplicates, balance, Allocator>&);
+	bool operator==(const RB_Tree&) const;
+	bool operator!=(const RB_Tree&) const;
+
+private:
+    //Declared after iterator, which it returns
+    template<typename K>
+    iterator insertKey(iterator, K&&);
+};
+
+//***************************************************
+//		Private member function definitions
+//***************************************************
+/// <summary>
+/// Replaces one subtree as a child of its parent with another subtree.
+/// Replaces the subtree rooted at node u with the subtree rooted at node v
+/// </summary>
+/// <param name="u"> A pointer to the node being replaced </param>
+/// <param name="v"> A pointer to the node replacing v in the tree </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::transplant(RB_Node* const u, RB_Node* const v)
+{
+    //Check if we want to transplant the root, a left child or a right child
+    if (u->parent == NIL)
+    {
+        //v becomes the new root
+        root = v;
+    }
+    else if (u == u->parent->left)
+    {
+        //v becomes the left child of u's parent
+        u->parent->left = v;
+    }
+    else
+    {
+        //v becomes the right child of u's parent
+        u->parent->right = v;
+    }
+
+    //set v's parent to u's parent
+    //Note: Even if v is NIL this operation will not cause problems
+    v->parent = u->parent;
+}
+
+/// <summary>
+/// Searches the tree for a specified key value. Returns NIL if the value is not found.
+/// </summary>
+/// <param name="traverse"> A pointer used to a node in the tree. This pointer traverses the tree being searched. </param>
+/// <param name="keyValue"> The value being searched for in the tree. </param>
+/// <returns> A pointer to the node containing the specified key value. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::search(RB_Node* traverse, const keyType& keyValue) const
+{
+    //Number of nodes visited, only used by the operation counters
+    unsigned long long depth{ 0 };
+
+	//Continue to search for the value as long as traverse does not point to NIL or 
+	//the node with the key being searched for
+    while (traverse != NIL && keyValue != traverse->key)
+    {
+        ++depth;
+        RB_TREE_COUNT_ADD(searchComparisons, 2);
+
+		//Determine if the key being searched for might be in the current node's left or right subtree
+        if (keyValue < traverse->key)
+        {
+            traverse = traverse->left;
+        }
+        else
+        {
+            traverse = traverse->right;
+        }
+    }
+
+    //The node holding the key was reached with one last comparison
+    if (traverse != NIL)
+    {
+        ++depth;
+        RB_TREE_COUNT(searchComparisons);
+    }
+    RB_TREE_COUNT_MAX(maxDescentDepth, depth);
+
+	//Return either NIL or a pointer to the node with the specified key
+    return traverse;
+}
+
+/// <summary>
+/// Returns a pointer to the node with the smallest value in the tree.
+/// </summary>
+/// <param name="traverse"> Pointer that traverses the tree until the minimum is reached. </param>
+/// <returns> Pointer to the node with the smallest value in the tree. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::minimum(RB_Node* traverse) const
+{
+	//As long as the current node contains a left child, move the pointer to the left child
+    while (traverse->left != NIL)
+    {
+        traverse = traverse->left;
+    }
+
+	return traverse;
+}
+
+/// <summary>
+/// Returns a pointer to the node with the largest value in the subtree.
+/// </summary>
+/// <param name="traverse"> Pointer that traverses the tree until the maximum is reached. </param>
+/// <returns> Pointer to the node with the largest value in the subtree. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::maximum(RB_Node* traverse) const
+{
+	//As long as the current node contains a right child, move the pointer to the right child
+    while (traverse->right != NIL)
+    {
+        traverse = traverse->right;
+    }
+
+	return traverse;
+}
+
+/// <summary>
+/// Finds the node that follows a node in LNR order.
+/// </summary>
+/// <param name="node"> A pointer to a node in the tree, must not be NIL. </param>
+/// <returns> Pointer to the in-order successor, or NIL if the node holds the largest key. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::successor(const RB_Node* node) const
+{
+	//The successor is the smallest node of the right subtree when there is one
+	if (node->right != NIL)
+	{
+		return minimum(node->right);
+	}
+
+	//Otherwise it is the first ancestor reached from its left subtree
+	RB_Node* ancestor{ node->parent };
+	while (ancestor != NIL && node == ancestor->right)
+	{
+		node = ancestor;
+		ancestor = ancestor->parent;
+	}
+
+	return ancestor;
+}
+
+/// <summary>
+/// Finds the node that precedes a node in LNR order.
+/// </summary>
+/// <param name="node"> A pointer to a node in the tree, must not be NIL. </param>
+/// <returns> Pointer to the in-order predecessor, or NIL if the node holds the smallest key. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::predecessor(const RB_Node* node) const
+{
+	//The predecessor is the largest node of the left subtree when there is one
+	if (node->left != NIL)
+	{
+		return maximum(node->left);
+	}
+
+	//Otherwise it is the first ancestor reached from its right subtree
+	RB_Node* ancestor{ node->parent };
+	while (ancestor != NIL && node == ancestor->left)
+	{
+		node = ancestor;
+		ancestor = ancestor->parent;
+	}
+
+	return ancestor;
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Obtains a node from the tree's allocator and constructs it through std::allocator_traits. With arguments the key
+/// is constructed from them in the node, otherwise it is value-initialized. The other fields are not set.
+/// </summary>
+/// <param name="args"> The arguments of the key's constructor, if any. </param>
+/// <returns> A pointer to the new node. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+template<typename... Args>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::allocateNode(Args&&... args)
+{
+    RB_Node* const node{ NodeTraits::allocate(nodeAllocator, 1) };
+
+    //Return the memory if the key's constructor throws
+    try
+    {
+        if constexpr (sizeof...(Args) == 0)
+        {
+            NodeTraits::construct(nodeAllocator, node);
+        }
+        else
+        {
+            NodeTraits::construct(nodeAllocator, node, std::in_place, std::forward<Args>(args)...);
+        }
+    }
+    catch (...)
+    {
+        NodeTraits::deallocate(nodeAllocator, node, 1);
+        throw;
+    }
+    RB_TREE_COUNT(nodeAllocations);
+
+    return node;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Destroys a node and returns it to the tree's allocator. The node must not be linked into the tree.
+/// </summary>
+/// <param name="node"> A pointer to the node being freed. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::freeNode(RB_Node* const node)
+{
+    if (node == finger)
+    {
+        finger = NIL;
+    }
+
+    NodeTraits::destroy(nodeAllocator, node);
+    NodeTraits::deallocate(nodeAllocator, node, 1);
+    RB_TREE_COUNT(nodeFrees);
+}
+
+/// <summary>
+/// Takes over the nodes and state of another tree, leaving it empty. The allocators must compare equal, or this
+/// tree's allocator must already have been replaced by the other's. Nodes the other tree had linked to its own NIL
+/// node are relinked to this tree's, which visits every node but allocates nothing. Nodes the other tree is still
+/// tearing down stay with it.
+/// </summary>
+/// <param name="other"> The tree giving up its nodes. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::adoptNodes(RB_Tree& other)
+{
+    root = other.root;
+    leftmost = (other.leftmost == other.NIL) ? NIL : other.leftmost;
+    rightmost = (other.rightmost == other.NIL) ? NIL : other.rightmost;
+    if (root == other.NIL)
+    {
+        root = NIL;
+    }
+    else
+    {
+        root->parent = NIL;
+        relinkSentinel(root, other.NIL);
+    }
+
+    numRedNodes = other.numRedNodes;
+    numBlackNodes = other.numBlackNodes;
+    numRepeats = other.numRepeats;
+    numTombstones = other.numTombstones;
+    lazyDeletion = other.lazyDeletion;
+    compactThreshold = other.compactThreshold;
+    capacity = other.capacity;
+    eviction = other.eviction;
+    teardown = other.teardown;
+    teardownChunk = other.teardownChunk;
+    filter = std::move(other.filter);
+    fingerSearch = other.fingerSearch;
+    finger = NIL;
+    hashIndex = std::move(other.hashIndex);
+    ++structureVersion;
+    defragmentPlan.reset();
+
+    //The other tree is empty but keeps its settings
+    other.root = other.NIL;
+    other.leftmost = other.NIL;
+    other.rightmost = other.NIL;
+    other.numRedNodes = 0;
+    other.numBlackNodes = 0;
+    other.numRepeats = 0;
+    other.numTombstones = 0;
+    other.filter.clear();
+    other.finger = other.NIL;
+    other.hashIndex.clear();
+    ++other.structureVersion;
+    other.defragmentPlan.reset();
+}
+
+/// <summary>
+/// Points every link of a subtree that refers to another tree's NIL node at this tree's NIL node, in NLR order.
+/// </summary>
+/// <param name="node"> The root of the subtree, which must not be a NIL node. </param>
+/// <param name="oldNIL"> The NIL node the subtree's links refer to. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::relinkSentinel(RB_Node* const node, const RB_Node* const oldNIL)
+{
+    if (node->left == oldNIL)
+    {
+        node->left = NIL;
+    }
+    else
+    {
+        relinkSentinel(node->left, oldNIL);
+    }
+
+    if (node->right == oldNIL)
+    {
+        node->right = NIL;
+    }
+    else
+    {
+        relinkSentinel(node->right, oldNIL);
+    }
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Allocates a red node with all of its links pointing to NIL. The key is constructed in the node from the
+/// arguments, so a key passed as an rvalue is moved rather than copied.
+/// </summary>
+/// <param name="args"> The key, or the arguments of its constructor. </param>
+/// <returns> A pointer to the new node, which is not yet linked into the tree. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+template<typename... Args>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::createNode(Args&&... args)
+{
+    RB_Node* newNode = allocateNode(std::forward<Args>(args)...);
+
+    resetLinks(newNode);
+
+    if constexpr (duplicates == Duplicates::COUNTED)
+    {
+        newNode->count = 1;
+    }
+
+    return newNode;
+}
+
+/// <summary>
+/// Puts a node in the state of a freshly created node: no links, red, and rank 0 in rank balanced trees.
+/// The key and count are left alone so a node taken from a node handle keeps them.
+/// </summary>
+/// <param name="node"> A pointer to the node being reset. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::resetLinks(RB_Node* const node)
+{
+    node->parent = NIL;
+    node->left = NIL;
+    node->right = NIL;
+    node->nodeColor = Color::RED;
+    node->tombstone = false;
+
+    if constexpr (balance != Balance::RED_BLACK)
+    {
+        node->rank = 0;
+    }
+}
+
+/// <summary>
+/// Recomputes the largest high endpoint of a node's subtree from its own interval and its children's values.
+/// Does nothing unless the keys are intervals.
+/// </summary>
+/// <param name="node"> A pointer to the node being updated. Its children must already be up to date. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::updateMaxHigh(RB_Node* const node)
+{
+    if constexpr (intervalKeys)
+    {
+        if (node == NIL)
+        {
+            return;
+        }
+
+        node->maxHigh = node->key.high;
+        if (node->left != NIL && node->maxHigh < node->left->maxHigh)
+        {
+            node->maxHigh = node->left->maxHigh;
+        }
+        if (node->right != NIL && node->maxHigh < node->right->maxHigh)
+        {
+            node->maxHigh = node->right->maxHigh;
+        }
+    }
+}
+
+/// <summary>
+/// Recomputes the largest high endpoints from a node up to the root, after a change below or at the node.
+/// Does nothing unless the keys are intervals.
+/// </summary>
+/// <param name="node"> The lowest node whose subtree changed, NIL for none. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::updateMaxHighToRoot(RB_Node* node)
+{
+    if constexpr (intervalKeys)
+    {
+        while (node != NIL)
+        {
+            updateMaxHigh(node);
+            node = node->parent;
+        }
+    }
+}
+
+/// <summary>
+/// Appends the live intervals of a subtree that overlap [low, high], in ascending order. A subtree whose largest
+/// endpoint is below low holds no overlap. Neither does anything after a node that starts above high, so the walk
+/// stops there instead of visiting the node's right subtree.
+/// </summary>
+/// <param name="node"> The root of the subtree being searched. </param>
+/// <param name="low"> The start of the query range. </param>
+/// <param name="high"> The end of the query range. </param>
+/// <param name="found"> The list the overlapping intervals are appended to, once for every copy held. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::collectOverlapping(const RB_Node* const node, const endpointType& low, const endpointType& high,
+    std::vector<keyType>& found) const
+{
+    if constexpr (intervalKeys)
+    {
+        if (node == NIL || node->maxHigh < low)
+        {
+            return;
+        }
+
+        collectOverlapping(node->left, low, high, found);
+
+        if (high < node->key.low)
+        {
+            return;
+        }
+
+        if (!(node->key.high < low))
+        {
+            for (unsigned copies{ keyCount(node) }; copies > 0; --copies)
+            {
+                found.push_back(node->key);
+            }
+        }
+
+        collectOverlapping(node->right, low, high, found);
+    }
+}
+
+//NOTE: An exception is thrown if the pivot's right child is NIL
+/// <summary>
+/// Performs a left rotation about the pivot node. Assumes the pivot's right child is not NIL.
+/// Only node pointers are changed, no other attributes are affected except the largest endpoints of an interval tree.
+/// The pivot's right child takes the pivot's position in the tree. The pivot becomes the left child of its right child.
+/// The left subtree of the pivot's right child becomes the pivot's right subtree.
+/// </summary>
+/// <param name="pivot"> A pointer to the node the rotation takes place about. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::leftRotate(RB_Node* const pivot)
+{
+    //If pivot is the NIL node, the rotation does nothing
+    if (pivot != NIL)
+    {
+        RB_TREE_COUNT(leftRotations);
+
+        RB_Node* const prc{ pivot->right };    //The pivot's right child. Becomes the root of the rotated subtree
+
+        //If pivot's right child is the NIL node then the rotation will break the tree at the position
+        //of the pivot. An exception is thrown to prevent the rotated subtree from being cut off.
+        if (prc == NIL)
+        {
+            throw std::logic_error{ "ERROR: The pivot's right child cannot be NIL." };
+        }
+
+        const std::initializer_list<RB_Node*> changed{ pivot->parent, pivot, prc, prc->left };
+        beginWrite(changed);
+
+        //prc's left subtree becomes the pivot's right subtree
+        pivot->right = prc->left;
+
+        //If prc's left subtree is not NIL, the pivot becomes the parent of prc's left subtree
+        if (prc->left != NIL)
+        {
+            prc->left->parent = pivot;
+        }
+
+        //Determine if the pivot is the root, a left child, or a right child. The pivot's right child becomes the
+        //tree's new root if the pivot is the tree's root, otherwise it becomes the child of the pivot's parent
+        if (pivot->parent == NIL)
+        {
+            root = prc;
+        }
+        else if (pivot == pivot->parent->left)
+        {
+            pivot->parent->left = prc;
+        }
+        else //if (pivot == pivot->parent->right)
+        {
+            pivot->parent->right = prc;
+        }
+
+        //The pivot's parent becomes the parent of the pivot's right child
+        prc->parent = pivot->parent;
+
+        //The pivot becomes the left child of prc
+        prc->left = pivot;
+        pivot->parent = prc;
+
+        //prc now spans the subtree the pivot spanned, and the pivot lost prc's right subtree
+        updateMaxHigh(pivot);
+        updateMaxHigh(prc);
+
+        endWrite(changed);
+    }
+}
+
+//NOTE: An exception is thrown if the pivot's left child is NIL
+/// <summary>
+/// Performs a right rotation about the pivot node. Assumes the pivot's left child is not NIL.
+/// Only node pointers are changed. No other attributes are affected, except the largest endpoints of an interval tree.
+/// The pivot's left child takes the pivot's position in the tree. The pivot becomes the right child of its left child.
+/// The right subtree of the pivot's left child becomes the pivot's left subtree.
+/// </summary>
+/// <param name="pivot"> A pointer to the node the rotation takes place about. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::rightRotate(RB_Node* const pivot)
+{
+    //If pivot is the NIL node, the rotation does nothing
+    if (pivot != NIL)
+    {
+        RB_TREE_COUNT(rightRotations);
+
+        RB_Node* plc{ pivot->left };    //The pivot's left child. Becomes the root of the rotated subtree
+
+        //If pivot's left child is the NIL node then the rotation will break the tree at the position
+         //of the pivot. An exception is thrown to prevent the rotated subtree from being cut off.
+        if (plc == NIL)
+        {
+            throw std::logic_error{ "ERROR: The pivot's left child cannot be NIL." };
+        }
+
+        const std::initializer_list<RB_Node*> changed{ pivot->parent, pivot, plc, plc->right };
+        beginWrite(changed);
+
+        //The right subtree of plc becomes pivot's left subtree
+        pivot->left = plc->right;
+
+        //If plc's right subtree is not NIL, its parent becomes the pivot
+        if (plc->right != NIL)
+        {
+            plc->right->parent = pivot;
+        }
+
+        //Determine if the pivot is the root of the tree, a right child, or a left child. If the pivot is
+        //the root, plc becomes the new root, otherwise the parent of the pivot becomes plc's parent
+        if (pivot->parent == NIL)
+        {
+            root = plc;
+        }
+        else if (pivot == pivot->parent->left)
+        {
+            pivot->parent->left = plc;
+        }
+        else //if (pivot == pivot->parent->right)
+        {
+            pivot->parent->right = plc;
+        }
+
+        //The pivot's parent becomes plc's parent
+        plc->parent = pivot->parent;
+
+        //The pivot becomes plc's right child
+        plc->right = pivot;
+        pivot->parent = plc;
+
+        //plc now spans the subtree the pivot spanned, and the pivot lost plc's left subtree
+        updateMaxHigh(pivot);
+        updateMaxHigh(plc);
+
+        endWrite(changed);
+    }
+}
+
+/// <summary>
+/// Restores the properties of Red-Black trees after an insertion is made. AVL and WAVL trees are handed to
+/// their own rebalancing functions.
+/// </summary>
+/// <param name="insertedNode"> A pointer to the node being inserted </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::insertFixup(RB_Node* insertedNode)
+{
+    //Rank balanced trees do not use colors, every node is counted as black
+    if constexpr (balance != Balance::RED_BLACK)
+    {
+        insertedNode->nodeColor = Color::BLACK;
+        ++numBlackNodes;
+
+        if constexpr (balance == Balance::AVL)
+        {
+            avlRebalance(insertedNode->parent);
+        }
+        else
+        {
+            wavlInsertFixup(insertedNode);
+        }
+        return;
+    }
+
+    //Increment the number of red nodes
+    ++numRedNodes;
+
+    //Note: The inserted node is always red.
+    //If the inserted node's parent is red we are in violation the property 4
+    while (insertedNode->parent->nodeColor == Color::RED)
+    {
+        //Check if the parent of the inserted node is a left child or right child
+        if (insertedNode->parent == insertedNode->parent->parent->left)
+        {
+            //Create a pointer to the inserted node's uncle
+            RB_Node* rightUncle = insertedNode->parent->parent->right;
+
+            //Case 1: The inserted node's uncle is red
+            //Recolor the node's parent and uncle to be black, recolor the node's grandparent to be red. Preserves property 5
+            //By changing the node's grandparent to red, we may have introduced violations of property 2 or 4
+            //further up the tree. Change the inserted node pointer to point to the nodes grandparent and check for a violation
+            if (rightUncle->nodeColor == Color::RED)
+            {
+                insertedNode->parent->nodeColor = Color::BLACK;
+                rightUncle->nodeColor = Color::BLACK;
+                insertedNode->parent->parent->nodeColor = Color::RED;
+                insertedNode = insertedNode->parent->parent;
+
+                //Case 1 produces a net change of one more black node and one less red node
+                ++numBlackNodes;
+                --numRedNodes;
+                RB_TREE_COUNT(insertFixupCase1);
+            }
+            //Else, the inserted node's uncle is black
+            else
+            {
+                //Case 2: The inserted node's uncle is black and the inserted node is a right child
+                //Point to the inserted node's parent and perform a left rotate with the inserted node's parent as the pivot
+                //This changes our violation to case 3 and we fall through to case 3
+                if (insertedNode == insertedNode->parent->right)
+                {
+                    insertedNode = insertedNode->parent;
+                    leftRotate(insertedNode);
+                    RB_TREE_COUNT(insertFixupCase2);
+                }
+
+                //Case 3: The inserted node's uncle is black and the inserted node is a left child
+                //Color the inserted node's parent black and the grandparent red then rotate right with
+                //the grandparent as the pivot. The recoloring and rotation preserve property 5. After case 3 we do not
+                //have two red nodes in a row and the loop will terminate. Since we do not point to the root in case two
+                //and three property two holds. Case 2 and 3 fix the only violation of property 4.
+                insertedNode->parent->nodeColor = Color::BLACK;
+                insertedNode->parent->parent->nodeColor = Color::RED;
+                rightRotate(insertedNode->parent->parent);
+                RB_TREE_COUNT(insertFixupCase3);
+            }
+        }
+        //Same as the first if block but with left and right exchanged.
+        else //if (insertedNode->parent == insertedNode->parent->parent->right)
+        {
+            RB_Node* leftUncle = insertedNode->parent->parent->left;
+
+            //Case 1
+            if (leftUncle->nodeColor == Color::RED)
+            {
+                insertedNode->parent->nodeColor = Color::BLACK;
+                leftUncle->nodeColor = Color::BLACK;
+                insertedNode->parent->parent->nodeColor = Color::RED;
+                insertedNode = insertedNode->parent->parent;
+
+                //Case 1 produces a net change of one more black node and one less red node
+                ++numBlackNodes;
+                --numRedNodes;
+                RB_TREE_COUNT(insertFixupCase1);
+            }
+            else
+            {
+                //Case 2
+                if (insertedNode == insertedNode->parent->left)
+                {
+                    insertedNode = insertedNode->parent;
+                    rightRotate(insertedNode);
+                    RB_TREE_COUNT(insertFixupCase2);
+                }
+
+                //Case 3
+                insertedNode->parent->nodeColor = Color::BLACK;
+                insertedNode->parent->parent->nodeColor = Color::RED;
+                leftRotate(insertedNode->parent->parent);
+                RB_TREE_COUNT(insertFixupCase3);
+            }
+        }
+    }
+
+    //If the root color is red at this point, we recolor it black
+    if (root->nodeColor == Color::RED)
+    {
+        ++numBlackNodes;
+        --numRedNodes;
+    }
+
+    //Color the root black since at termination property 2 is the only property not guaranteed
+    root->nodeColor = Color::BLACK;
+}
+
+//ADD COMMENTS, REWRITE
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::deleteFixup(RB_Node* x)
+{
+    RB_Node* w;
+    while (x != root && x->nodeColor == Color::BLACK)
+    {
+        if (x == x->parent->left)
+        {
+            w = x->parent->right;
+            //case1 transforms to case 2,3,4
+            if (w->nodeColor == Color::RED)
+            {
+                w->nodeColor = Color::BLACK;
+                x->parent->nodeColor = Color::RED;
+                leftRotate(x->parent);
+                w = x->parent->right;
+                RB_TREE_COUNT(deleteFixupCase1);
+            }
+            //case 2
+            if (w->left->nodeColor == Color::BLACK && w->right->nodeColor == Color::BLACK)
+            {
+                w->nodeColor = Color::RED;
+                x = x->parent;
+
+                //Adjust the red and black node counts
+                ++numRedNodes;
+                --numBlackNodes;
+                RB_TREE_COUNT(deleteFixupCase2);
+            }
+            else
+            {
+                //case 3 transforms to case 4
+                if (w->right->nodeColor == Color::BLACK)
+                {
+                    w->left->nodeColor = Color::BLACK;
+                    w->nodeColor = Color::RED;
+                    rightRotate(w);
+                    w = x->parent->right;
+                    RB_TREE_COUNT(deleteFixupCase3);
+                }
+
+                //case 4
+                w->nodeColor = x->parent->nodeColor;
+                x->parent->nodeColor = Color::BLACK;
+                w->right->nodeColor = Color::BLACK;
+                leftRotate(x->parent);
+                x = root;
+
+                //Adjust the red and black node counts
+                --numRedNodes;
+                ++numBlackNodes;
+                RB_TREE_COUNT(deleteFixupCase4);
+            }
+        }
+        else
+        {
+            w = x->parent->left;
+
+            //Case 1
+            if (w->nodeColor == Color::RED)
+            {
+                w->nodeColor = Color::BLACK;
+                x->parent->nodeColor = Color::RED;
+                rightRotate(x->parent);
+                w = x->parent->left;
+                RB_TREE_COUNT(deleteFixupCase1);
+            }
+
+            //Case 2
+            if (w->right->nodeColor == Color::BLACK && w->left->nodeColor == Color::BLACK)
+            {
+                w->nodeColor = Color::RED;
+                x = x->parent;
+
+                //Adjust the red and black node counts
+                ++numRedNodes;
+                --numBlackNodes;
+                RB_TREE_COUNT(deleteFixupCase2);
+            }
+            else
+            {
+                //Case 3
+                if (w->left->nodeColor == Color::BLACK)
+                {
+                    w->right->nodeColor = Color::BLACK;
+                    w->nodeColor = Color::RED;
+                    leftRotate(w);
+                    w = x->parent->left;
+                    RB_TREE_COUNT(deleteFixupCase3);
+                }
+
+                //Case 4
+                w->nodeColor = x->parent->nodeColor;
+                x->parent->nodeColor = Color::BLACK;
+                w->left->nodeColor = Color::BLACK;
+                rightRotate(x->parent);
+                x = root;
+
+                //Adjust the red and black node counts
+                ++numBlackNodes;
+                --numRedNodes;
+                RB_TREE_COUNT(deleteFixupCase4);
+            }
+        }
+    }
+
+    //Check if we need to adjust our counter
+    if (x->nodeColor != Color::BLACK)
+    {
+        --numRedNodes;
+        ++numBlackNodes;
+    }
+
+    x->nodeColor = Color::BLACK;
+}
+
+/// <summary>
+/// Recomputes the rank of an AVL node from the ranks of its children. The rank of an AVL node is its height.
+/// </summary>
+/// <param name="node"> A pointer to a node that is not NIL. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::updateHeight(RB_Node* const node)
+{
+    node->rank = static_cast<signed char>(maximum(node->left->rank, node->right->rank) + 1);
+}
+
+/// <summary>
+/// Restores the AVL property at a single node whose children are valid AVL trees with heights differing by at
+/// most two, then updates its height. A left-right or right-left imbalance takes a double rotation.
+/// </summary>
+/// <param name="node"> A pointer to the node being balanced. </param>
+/// <returns> A pointer to the root of the balanced subtree, which replaces node in the tree. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::avlBalanceNode(RB_Node* node)
+{
+    const int balanceFactor{ node->left->rank - node->right->rank };
+
+    //Left subtree is two levels taller
+    if (balanceFactor > 1)
+    {
+        RB_Node* leftChild{ node->left };
+
+        //Left-right case: rotate the left child first so the taller grandchild is on the outside
+        if (leftChild->left->rank < leftChild->right->rank)
+        {
+            leftRotate(leftChild);
+            updateHeight(leftChild);
+            leftChild = leftChild->parent;
+            updateHeight(leftChild);
+        }
+
+        rightRotate(node);
+        updateHeight(node);
+        updateHeight(leftChild);
+        return leftChild;
+    }
+
+    //Right subtree is two levels taller. Same as above with left and right exchanged
+    if (balanceFactor < -1)
+    {
+        RB_Node* rightChild{ node->right };
+
+        if (rightChild->right->rank < rightChild->left->rank)
+        {
+            rightRotate(rightChild);
+            updateHeight(rightChild);
+            rightChild = rightChild->parent;
+            updateHeight(rightChild);
+        }
+
+        leftRotate(node);
+        updateHeight(node);
+        updateHeight(rightChild);
+        return rightChild;
+    }
+
+    updateHeight(node);
+    return node;
+}
+
+/// <summary>
+/// Restores the AVL property after an insertion or deletion by walking from the lowest changed node towards the
+/// root. The walk stops as soon as a subtree keeps its previous height, since nothing above it can have changed.
+/// </summary>
+/// <param name="node"> The parent of the position where a node was added or removed. May be NIL. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::avlRebalance(RB_Node* node)
+{
+    while (node != NIL)
+    {
+        const signed char previousHeight{ node->rank };
+
+        node = avlBalanceNode(node);
+
+        //A subtree whose height did not change leaves every ancestor as it was
+        if (node->rank == previousHeight)
+        {
+            return;
+        }
+
+        node = node->parent;
+    }
+}
+
+/// <summary>
+/// Restores the WAVL rank rule after an insertion. The inserted leaf has rank 0, so its parent may now have a
+/// child with rank difference 0. Parents with a 1-child sibling are promoted and the violation moves up;
+/// otherwise one single or double rotation ends the fixup.
+/// </summary>
+/// <param name="insertedNode"> A pointer to the node that was inserted. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::wavlInsertFixup(RB_Node* insertedNode)
+{
+    RB_Node* x{ insertedNode };
+    RB_Node* p{ x->parent };
+
+    //x is a 0-child of p
+    while (p != NIL && p->rank == x->rank)
+    {
+        const bool isLeft{ x == p->left };
+        RB_Node* const sibling{ isLeft ? p->right : p->left };
+
+        //p is 0,1: promote p and continue from there
+        if (p->rank - sibling->rank == 1)
+        {
+            ++p->rank;
+            x = p;
+            p = x->parent;
+            continue;
+        }
+
+        //p is 0,2: x has been promoted before, so it is 1,2. Rotate on the side of its 1-child
+        RB_Node* const inner{ isLeft ? x->right : x->left };
+
+        if (x->rank - inner->rank == 2)
+        {
+            //The outer child is the 1-child: a single rotation at p
+            if (isLeft)
+            {
+                rightRotate(p);
+            }
+            else
+            {
+                leftRotate(p);
+            }
+            --p->rank;
+        }
+        else
+        {
+            //The inner child is the 1-child: a double rotation brings it to the top
+            if (isLeft)
+            {
+                leftRotate(x);
+                rightRotate(p);
+            }
+            else
+            {
+                rightRotate(x);
+                leftRotate(p);
+            }
+            ++inner->rank;
+            --x->rank;
+            --p->rank;
+        }
+
+        return;
+    }
+}
+
+/// <summary>
+/// Restores the WAVL rank rule after a deletion. Removing a node can leave its parent as a rank 1 leaf with two
+/// 2-children, or give the parent a child with rank difference 3. Demotions move the violation up the tree and
+/// at most one single or double rotation ends the fixup.
+/// </summary>
+/// <param name="x"> The node that took the deleted node's place, may be NIL. Its parent pointer must be valid. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::wavlDeleteFixup(RB_Node* x)
+{
+    RB_Node* p{ x->parent };
+
+    //A leaf must have rank 0. A rank 1 leaf is demoted, which may leave it a 3-child of its parent
+    if (p != NIL && p->left == NIL && p->right == NIL && p->rank == 1)
+    {
+        p->rank = 0;
+        x = p;
+        p = x->parent;
+    }
+
+    //x is a 3-child of p
+    while (p != NIL && p->rank - x->rank == 3)
+    {
+        const bool isLeft{ x == p->left };
+        RB_Node* const sibling{ isLeft ? p->right : p->left };
+
+        //The sibling is a 2-child: demote p and continue from there
+        if (p->rank - sibling->rank == 2)
+        {
+            --p->rank;
+            x = p;
+            p = x->parent;
+            continue;
+        }
+
+        //The sibling is a 1-child with two 2-children: demote p and the sibling together
+        if (sibling->rank - sibling->left->rank == 2 && sibling->rank - sibling->right->rank == 2)
+        {
+            --p->rank;
+            --sibling->rank;
+            x = p;
+            p = x->parent;
+            continue;
+        }
+
+        RB_Node* const outer{ isLeft ? sibling->right : sibling->left };
+        RB_Node* const inner{ isLeft ? sibling->left : sibling->right };
+
+        if (sibling->rank - outer->rank == 1)
+        {
+            //The sibling's outer child is a 1-child: a single rotation at p
+            if (isLeft)
+            {
+                leftRotate(p);
+            }
+            else
+            {
+                rightRotate(p);
+            }
+            ++sibling->rank;
+            --p->rank;
+
+            //p may have become a leaf with two 2-children
+            if (p->left == NIL && p->right == NIL)
+            {
+                --p->rank;
+            }
+        }
+        else
+        {
+            //The sibling's inner child is the 1-child: a double rotation brings it to the top
+            if (isLeft)
+            {
+                rightRotate(sibling);
+                leftRotate(p);
+            }
+            else
+            {
+                leftRotate(sibling);
+                rightRotate(p);
+            }
+            inner->rank += 2;
+            --sibling->rank;
+            p->rank -= 2;
+        }
+
+        return;
+    }
+}
+
+/// <summary>
+/// Finds where a key belongs in the tree. Keys that are not smaller than the maximum or smaller than the minimum are
+/// placed next to the cached extreme nodes without descending from the root. When the tree does not store equal keys
+/// in separate nodes the descent stops at a node already holding the key.
+/// </summary>
+/// <param name="x"> The key being inserted. </param>
+/// <param name="parentNode"> Set to the node the new node should be linked below, NIL if the tree is empty. </param>
+/// <param name="asLeftChild"> Set to true if the new node should become the left child of parentNode. </param>
+/// <returns> The node already holding the key if equal keys share a node, otherwise NIL. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::findInsertPosition(const keyType& x, RB_Node*& parentNode, bool& asLeftChild)
+{
+    //Keys that are not smaller than the current maximum always end up as the right child of the largest node
+    //(equal keys go right), so increasing keys are appended without descending from the root
+    if (rightmost != NIL && !(x < rightmost->key))
+    {
+        if (duplicates != Duplicates::MULTI_NODE && !(rightmost->key < x))
+        {
+            return rightmost;
+        }
+
+        parentNode = rightmost;
+        asLeftChild = false;
+        return NIL;
+    }
+
+    //Likewise keys smaller than the minimum end up as the left child of the smallest node
+    if (leftmost != NIL && x < leftmost->key)
+    {
+        parentNode = leftmost;
+        asLeftChild = true;
+        return NIL;
+    }
+
+    //Pointer to trail the inserted node, points to the parent when the insertion takes place
+    RB_Node* trailing = NIL;
+
+    //Pointer used to traverse the tree, we stop traversing when this pointer points to NIL
+    RB_Node* traverse = root;
+
+    //Number of nodes visited, only used by the operation counters
+    unsigned long long depth{ 0 };
+
+    asLeftChild = false;
+
+    //Find the position to insert the node
+    while (traverse != NIL)
+    {
+        ++depth;
+        RB_TREE_COUNT(insertComparisons);
+
+        trailing = traverse;
+        if (x < traverse->key)
+        {
+            asLeftChild = true;
+            traverse = traverse->left;
+        }
+        else
+        {
+            //When equal keys share a node, a key that is not smaller is checked for equality before moving right
+            if (duplicates != Duplicates::MULTI_NODE)
+            {
+                RB_TREE_COUNT(insertComparisons);
+                if (!(traverse->key < x))
+                {
+                    RB_TREE_COUNT_MAX(maxDescentDepth, depth);
+                    return traverse;
+                }
+            }
+
+            asLeftChild = false;
+            traverse = traverse->right;
+        }
+    }
+
+    RB_TREE_COUNT_MAX(maxDescentDepth, depth);
+
+    parentNode = trailing;
+    return NIL;
+}
+
+/// <summary>
+/// Stores another copy of a key that already has a node. A tombstone is brought back to life with the key instead.
+/// Otherwise under Duplicates::COUNTED the node's count is incremented and under Duplicates::UNIQUE the copy is
+/// rejected. Never called for Duplicates::MULTI_NODE trees.
+/// </summary>
+/// <param name="existing"> The node holding the key. </param>
+/// <returns> True if the copy was stored, false if it was rejected. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::addDuplicate(RB_Node* const existing)
+{
+    if (existing->tombstone)
+    {
+        existing->tombstone = false;
+        --numTombstones;
+        return true;
+    }
+
+    if constexpr (duplicates == Duplicates::COUNTED)
+    {
+        ++existing->count;
+        ++numRepeats;
+        return true;
+    }
+    else
+    {
+        static_cast<void>(existing);
+        return false;
+    }
+}
+
+/// <summary>
+/// Returns the number of copies of the key stored in a node.
+/// </summary>
+/// <param name="node"> A node of the tree, must not be NIL. </param>
+/// <returns> 0 for a tombstone, else the node's repeat count under Duplicates::COUNTED, otherwise 1. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+unsigned RB_Tree<keyType, duplicates, balance, Allocator>::keyCount(const RB_Node* const node) const
+{
+    if (node->tombstone)
+    {
+        return 0;
+    }
+
+    if constexpr (duplicates == Duplicates::COUNTED)
+    {
+        return node->count;
+    }
+    else
+    {
+        static_cast<void>(node);
+        return 1;
+    }
+}
+
+/// <summary>
+/// Finds where a detached node belongs, as findInsertPosition does. A tombstone holding the key is freed first,
+/// so the node takes its place instead of being counted against a key that is no longer in the tree.
+/// </summary>
+/// <param name="x"> The key of the node being linked. </param>
+/// <param name="parentNode"> Set to the node that becomes the parent, NIL if the tree is empty. </param>
+/// <param name="asLeftChild"> Set to true if the node becomes the left child of parentNode. </param>
+/// <returns> The live node already holding the key in a Duplicates::COUNTED or Duplicates::UNIQUE tree, otherwise NIL. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::findSplicePosition(const keyType& x, RB_Node*& parentNode, bool& asLeftChild)
+{
+    RB_Node* existing{ findInsertPosition(x, parentNode, asLeftChild) };
+
+    if (existing != NIL && existing->tombstone)
+    {
+        RB_delete(existing);
+        --numTombstones;
+
+        parentNode = NIL;
+        asLeftChild = false;
+        existing = findInsertPosition(x, parentNode, asLeftChild);
+    }
+
+    return existing;
+}
+
+/// <summary>
+/// Searches for a node holding a key that has not been removed. If search lands on a tombstone in a
+/// Duplicates::MULTI_NODE tree the equal keys next to it are checked, since they are adjacent in LNR order.
+/// </summary>
+/// <param name="keyValue"> The key being searched for. </param>
+/// <returns> A live node holding the key, or NIL. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::searchLive(const keyType& keyValue) const
+{
+    RB_Node* const found{ locate(keyValue) };
+
+    if (found == NIL || !found->tombstone)
+    {
+        return found;
+    }
+
+    if constexpr (duplicates == Duplicates::MULTI_NODE)
+    {
+        for (RB_Node* before{ predecessor(found) }; before != NIL && !(before->key < keyValue); before = predecessor(before))
+        {
+            if (!before->tombstone)
+            {
+                return before;
+            }
+        }
+        for (RB_Node* after{ successor(found) }; after != NIL && !(keyValue < after->key); after = successor(after))
+        {
+            if (!after->tombstone)
+            {
+                return after;
+            }
+        }
+    }
+
+    return NIL;
+}
+
+/// <summary>
+/// Finds a node holding a key: in the hash index if it is enabled, otherwise from the finger in finger search mode
+/// and from the root if neither is on.
+/// </summary>
+/// <param name="keyValue"> The key being searched for. </param>
+/// <returns> A node holding the key, or NIL. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::locate(const keyType& keyValue) const
+{
+    if (hashIndex.isEnabled())
+    {
+        RB_Node* const found{ hashIndex.find(keyValue) };
+        return (found != nullptr) ? found : NIL;
+    }
+
+    return fingerSearch ? searchFromFinger(keyValue) : search(root, keyValue);
+}
+
+/// <summary>
+/// Finger search: finds a node holding a key starting from the node the previous operation ended at. It climbs
+/// through parent links until it reaches an ancestor on the far side of the key, then descends from the last node
+/// climbed to. The climb stops after about log d levels when the key is d positions from the finger, unless the two
+/// lie on either side of a high ancestor, such as the root. The finger moves to the node found, or to the last
+/// node of the descent when the key is absent.
+/// </summary>
+/// <param name="keyValue"> The key being searched for. </param>
+/// <returns> A node holding the key, or NIL. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::searchFromFinger(const keyType& keyValue) const
+{
+    RB_Node* node{ (finger != NIL) ? finger : root };
+
+    if (node == NIL)
+    {
+        return NIL;
+    }
+
+    ++fingerStats.lookups;
+    unsigned long long visited{ 1 };
+    bool reachedRoot{ node == root };
+
+    //Climb while the key lies beyond the ancestor that bounds the node's subtree on the key's side
+    bool goRight{ false };
+    while (keyValue != node->key)
+    {
+        goRight = (node->key < keyValue);
+
+        RB_Node* child{ node };
+        RB_Node* ancestor{ node->parent };
+        while (ancestor != NIL && child == (goRight ? ancestor->right : ancestor->left))
+        {
+            child = ancestor;
+            ancestor = ancestor->parent;
+            ++visited;
+        }
+
+        //With no ancestor on that side, or the key before it, every candidate is below the node
+        if (ancestor == NIL || (goRight ? keyValue < ancestor->key : ancestor->key < keyValue))
+        {
+            reachedRoot = reachedRoot || ancestor == NIL;
+            break;
+        }
+
+        node = ancestor;
+        ++visited;
+        reachedRoot = reachedRoot || node == root;
+    }
+
+    RB_Node* found{ NIL };
+    RB_Node* last{ node };
+
+    if (keyValue == node->key)
+    {
+        found = node;
+    }
+    else
+    {
+        for (RB_Node* traverse{ goRight ? node->right : node->left }; traverse != NIL;)
+        {
+            ++visited;
+            RB_TREE_COUNT_ADD(searchComparisons, 2);
+            last = traverse;
+            if (keyValue == traverse->key)
+            {
+                found = traverse;
+                break;
+            }
+            traverse = (keyValue < traverse->key) ? traverse->left : traverse->right;
+        }
+    }
+
+    finger = (found != NIL) ? found : last;
+    fingerStats.hits += reachedRoot ? 0 : 1;
+    fingerStats.nodesVisited += visited;
+    RB_TREE_COUNT_MAX(maxDescentDepth, visited);
+
+    return found;
+}
+
+/// <summary>
+/// Skips forward over tombstones in LNR order.
+/// </summary>
+/// <param name="node"> The node to start from, may be NIL. </param>
+/// <returns> The first live node at or after node, or NIL. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::firstLive(RB_Node* node) const
+{
+    while (node != NIL && node->tombstone)
+    {
+        node = successor(node);
+    }
+
+    return node;
+}
+
+/// <summary>
+/// Skips backward over tombstones in LNR order.
+/// </summary>
+/// <param name="node"> The node to start from, may be NIL. </param>
+/// <returns> The last live node at or before node, or NIL. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::lastLive(RB_Node* node) const
+{
+    while (node != NIL && node->tombstone)
+    {
+        node = predecessor(node);
+    }
+
+    return node;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Removes one copy of the key held by a live node. A counted key held more than once only loses one copy. Otherwise
+/// in lazy deletion mode the node becomes a tombstone and stays linked, with compact() run once the tombstones pass
+/// the threshold, and outside of it the node is deleted.
+/// </summary>
+/// <param name="node"> A live node of the tree. </param>
+/// <param name="allowCompact"> False to leave compact() to the caller, which may still hold other nodes. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::eraseKey(RB_Node* const node, const bool allowCompact)
+{
+    if constexpr (duplicates == Duplicates::COUNTED)
+    {
+        if (node->count > 1)
+        {
+            --node->count;
+            --numRepeats;
+            return;
+        }
+    }
+
+    if (!lazyDeletion)
+    {
+        RB_delete(node);
+        return;
+    }
+
+    node->tombstone = true;
+    ++numTombstones;
+
+    if (allowCompact && numTombstones > compactThreshold * getNumNodes())
+    {
+        compact();
+    }
+}
+
+/// <summary>
+/// Links a new node into the tree as a child of an existing node whose child on that side is NIL, then
+/// restores the Red-Black properties. The caller is responsible for choosing a position that keeps the keys in order.
+/// </summary>
+/// <param name="parentNode"> The node that becomes the new node's parent, NIL if the tree is empty. </param>
+/// <param name="insertedNode"> A pointer to the node being inserted. </param>
+/// <param name="asLeftChild"> True to link the node as the left child of parentNode, false for the right child. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::attachNode(RB_Node* const parentNode, RB_Node* const insertedNode, const bool asLeftChild)
+{
+    ++structureVersion;
+
+    //Linking a leaf cannot lead a reader away from any other key, so only the rotations of the fixup are marked
+    //Set the inserted node's parent to point to the new parent
+    insertedNode->parent = parentNode;
+
+    //Check if the inserted node is the root, a left child, or a right child and insert the node into the tree
+    if (parentNode == NIL)
+    {
+        root = insertedNode;
+        leftmost = insertedNode;
+        rightmost = insertedNode;
+    }
+    else if (asLeftChild)
+    {
+        parentNode->left = insertedNode;
+
+        //A left child of the smallest node becomes the new smallest node
+        if (parentNode == leftmost)
+        {
+            leftmost = insertedNode;
+        }
+    }
+    else
+    {
+        parentNode->right = insertedNode;
+
+        //A right child of the largest node becomes the new largest node
+        if (parentNode == rightmost)
+        {
+            rightmost = insertedNode;
+        }
+    }
+
+    //The new interval may raise the largest endpoint of every subtree it joined. Rotations keep it up to date after that.
+    updateMaxHighToRoot(insertedNode);
+
+	//Restore RedBlack Tree properties
+    insertFixup(insertedNode);
+
+    //From now on the filter must let lookups of the key through
+    addToFilter(insertedNode->key);
+    addToIndex(insertedNode);
+    finger = insertedNode;
+}
+
+/// <summary>
+/// Records a key linked into the tree in the membership filter, if it is enabled. A full filter is first resized to
+/// twice the nodes of the tree and refilled from them, which keeps the cost amortized O(1) per insert and also
+/// drops the bits of keys removed since. If refilling cannot allocate the key goes into the old filter, which only
+/// makes false positives more likely.
+/// </summary>
+/// <param name="key"> The key of the linked node. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::addToFilter(const keyType& key)
+{
+    if constexpr (KeyHash<keyType>::available)
+    {
+        if (!filter.isEnabled())
+        {
+            return;
+        }
+
+        if (filter.isFull())
+        {
+            try
+            {
+                refillFilter();
+                return;
+            }
+            catch (const std::bad_alloc&)
+            {
+            }
+        }
+        filter.add(KeyHash<keyType>::hash(key));
+    }
+    else
+    {
+        static_cast<void>(key);
+    }
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Sizes the membership filter for twice the nodes of the tree, at least 64 keys, and adds the key of every node.
+/// Tombstones are added too, since an insert can bring them back without linking a node. O(n).
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::refillFilter()
+{
+    if constexpr (KeyHash<keyType>::available)
+    {
+        const unsigned nodes{ getNumNodes() };
+        filter.reset(static_cast<unsigned>(std::max(64ull, std::min(2ull * nodes, 0xFFFFFFFFull))));
+        RB_TREE_COUNT(filterRebuilds);
+
+        for (RB_Node* node{ leftmost }; node != NIL; node = successor(node))
+        {
+            filter.add(KeyHash<keyType>::hash(node->key));
+        }
+    }
+}
+
+/// <summary>
+/// Asks the membership filter whether a key is certainly absent, so a lookup can return without searching.
+/// </summary>
+/// <param name="key"> The key being looked up. </param>
+/// <returns> True if the filter is enabled and rules the key out, otherwise false. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::filterExcludes(const keyType& key) const
+{
+    if constexpr (KeyHash<keyType>::available)
+    {
+        if (filter.isEnabled() && !filter.mayContain(KeyHash<keyType>::hash(key)))
+        {
+            RB_TREE_COUNT(filterRejections);
+            return true;
+        }
+    }
+    else
+    {
+        static_cast<void>(key);
+    }
+
+    return false;
+}
+
+/// <summary>
+/// Adds a node linked into the tree to the hash index, if it is enabled. If the index cannot grow it is turned off,
+/// and lookups search the tree again.
+/// </summary>
+/// <param name="node"> The linked node. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::addToIndex(RB_Node* const node)
+{
+    if (!hashIndex.isEnabled())
+    {
+        return;
+    }
+
+    try
+    {
+        hashIndex.add(node);
+    }
+    catch (const std::bad_alloc&)
+    {
+        hashIndex.setEnabled(false);
+    }
+}
+
+//NOTE: Memory is allocated and freed in this function
+/// <summary>
+/// Rebuilds the hash index from every node, tombstones included, after nodes were linked without attachNode or
+/// moved to new addresses. Does nothing if the index is disabled. If the new table cannot be allocated the index is
+/// turned off rather than left pointing at the old nodes. O(n).
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::rebuildIndex()
+{
+    if (!hashIndex.isEnabled())
+    {
+        return;
+    }
+
+    try
+    {
+        NodeIndex<keyType, RB_Node> rebuilt;
+        rebuilt.setEnabled(true);
+        rebuilt.reset(getNumNodes());
+        for (RB_Node* node{ leftmost }; node != NIL; node = successor(node))
+        {
+            rebuilt.add(node);
+        }
+        hashIndex = std::move(rebuilt);
+    }
+    catch (const std::bad_alloc&)
+    {
+        hashIndex.setEnabled(false);
+    }
+}
+
+/// <summary>
+/// Finds the live node a full bounded tree evicts next: the smallest under Eviction::SMALLEST, otherwise the
+/// largest. O(1) unless tombstones sit at that end of the tree.
+/// </summary>
+/// <returns> The node, or NIL if the tree holds no keys. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::evictionCandidate() const
+{
+    RB_Node* node{ (eviction == Eviction::SMALLEST) ? leftmost : rightmost };
+
+    while (node != NIL && node->tombstone)
+    {
+        node = (eviction == Eviction::SMALLEST) ? successor(node) : predecessor(node);
+    }
+    return node;
+}
+
+/// <summary>
+/// Tells whether an insert of a key should be turned away: the tree is bounded and full, and the key is not beyond
+/// the next key to be evicted, so it would be evicted as soon as it went in. Costs one key comparison.
+/// </summary>
+/// <param name="key"> The key being inserted. </param>
+/// <returns> True if the insert should leave the tree unchanged. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::rejectsKey(const keyType& key) const
+{
+    if (capacity == 0 || getNumKeys() < capacity)
+    {
+        return false;
+    }
+
+    const RB_Node* const candidate{ evictionCandidate() };
+    const bool rejected{ (eviction == Eviction::SMALLEST) ? !(candidate->key < key) : !(key < candidate->key) };
+
+    if (rejected)
+    {
+        RB_TREE_COUNT(capacityRejections);
+    }
+    return rejected;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Removes keys from the evicting end of a bounded tree until it holds no more than its capacity, as remove would.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::evictOverflow()
+{
+    while (capacity != 0 && getNumKeys() > capacity)
+    {
+        RB_TREE_COUNT(evictions);
+        RB_Node* const candidate{ evictionCandidate() };
+        RB_TREE_TRACE_OP(OpType::REMOVE, candidate->key);
+        eraseKey(candidate);
+    }
+}
+
+/// <summary>
+/// Unlinks a node from the tree and rebalances. The node itself is not freed or modified, so it can be handed to a
+/// node handle or deleted by the caller. Repeat counts are the caller's responsibility.
+/// </summary>
+/// <param name="nodeToDelete"> A pointer to the node being unlinked, must not be NIL. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::detachNode(RB_Node* nodeToDelete)
+{
+    ++structureVersion;
+
+    hashIndex.erase(nodeToDelete);
+
+    //The parent stays linked, so a finger on the node moves there
+    if (nodeToDelete == finger)
+    {
+        finger = (nodeToDelete->parent != NIL) ? nodeToDelete->parent : NIL;
+    }
+
+    RB_Node* y = nodeToDelete;
+    RB_Node* replacement;
+    Color originalColor = nodeToDelete->nodeColor;
+
+    //When the smallest or largest node is removed its neighbor takes its place. Rebalancing moves nodes but never
+    //changes their order, so this is the only place the cached pointers have to be updated.
+    if (nodeToDelete == leftmost)
+    {
+        leftmost = successor(nodeToDelete);
+    }
+    if (nodeToDelete == rightmost)
+    {
+        rightmost = predecessor(nodeToDelete);
+    }
+
+    if (nodeToDelete->left == NIL)
+    {
+        replacement = nodeToDelete->right;
+        transplant(nodeToDelete, nodeToDelete->right);
+    }
+    else if (nodeToDelete->right == NIL)
+    {
+        replacement = nodeToDelete->left;
+        transplant(nodeToDelete, nodeToDelete->left);
+    }
+    else
+    {
+        y = minimum(nodeToDelete->right);
+        originalColor = y->nodeColor;
+        replacement = y->right;
+
+        //y moves out of the subtrees between it and the deleted node. Splicing out a node with one child needs no
+        //marking, since its own links still lead to every key below it.
+        const std::initializer_list<RB_Node*> changed{ nodeToDelete->parent, nodeToDelete, nodeToDelete->left,
+                                                       nodeToDelete->right, y->parent, y, replacement };
+        beginWrite(changed);
+
+        if (y->parent == nodeToDelete)
+        {
+            replacement->parent = y;
+        }
+        else
+        {
+            transplant(y, y->right);
+            y->right = nodeToDelete->right;
+            y->right->parent = y;
+        }
+
+        transplant(nodeToDelete, y);
+        y->left = nodeToDelete->left;
+        y->left->parent = y;
+
+        //The node y will be recolored with the color of the node we are deleting
+        //If the node colors are different, then y will change color and the counters are adjusted
+        if (y->nodeColor != nodeToDelete->nodeColor)
+        {
+            //y changes color to the color of the node being deleted
+            if (nodeToDelete->nodeColor == Color::BLACK)
+            {
+                ++numBlackNodes;
+                --numRedNodes;
+            }
+            else
+            {
+                ++numRedNodes;
+                --numBlackNodes;
+            }
+        }
+
+        y->nodeColor = nodeToDelete->nodeColor;
+
+        //In rank balanced trees y also takes over the rank of the node it replaces
+        if constexpr (balance != Balance::RED_BLACK)
+        {
+            y->rank = nodeToDelete->rank;
+        }
+
+        endWrite(changed);
+    }
+
+    //Every subtree the removed interval or the moved node y left is on the path up from the replacement
+    updateMaxHighToRoot(replacement->parent);
+
+    //Adjust the appropriate counter before removing a node
+    if (nodeToDelete->nodeColor == Color::BLACK)
+    {
+        --numBlackNodes;
+    }
+    else
+    {
+        --numRedNodes;
+    }
+
+    //Restore the balance of the tree. The replacement's parent pointer is valid even when the replacement is NIL.
+    if constexpr (balance == Balance::AVL)
+    {
+        avlRebalance(replacement->parent);
+    }
+    else if constexpr (balance == Balance::WAVL)
+    {
+        wavlDeleteFixup(replacement);
+    }
+    else if (originalColor == Color::BLACK)
+    {
+        deleteFixup(replacement);
+    }
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Removes a node from the tree and frees it.
+/// </summary>
+/// <param name="nodeToDelete"> A pointer to the node being deleted, must not be NIL. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::RB_delete(RB_Node* nodeToDelete)
+{
+    detachNode(nodeToDelete);
+
+	//Free allocated memory
+    disposeNode(nodeToDelete);
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Frees a node that is no longer linked into the tree. With RB_TREE_CONCURRENT_READS enabled a reader may still be
+/// standing on the node, so it is retired instead and freed by reclaim() once those readers have left. The writer
+/// reclaims every 1024 retired nodes, but not in the middle of a change such as compact(), because readers wait for
+/// the change to finish before they leave.
+/// </summary>
+/// <param name="node"> A pointer to the unlinked node. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::disposeNode(RB_Node* const node)
+{
+#if RB_TREE_CONCURRENT_READS
+    //A retired node is no longer linked, so the finger cannot wait for reclaim to move off it
+    if (node == finger)
+    {
+        finger = NIL;
+    }
+    retiredNodes.push_back(node);
+    if (retiredNodes.size() >= retireBatch && (writeSequence.load(std::memory_order_relaxed) & 1) == 0)
+    {
+        reclaim();
+    }
+#else
+    freeNode(node);
+#endif
+}
+
+/// <summary>
+/// Marks the start of a change to the links concurrent readers follow. The write sequence becomes odd, and so does the
+/// version of every node whose links the change rewrites, so a reader that passed one of them finds its version
+/// changed and searches again. Does nothing unless RB_TREE_CONCURRENT_READS is enabled.
+/// </summary>
+/// <param name="nodes"> The nodes whose links change, the same list that is passed to endWrite. NIL and repeated nodes are allowed. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::beginWrite(std::initializer_list<RB_Node*> nodes)
+{
+#if RB_TREE_CONCURRENT_READS
+    writeSequence.store(writeSequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    for (RB_Node* const node : nodes)
+    {
+        markChanging(node);
+    }
+#else
+    static_cast<void>(nodes);
+#endif
+}
+
+/// <summary>
+/// Marks the end of a change started by beginWrite, making the write sequence and the versions of the nodes even
+/// again. Does nothing unless RB_TREE_CONCURRENT_READS is enabled.
+/// </summary>
+/// <param name="nodes"> The nodes passed to beginWrite. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::endWrite(std::initializer_list<RB_Node*> nodes)
+{
+#if RB_TREE_CONCURRENT_READS
+    for (RB_Node* const node : nodes)
+    {
+        markChanged(node);
+    }
+    writeSequence.store(writeSequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+#else
+    static_cast<void>(nodes);
+#endif
+}
+
+/// <summary>
+/// Makes a node's version odd before its links are rewritten. A node that is already odd is part of the same change.
+/// Does nothing unless RB_TREE_CONCURRENT_READS is enabled.
+/// </summary>
+/// <param name="node"> The node whose links change, may be NIL. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::markChanging(RB_Node* const node)
+{
+#if RB_TREE_CONCURRENT_READS
+    if (node != NIL && (node->version & 1) == 0)
+    {
+        node->version = node->version + 1;
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+#else
+    static_cast<void>(node);
+#endif
+}
+
+/// <summary>
+/// Makes a node's version even again once its links are rewritten. Does nothing unless RB_TREE_CONCURRENT_READS is
+/// enabled.
+/// </summary>
+/// <param name="node"> A node passed to markChanging, may be NIL. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::markChanged(RB_Node* const node)
+{
+#if RB_TREE_CONCURRENT_READS
+    if (node != NIL && (node->version & 1) != 0)
+    {
+        node->version = node->version + 1;
+    }
+#else
+    static_cast<void>(node);
+#endif
+}
+
+#if RB_TREE_TRACE
+/// <summary>
+/// Passes an operation to the trace recorder, if one is set. Keys that are not trivially copyable are never recorded.
+/// </summary>
+/// <param name="type"> The kind of operation. </param>
+/// <param name="key"> The key the operation was called with. </param>
+/// <param name="copies"> The number of times the operation is recorded, one per copy of the key it stands for. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::traceOperation(const OpType type, const keyType& key, const unsigned copies) const
+{
+    if constexpr (std::is_trivially_copyable<keyType>::value)
+    {
+        for (unsigned i{ 0 }; traceRecorder != nullptr && i < copies; ++i)
+        {
+            traceRecorder->record(type, key);
+        }
+    }
+}
+#endif
+
+#if RB_TREE_CONCURRENT_READS
+/// <summary>
+/// Returns the reader slot of the calling thread. Threads are handed slots in the order they first read, and wrap
+/// around to share slots once there are more than maxReaderSlots of them.
+/// </summary>
+/// <returns> Index into readerSlots. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+unsigned RB_Tree<keyType, duplicates, balance, Allocator>::readerSlotIndex()
+{
+    static std::atomic<unsigned> nextSlot{ 0 };
+    thread_local const unsigned slot{ nextSlot.fetch_add(1, std::memory_order_relaxed) % maxReaderSlots };
+
+    return slot;
+}
+
+/// <summary>
+/// Waits out a grace period: returns once every reader that entered concurrentContainsKey before the call has left.
+/// Advancing the epoch sends new readers to the other parity, so after advancing twice and waiting for the parity
+/// left behind to drain each time, no reader from before the call remains. New readers never hold up the wait.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::waitForReaders()
+{
+    for (int flip{ 0 }; flip < 2; ++flip)
+    {
+        const unsigned parity{ static_cast<unsigned>(readerEpoch.fetch_add(1) & 1) };
+
+        for (const ReaderSlot& slot : readerSlots)
+        {
+            while (slot.readers[parity].load() != 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+#endif
+
+/// <summary>
+/// Compares two integers and returns the beg
+/// </summary>
+/// <param name="a"> First integer being compared. </param>
+/// <param name="b"> Second integer being compared. </param>
+/// <returns> The maximum of the two integers. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+int RB_Tree<keyType, duplicates, balance, Allocator>::maximum(const int a, const int b) const
+{
+    return (a > b) ? a : b;
+}
+
+/// <summary>
+/// Calculates the height of the tree rooted at the node passed as a paramater.
+/// </summary>
+/// <param name="subtreeRoot"> Pointer to the root of the subtree height is being calculated for. </param>
+/// <returns> The height of the subtree as an int. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+int RB_Tree<keyType, duplicates, balance, Allocator>::calculateSubtreeHeight(const RB_Node* const subtreeRoot) const
+{
+	//If our subtree is empty, return height of -1
+    if (subtreeRoot == NIL)
+    {
+        return -1;
+    }
+	//Otherwise, return the maximum of the height of the left and right subtrees of the current node
+    else
+    {
+        return maximum(calculateSubtreeHeight(subtreeRoot->left), calculateSubtreeHeight(subtreeRoot->right)) + 1;
+    }
+}
+
+/// <summary>
+/// Allocates a new red black tree by copying the structure of another.
+/// </summary>
+/// <param name="copyTo_parent"> Pointer to the parent of node being copied to. </param>
+/// <param name="copyFrom"> Pointer to the node being copied. </param>
+/// <param name="copyFrom_NIL"> Pointer to the NIL node in the tree being copied from. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::copyTree(RB_Node* copyTo_parent, RB_Node* copyFrom, RB_Node* copyFrom_NIL)
+{
+	//If the node from the subtree we are copying from is that tree's NIL node, there is nothing to copy
+	if (copyFrom == copyFrom_NIL)
+	{
+		return;
+	}
+
+	//The node being copied is not NIL so allocate a new node and perform the copy
+	RB_Node* copyTo{ allocateNode(copyFrom->key) };
+	copyTo->nodeColor = copyFrom->nodeColor;
+	copyTo->tombstone = copyFrom->tombstone;
+	if constexpr (duplicates == Duplicates::COUNTED)
+	{
+		copyTo->count = copyFrom->count;
+	}
+	if constexpr (balance != Balance::RED_BLACK)
+	{
+		copyTo->rank = copyFrom->rank;
+	}
+	if constexpr (intervalKeys)
+	{
+		copyTo->maxHigh = copyFrom->maxHigh;
+	}
+	copyTo->parent = copyTo_parent;
+	copyTo->left = NIL;
+	copyTo->right = NIL;
+	
+	//If the tree being copied to happens to be empty, set the root to the new node that was allocated.
+	//Otherwise check if the node being copied to is a left or right child and link it accordingly. The side is taken
+	//from the tree being copied rather than from the keys, since equal keys can sit on either side of each other.
+	if (root == NIL)
+	{
+		root = copyTo;
+	}
+	else if (copyFrom == copyFrom->parent->left)
+	{
+		copyTo_parent->left = copyTo;
+	}
+	else
+	{
+		copyTo_parent->right = copyTo;
+	}
+
+	//Recursively call the copySubtree function twice with the node being copied to as the copyTo_parent in the next calls
+	//and the left and right children of the node being copied as the copyFrom node in the next calls
+	copyTree(copyTo, copyFrom->left, copyFrom_NIL);
+	copyTree(copyTo, copyFrom->right, copyFrom_NIL);
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Moves a subtree into newly allocated nodes, in NLR order. Keys are moved rather than copied and shrunk through
+/// KeyHeapUsage. The old nodes keep their links and are left for the caller to free.
+/// </summary>
+/// <param name="relocateFrom"> The root of the subtree being relocated. </param>
+/// <param name="newParent"> The already relocated parent of relocateFrom, or NIL for the root. </param>
+/// <returns> A pointer to the relocated copy of relocateFrom. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::relocateSubtree(RB_Node* const relocateFrom, RB_Node* const newParent)
+{
+    if (relocateFrom == NIL)
+    {
+        return NIL;
+    }
+
+    RB_Node* const relocateTo{ allocateNode(std::move(relocateFrom->key)) };
+
+    KeyHeapUsage<keyType>::shrink(relocateTo->key);
+    relocateTo->nodeColor = relocateFrom->nodeColor;
+    relocateTo->tombstone = relocateFrom->tombstone;
+    if constexpr (duplicates == Duplicates::COUNTED)
+    {
+        relocateTo->count = relocateFrom->count;
+    }
+    if constexpr (balance != Balance::RED_BLACK)
+    {
+        relocateTo->rank = relocateFrom->rank;
+    }
+    if constexpr (intervalKeys)
+    {
+        relocateTo->maxHigh = std::move(relocateFrom->maxHigh);
+    }
+    relocateTo->parent = newParent;
+    relocateTo->left = relocateSubtree(relocateFrom->left, relocateTo);
+    relocateTo->right = relocateSubtree(relocateFrom->right, relocateTo);
+
+    return relocateTo;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Frees every node of a subtree in LRN order without rebalancing. The caller must unlink the subtree first.
+/// </summary>
+/// <param name="subtreeRoot"> The root of the subtree being freed. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::freeSubtree(RB_Node* const subtreeRoot)
+{
+    if (subtreeRoot == NIL)
+    {
+        return;
+    }
+
+    freeSubtree(subtreeRoot->left);
+    freeSubtree(subtreeRoot->right);
+
+    freeNode(subtreeRoot);
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Frees nodes of unlinked subtrees without recursing, so the work can stop after any node. The stack starts with the
+/// roots of the subtrees; each node freed is replaced on it by its children. Static so the reclaimer thread can run it
+/// after the tree is gone, which is why the NIL node is passed in and never dereferenced.
+/// </summary>
+/// <param name="allocator"> The allocator the nodes came from. </param>
+/// <param name="stack"> Nodes still to be freed together with their subtrees. </param>
+/// <param name="detachedNIL"> The NIL node the subtrees' leaves link to. </param>
+/// <param name="budget"> The most nodes to free. </param>
+/// <returns> The number of nodes freed. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+std::size_t RB_Tree<keyType, duplicates, balance, Allocator>::freeDetached(NodeAllocator& allocator, std::vector<RB_Node*>& stack,
+    const RB_Node* const detachedNIL, const std::size_t budget)
+{
+    std::size_t freed{ 0 };
+
+    while (!stack.empty() && freed < budget)
+    {
+        RB_Node* const node{ stack.back() };
+        stack.pop_back();
+
+        //The left child goes on top, so nodes are freed roughly in key order, which is close to allocation order
+        if (node->right != detachedNIL)
+        {
+            stack.push_back(node->right);
+        }
+        if (node->left != detachedNIL)
+        {
+            stack.push_back(node->left);
+        }
+
+        NodeTraits::destroy(allocator, node);
+        NodeTraits::deallocate(allocator, node, 1);
+        ++freed;
+    }
+
+    return freed;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Frees up to teardownChunk nodes left by a Teardown::DEFERRED destroyTree. Called at the start of every insert
+/// and remove, and does nothing when no nodes are pending.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::continueTeardown()
+{
+    if (!pendingNodes.empty())
+    {
+        const std::size_t freed{ freeDetached(nodeAllocator, pendingNodes, NIL, teardownChunk) };
+        numPendingNodes -= static_cast<unsigned>(freed);
+        RB_TREE_COUNT_ADD(nodeFrees, freed);
+    }
+}
+
+/// <summary>
+/// Hands every pending node to the reclaimer thread together with a copy of the allocator. If the hand-off cannot
+/// be queued the nodes are freed here instead.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::handOffPending()
+{
+    if (pendingNodes.empty())
+    {
+        return;
+    }
+
+    try
+    {
+        BackgroundReclaimer::instance().submit(
+            [allocator = nodeAllocator, stack = pendingNodes, detachedNIL = static_cast<const RB_Node*>(NIL)]() mutable
+            {
+                freeDetached(allocator, stack, detachedNIL, static_cast<std::size_t>(-1));
+            });
+    }
+    catch (...)
+    {
+        finishTeardown();
+        return;
+    }
+
+    RB_TREE_COUNT_ADD(nodeFrees, numPendingNodes);
+    pendingNodes.clear();
+    numPendingNodes = 0;
+}
+
+/// <summary>
+/// Estimates the bytes a general purpose allocator adds to an allocation: a size header, rounding up to twice the
+/// pointer size and a minimum chunk of four pointers. This is how glibc malloc behaves; other allocators differ by
+/// a few bytes per allocation.
+/// </summary>
+/// <param name="requested"> The number of bytes requested. </param>
+/// <returns> The estimated bytes used beyond those requested. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+std::size_t RB_Tree<keyType, duplicates, balance, Allocator>::allocationOverhead(const std::size_t requested)
+{
+    const std::size_t alignment{ 2 * sizeof(void*) };
+    const std::size_t minimumChunk{ 4 * sizeof(void*) };
+    const std::size_t chunk{ (requested + sizeof(std::size_t) + alignment - 1) / alignment * alignment };
+
+    return ((chunk < minimumChunk) ? minimumChunk : chunk) - requested;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Unthreads a subtree in LNR order, freeing its tombstones and chaining its live nodes into a list through their right
+/// links. The right child is read before a node is freed or appended, so each node is visited once.
+/// </summary>
+/// <param name="node"> The root of the subtree being collected. </param>
+/// <param name="head"> The first node of the list, NIL while the list is empty. </param>
+/// <param name="tail"> The last node of the list, NIL while the list is empty. </param>
+/// <param name="count"> Incremented for every node appended to the list. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::collectLive(RB_Node* const node, RB_Node*& head, RB_Node*& tail, unsigned& count)
+{
+    if (node == NIL)
+    {
+        return;
+    }
+
+    //Marked before anything below it is threaded into the list
+    markChanging(node);
+    collectLive(node->left, head, tail, count);
+
+    RB_Node* const rightChild{ node->right };
+
+    if (node->tombstone)
+    {
+        hashIndex.erase(node);
+        disposeNode(node);
+    }
+    else
+    {
+        if (tail == NIL)
+        {
+            head = node;
+        }
+        else
+        {
+            tail->right = node;
+        }
+        tail = node;
+        ++count;
+    }
+
+    collectLive(rightChild, head, tail, count);
+}
+
+/// <summary>
+/// Builds a balanced subtree from the next count nodes of a list made by collectLive. The middle node becomes the
+/// root, so the depths of the NIL leaves differ by at most one. For Red-Black trees every node is black except the
+/// ones on the deepest level, which makes every path from the root hold the same number of black nodes. For AVL and
+/// WAVL trees a node's rank is its height.
+/// </summary>
+/// <param name="list"> The next node of the list, advanced past the nodes used. </param>
+/// <param name="count"> The number of nodes in the subtree. </param>
+/// <param name="depth"> The depth of the subtree's root in the whole tree. </param>
+/// <param name="redDepth"> The depth of the deepest level of the whole tree. </param>
+/// <returns> The root of the subtree, NIL if count is 0. Its parent link is left for the caller to set. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::buildBalanced(RB_Node*& list, const unsigned count, const int depth, const int redDepth)
+{
+    if (count == 0)
+    {
+        return NIL;
+    }
+
+    const unsigned leftCount{ (count - 1) / 2 };
+
+    RB_Node* const leftChild{ buildBalanced(list, leftCount, depth + 1, redDepth) };
+    RB_Node* const node{ list };
+    list = list->right;
+    RB_Node* const rightChild{ buildBalanced(list, count - 1 - leftCount, depth + 1, redDepth) };
+
+    node->left = leftChild;
+    node->right = rightChild;
+    if (leftChild != NIL)
+    {
+        leftChild->parent = node;
+    }
+    if (rightChild != NIL)
+    {
+        rightChild->parent = node;
+    }
+    updateMaxHigh(node);
+
+    if constexpr (balance == Balance::RED_BLACK)
+    {
+        if (depth == redDepth)
+        {
+            node->nodeColor = Color::RED;
+            ++numRedNodes;
+        }
+        else
+        {
+            node->nodeColor = Color::BLACK;
+            ++numBlackNodes;
+        }
+    }
+    else
+    {
+        //The height of a subtree built this way is floor(log2(count))
+        node->nodeColor = Color::BLACK;
+        node->rank = static_cast<signed char>(floorLog2(count));
+        ++numBlackNodes;
+    }
+
+    return node;
+}
+
+/// <summary>
+/// Calculates the base 2 logarithm of a positive number, rounded down.
+/// </summary>
+/// <param name="n"> A number greater than 0. </param>
+/// <returns> floor(log2(n)). </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+int RB_Tree<keyType, duplicates, balance, Allocator>::floorLog2(unsigned n)
+{
+    int result{ 0 };
+
+    while (n > 1)
+    {
+        n >>= 1;
+        ++result;
+    }
+
+    return result;
+}
+
+/// <summary>
+/// Appends the nodes of a subtree in NLR order.
+/// </summary>
+/// <param name="node"> The root of the subtree. </param>
+/// <param name="order"> The list the nodes are appended to. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::collectPreorder(RB_Node* const node, std::vector<RB_Node*>& order) const
+{
+    if (node == NIL)
+    {
+        return;
+    }
+
+    order.push_back(node);
+    collectPreorder(node->left, order);
+    collectPreorder(node->right, order);
+}
+
+/// <summary>
+/// Appends the top levels of a subtree in van Emde Boas order. The top half of the levels is laid out first,
+/// recursively, followed by each subtree hanging below it from left to right, also recursively.
+/// </summary>
+/// <param name="node"> The root of the subtree. </param>
+/// <param name="levels"> The number of levels of the subtree to append, counting node as the first. </param>
+/// <param name="order"> The list the nodes are appended to. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::collectVeb(RB_Node* const node, const int levels, std::vector<RB_Node*>& order) const
+{
+    if (node == NIL || levels <= 0)
+    {
+        return;
+    }
+
+    if (levels == 1)
+    {
+        order.push_back(node);
+        return;
+    }
+
+    const int topLevels{ levels / 2 };
+
+    collectVeb(node, topLevels, order);
+    collectVebBottoms(node, topLevels, levels - topLevels, order);
+}
+
+/// <summary>
+/// Appends, in van Emde Boas order, the subtrees rooted a given number of levels below a node, from left to right.
+/// </summary>
+/// <param name="node"> The node the depth is measured from. </param>
+/// <param name="depth"> How many levels below node the subtrees are rooted. </param>
+/// <param name="levels"> The number of levels of each subtree to append. </param>
+/// <param name="order"> The list the nodes are appended to. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::collectVebBottoms(RB_Node* const node, const int depth, const int levels, std::vector<RB_Node*>& order) const
+{
+    if (node == NIL)
+    {
+        return;
+    }
+
+    if (depth == 0)
+    {
+        collectVeb(node, levels, order);
+        return;
+    }
+
+    collectVebBottoms(node->left, depth - 1, levels, order);
+    collectVebBottoms(node->right, depth - 1, levels, order);
+}
+
+/// <summary>
+/// Plans the moves that put the nodes into a layout. The nodes already own a set of addresses, and the plan assigns
+/// them so that addresses increase along the layout: the i-th node of the layout goes to the i-th lowest address.
+/// </summary>
+/// <param name="layout"> The order the nodes should follow in memory. </param>
+/// <returns> A plan with no moves made yet. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+std::unique_ptr<typename RB_Tree<keyType, duplicates, balance, Allocator>::DefragmentPlan> RB_Tree<keyType, duplicates, balance, Allocator>::planDefragment(const Layout layout) const
+{
+    std::unique_ptr<DefragmentPlan> plan{ new DefragmentPlan };
+    plan->next = 0;
+    plan->version = structureVersion;
+    plan->layout = layout;
+
+    std::vector<RB_Node*> order;
+    order.reserve(getNumNodes());
+
+    switch (layout)
+    {
+    case Layout::DEPTH_FIRST:
+        collectPreorder(root, order);
+        break;
+    case Layout::VEB:
+        collectVeb(root, calculateSubtreeHeight(root) + 1, order);
+        break;
+    default:
+        for (RB_Node* node{ leftmost }; node != NIL; node = successor(node))
+        {
+            order.push_back(node);
+        }
+        break;
+    }
+
+    plan->slots = order;
+    std::sort(plan->slots.begin(), plan->slots.end(), std::less<RB_Node*>{});
+
+    plan->occupant.resize(order.size());
+    plan->location.resize(order.size());
+    for (std::size_t position{ 0 }; position < order.size(); ++position)
+    {
+        const std::size_t slot{ static_cast<std::size_t>(std::lower_bound(plan->slots.begin(), plan->slots.end(), order[position],
+            std::less<RB_Node*>{}) - plan->slots.begin()) };
+
+        plan->location[position] = static_cast<unsigned>(slot);
+        plan->occupant[slot] = static_cast<unsigned>(position);
+    }
+
+    return plan;
+}
+
+/// <summary>
+/// Makes the moves of a plan, one node at a time. Each move exchanges the contents of two slots, so the tree is
+/// valid between moves.
+/// </summary>
+/// <param name="plan"> A plan made by planDefragment for the tree as it is now. </param>
+/// <param name="deadline"> The time to stop at, or nullptr to make every move. </param>
+/// <returns> True if every node is in place. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::stepDefragment(DefragmentPlan& plan, const std::chrono::steady_clock::time_point* const deadline)
+{
+    //The clock is read once per batch of moves, a move takes far less time than a clock read. The first batch is
+    //always made, so every call makes progress however short its time slice.
+    constexpr std::size_t movesPerClockRead{ 64 };
+    std::size_t moves{ 0 };
+
+    while (plan.next < plan.slots.size())
+    {
+        if (deadline != nullptr && moves == movesPerClockRead)
+        {
+            if (std::chrono::steady_clock::now() >= *deadline)
+            {
+                return false;
+            }
+            moves = 0;
+        }
+        ++moves;
+
+        const std::size_t position{ plan.next };
+        const std::size_t slot{ plan.location[position] };
+
+        //Slot 'position' belongs to the node at this layout position, which is currently stored in 'slot'
+        if (slot != position)
+        {
+            const unsigned displaced{ plan.occupant[position] };
+
+            swapSlots(plan.slots[position], plan.slots[slot]);
+
+            plan.occupant[position] = static_cast<unsigned>(position);
+            plan.location[position] = static_cast<unsigned>(position);
+            plan.occupant[slot] = displaced;
+            plan.location[displaced] = static_cast<unsigned>(slot);
+        }
+
+        ++plan.next;
+    }
+
+    return true;
+}
+
+/// <summary>
+/// Exchanges the positions in the tree of the nodes stored at two addresses. The contents of the nodes are swapped,
+/// then the links that pointed to one address are pointed to the other. Neither address may be NIL.
+/// </summary>
+/// <param name="a"> The first node. </param>
+/// <param name="b"> The second node. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::swapSlots(RB_Node* const a, RB_Node* const b)
+{
+    //The side each node hangs on has to be read before anything moves
+    const bool aIsLeftChild{ a->parent != NIL && a->parent->left == a };
+    const bool bIsLeftChild{ b->parent != NIL && b->parent->left == b };
+
+    //The index entries follow the keys
+    hashIndex.exchange(a, b);
+
+    std::swap(a->key, b->key);
+    std::swap(a->nodeColor, b->nodeColor);
+    std::swap(a->tombstone, b->tombstone);
+    if constexpr (duplicates == Duplicates::COUNTED)
+    {
+        std::swap(a->count, b->count);
+    }
+    if constexpr (balance != Balance::RED_BLACK)
+    {
+        std::swap(a->rank, b->rank);
+    }
+    if constexpr (intervalKeys)
+    {
+        std::swap(a->maxHigh, b->maxHigh);
+    }
+    std::swap(a->parent, b->parent);
+    std::swap(a->left, b->left);
+    std::swap(a->right, b->right);
+
+    //If one node was linked to the other, that link now points at the node itself and has to point back across
+    for (RB_Node* const node : { a, b })
+    {
+        RB_Node* const other{ (node == a) ? b : a };
+
+        if (node->parent == node)
+        {
+            node->parent = other;
+        }
+        if (node->left == node)
+        {
+            node->left = other;
+        }
+        if (node->right == node)
+        {
+            node->right = other;
+        }
+    }
+
+    relinkSlot(a, bIsLeftChild);
+    relinkSlot(b, aIsLeftChild);
+
+    if (leftmost == a || leftmost == b)
+    {
+        leftmost = (leftmost == a) ? b : a;
+    }
+    if (rightmost == a || rightmost == b)
+    {
+        rightmost = (rightmost == a) ? b : a;
+    }
+}
+
+/// <summary>
+/// Points the parent and children of a node at the node's address. Used after the node was moved by swapSlots.
+/// </summary>
+/// <param name="node"> The moved node. </param>
+/// <param name="isLeftChild"> True if the node is the left child of its parent. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::relinkSlot(RB_Node* const node, const bool isLeftChild)
+{
+    if (node->parent == NIL)
+    {
+        root = node;
+    }
+    else if (isLeftChild)
+    {
+        node->parent->left = node;
+    }
+    else
+    {
+        node->parent->right = node;
+    }
+
+    if (node->left != NIL)
+    {
+        node->left->parent = node;
+    }
+    if (node->right != NIL)
+    {
+        node->right->parent = node;
+    }
+}
+
+/// <summary>
+/// Perform a LNR traversal of some tree and insert each node in that tree into THIS tree.
+/// </summary>
+/// <param name="traverse"> Pointer to a node in the tree being traversed. </param>
+/// <param name="traverseTreeNIL"> Pointer to the NIL node in the tree being traversed. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::traverseInsert(const RB_Node* const traverse, const RB_Node* const traverseTreeNIL)
+{
+	// If node is NIL, return recursively to the function called from.
+	if (traverse == traverseTreeNIL)
+		return;
+
+	// Recursively call the function to the left of the tree.
+	traverseInsert(traverse->left, traverseTreeNIL);
+
+	// Insert the key value of the traverse node into THIS tree, once for every copy it holds
+	for (unsigned copies{ keyCount(traverse) }; copies > 0; --copies)
+	{
+		insert(traverse->key);
+	}
+
+	// Recursively call the function to the right of the tree.
+	traverseInsert(traverse->right, traverseTreeNIL);
+}
+
+/// <summary>
+/// Computes the intersection, difference or symmetric difference of THIS tree and another as multisets. A key held
+/// a times here and b times in the other tree is held min(a, b), max(a - b, 0) or |a - b| times in the result. The
+/// result is built from a sorted list of new nodes in linear time rather than by inserting. Both trees are walked in
+/// order together, unless an intersection or a difference has one side much smaller than the other. Then every key
+/// of the smaller side is looked up in the larger one with a finger search from the previous match. That costs
+/// O(m log(n/m)) for m keys against n.
+/// </summary>
+/// <param name="right"> The tree on the right of the operator. </param>
+/// <param name="operation"> The set operation. </param>
+/// <returns> A new tree with the allocator a copy of THIS tree would get and THIS tree's settings. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator> RB_Tree<keyType, duplicates, balance, Allocator>::combineTrees(const RB_Tree& right, const SetOperation operation) const
+{
+    RB_Tree result{ Allocator{ NodeTraits::select_on_container_copy_construction(nodeAllocator) } };
+    result.lazyDeletion = lazyDeletion;
+    result.compactThreshold = compactThreshold;
+    result.capacity = capacity;
+    result.eviction = eviction;
+    result.teardown = teardown;
+    result.teardownChunk = teardownChunk;
+    result.filter.setBitsPerKey(filter.getBitsPerKey());
+    result.fingerSearch = fingerSearch;
+    result.hashIndex.setEnabled(hashIndex.isEnabled());
+
+    RB_Node* head{ result.NIL };
+    RB_Node* tail{ result.NIL };
+    unsigned count{ 0 };
+
+    try
+    {
+        const unsigned leftSize{ getNumNodes() };
+        const unsigned rightSize{ right.getNumNodes() };
+
+        if (operation != SetOperation::SYMMETRIC_DIFFERENCE && leftSize <= rightSize && preferGalloping(leftSize, rightSize))
+        {
+            //Few keys on the left: look each one up in the right tree
+            RB_Node* cursor{ right.firstLive(right.leftmost) };
+
+            for (RB_Node* node{ firstLive(leftmost) }; node != NIL; node = firstLive(successor(node)))
+            {
+                cursor = right.lowerBoundFrom(cursor, node->key);
+                const bool found{ cursor != right.NIL && !(node->key < cursor->key) };
+                const unsigned leftCopies{ keyCount(node) };
+                const unsigned rightCopies{ found ? right.keyCount(cursor) : 0 };
+
+                const unsigned copies{ (operation == SetOperation::INTERSECTION) ? std::min(leftCopies, rightCopies) :
+                                       (leftCopies > rightCopies) ? leftCopies - rightCopies : 0 };
+                if (copies > 0)
+                {
+                    result.appendCopy(head, tail, count, node->key, copies);
+                }
+                if (found)
+                {
+                    cursor = right.firstLive(right.successor(cursor));
+                }
+                else if (operation == SetOperation::INTERSECTION && cursor == right.NIL)
+                {
+                    break;
+                }
+            }
+        }
+        else if (operation == SetOperation::INTERSECTION && preferGalloping(rightSize, leftSize))
+        {
+            //Few keys on the right: look each one up in THIS tree
+            RB_Node* cursor{ firstLive(leftmost) };
+
+            for (RB_Node* node{ right.firstLive(right.leftmost) }; node != right.NIL && cursor != NIL;
+                 node = right.firstLive(right.successor(node)))
+            {
+                cursor = lowerBoundFrom(cursor, node->key);
+                if (cursor != NIL && !(node->key < cursor->key))
+                {
+                    result.appendCopy(head, tail, count, cursor->key, std::min(keyCount(cursor), right.keyCount(node)));
+                    cursor = firstLive(successor(cursor));
+                }
+            }
+        }
+        else
+        {
+            //Linear merge. Equal keys of a Duplicates::MULTI_NODE tree sit in adjacent nodes and are paired off one by one.
+            RB_Node* left{ firstLive(leftmost) };
+            RB_Node* other{ right.firstLive(right.leftmost) };
+
+            while (left != NIL && other != right.NIL)
+            {
+                if (left->key < other->key)
+                {
+                    if (operation != SetOperation::INTERSECTION)
+                    {
+                        result.appendCopy(head, tail, count, left->key, keyCount(left));
+                    }
+                    left = firstLive(successor(left));
+                }
+                else if (other->key < left->key)
+                {
+                    if (operation == SetOperation::SYMMETRIC_DIFFERENCE)
+                    {
+                        result.appendCopy(head, tail, count, other->key, right.keyCount(other));
+                    }
+                    other = right.firstLive(right.successor(other));
+                }
+                else
+                {
+                    const unsigned leftCopies{ keyCount(left) };
+                    const unsigned rightCopies{ right.keyCount(other) };
+
+                    if (operation == SetOperation::INTERSECTION)
+                    {
+                        result.appendCopy(head, tail, count, left->key, std::min(leftCopies, rightCopies));
+                    }
+                    else if (leftCopies > rightCopies)
+                    {
+                        result.appendCopy(head, tail, count, left->key, leftCopies - rightCopies);
+                    }
+                    else if (operation == SetOperation::SYMMETRIC_DIFFERENCE && rightCopies > leftCopies)
+                    {
+                        result.appendCopy(head, tail, count, other->key, rightCopies - leftCopies);
+                    }
+
+                    left = firstLive(successor(left));
+                    other = right.firstLive(right.successor(other));
+                }
+            }
+
+            //Whatever is left of either side has no match in the other
+            for (; left != NIL && operation != SetOperation::INTERSECTION; left = firstLive(successor(left)))
+            {
+                result.appendCopy(head, tail, count, left->key, keyCount(left));
+            }
+            for (; other != right.NIL && operation == SetOperation::SYMMETRIC_DIFFERENCE; other = right.firstLive(right.successor(other)))
+            {
+                result.appendCopy(head, tail, count, other->key, right.keyCount(other));
+            }
+        }
+    }
+    catch (...)
+    {
+        //The list is not linked into the result yet, so its destructor would not free it
+        for (; count > 0; --count)
+        {
+            RB_Node* const next{ head->right };
+            result.freeNode(head);
+            head = next;
+        }
+        throw;
+    }
+
+    result.linkBalanced(head, count);
+    if (result.filter.isEnabled())
+    {
+        result.refillFilter();
+    }
+    result.rebuildIndex();
+    result.evictOverflow();
+    return result;
+}
+
+/// <summary>
+/// Finger search: finds the first live node not less than a key, starting from a node known to come no later. It
+/// climbs from the finger until the key falls inside the range it has covered, then descends, so the cost grows with
+/// the logarithm of the distance covered rather than of the size of the tree.
+/// </summary>
+/// <param name="finger"> A live node that is not after the answer, or NIL. </param>
+/// <param name="key"> The key being searched for. </param>
+/// <returns> The first live node at or after the finger whose key is not less than key, or NIL. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::lowerBoundFrom(RB_Node* finger, const keyType& key) const
+{
+    return firstLive(boundFrom(finger, key));
+}
+
+/// <summary>
+/// Finger search over every node, tombstones included: finds the first node not less than a key, starting from a
+/// node known to come no later, as lowerBoundFrom does.
+/// </summary>
+/// <param name="finger"> A node that is not after the answer, or NIL. </param>
+/// <param name="key"> The key being searched for. </param>
+/// <returns> The first node at or after the finger whose key is not less than key, or NIL. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::RB_Node* RB_Tree<keyType, duplicates, balance, Allocator>::boundFrom(RB_Node* finger, const keyType& key) const
+{
+    if (finger == NIL || !(finger->key < key))
+    {
+        return finger;
+    }
+
+    while (true)
+    {
+        //Find the nearest ancestor holding the finger in its left subtree. The keys in between are the finger's right
+        //subtree.
+        const RB_Node* child{ finger };
+        RB_Node* ancestor{ finger->parent };
+        while (ancestor != NIL && child == ancestor->right)
+        {
+            child = ancestor;
+            ancestor = ancestor->parent;
+        }
+
+        if (ancestor == NIL || !(ancestor->key < key))
+        {
+            RB_Node* bound{ ancestor };
+            for (RB_Node* traverse{ finger->right }; traverse != NIL;)
+            {
+                RB_TREE_COUNT(searchComparisons);
+                if (traverse->key < key)
+                {
+                    traverse = traverse->right;
+                }
+                else
+                {
+                    bound = traverse;
+                    traverse = traverse->left;
+                }
+            }
+            return bound;
+        }
+
+        finger = ancestor;
+    }
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Appends a new node holding a key to a sorted list chained through right links, for linkBalanced to turn into
+/// the tree. A Duplicates::COUNTED tree stores every copy in the one node; in other trees copies is 1.
+/// </summary>
+/// <param name="head"> The first node of the list, NIL while the list is empty. </param>
+/// <param name="tail"> The last node of the list, NIL while the list is empty. </param>
+/// <param name="count"> Incremented for the node appended. </param>
+/// <param name="key"> The key, not less than the key of the tail. </param>
+/// <param name="copies"> The number of copies of the key the node holds. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::appendCopy(RB_Node*& head, RB_Node*& tail, unsigned& count, const keyType& key, const unsigned copies)
+{
+    RB_Node* const node{ allocateNode(key) };
+    node->tombstone = false;
+    if constexpr (duplicates == Duplicates::COUNTED)
+    {
+        node->count = copies;
+        numRepeats += copies - 1;
+    }
+    else
+    {
+        static_cast<void>(copies);
+    }
+
+    if (tail == NIL)
+    {
+        head = node;
+    }
+    else
+    {
+        tail->right = node;
+    }
+    tail = node;
+    ++count;
+}
+
+/// <summary>
+/// Makes a sorted list chained through right links the tree, balanced by buildBalanced. The tree must be empty, or
+/// have had its node counts reset with its nodes already on the list.
+/// </summary>
+/// <param name="head"> The first node of the list. </param>
+/// <param name="count"> The number of nodes in the list. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::linkBalanced(RB_Node* head, const unsigned count)
+{
+    root = buildBalanced(head, count, 0, (count > 0) ? floorLog2(count) : 0);
+    root->parent = NIL;
+
+    //A single node is built red, but the root must be black
+    if (root != NIL && root->nodeColor == Color::RED)
+    {
+        root->nodeColor = Color::BLACK;
+        --numRedNodes;
+        ++numBlackNodes;
+    }
+
+    leftmost = minimum(root);
+    rightmost = maximum(root);
+}
+
+/// <summary>
+/// Decides between walking two trees together and looking up the keys of the smaller one in the larger one. A
+/// lookup by finger search costs about 2 log2(large / small) steps, a walk one step per node of either tree.
+/// </summary>
+/// <param name="small"> The number of nodes of the tree whose keys would be looked up. </param>
+/// <param name="large"> The number of nodes of the other tree. </param>
+/// <returns> True if looking up is expected to be cheaper. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::preferGalloping(const unsigned small, const unsigned large)
+{
+    if (small == 0)
+    {
+        return true;
+    }
+
+    const unsigned long long lookups{ static_cast<unsigned long long>(small) * (2 * floorLog2(large / small + 1) + 2) };
+    return lookups < static_cast<unsigned long long>(small) + large;
+}
+
+/// <summary>
+/// Compares two trees by comparing the two nodes being pointed to and then recursively comparing the
+/// left and right subtrees of these nodes.
+/// </summary>
+/// <param name="t1"> Pointer to a node THIS tree which is being compared. </param>
+/// <param name="t2"> Pointer to a node in the second tree being compared. </param>
+/// <param name="t2NIL"> Pointer to the second tree's NIL node. </param>
+/// <returns> True if the two nodes are the same and their subtrees are the same, otherwise false. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::compareSubtrees(const RB_Node* t1, const RB_Node* t2, RB_Node* const t2NIL) const
+{			
+			//Both nodes have the same key, held the same number of times
+	return (t1->key == t2->key) && (keyCount(t1) == keyCount(t2)) &&
+		   //AND both nodes have the same left subtrees
+		   ((t1->left == NIL && t2->left == t2NIL) ||
+		   (t1->left != NIL && t2->left != t2NIL && compareSubtrees(t1->left, t2->left, t2NIL))) &&
+		   //AND both nodes have the same right subtrees
+		   ((t1->right == NIL && t2->right == t2NIL) ||
+		   (t1->right != NIL && t2->right != t2NIL && compareSubtrees(t1->right, t2->right, t2NIL)));
+}
+
+/// <summary>
+/// Initially a node that points to the root node will then traverse the tree
+/// in a ascending order, following the LNR (Left-Node-Right) order.
+/// </summary>
+/// <param name="node"> A pointer to a node that will traverse the tree </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::ascending(const RB_Node* const node) const
+{
+	// If node is NIL, return recursively to the function called from.
+	if (node == NIL)
+		return;
+
+	// Recursively call the function to the left of the tree.
+	ascending(node->left);
+
+	// Display node's key value, once for every copy it holds.
+	for (unsigned copies{ keyCount(node) }; copies > 0; --copies)
+	{
+		std::cout << node->key << std::endl;
+	}
+
+	// Recursively call the function to the right of the tree.
+	ascending(node->right);
+}
+
+/// <summary>
+/// Initially a node that points to the root node will then traverse the tree
+/// in a descending order, RNL (Right-Node-Left) order.
+/// </summary>
+/// <param name="node"> A pointer to a node that will traverse the tree </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::descending(const RB_Node* const node) const
+{
+	// If node is NIL, return recursively to the function called from.
+	if (node == NIL)
+		return;
+
+	// Recursively call the function to the right of the tree.
+	descending(node->right);
+
+	// Display node's key value, once for every copy it holds.
+	for (unsigned copies{ keyCount(node) }; copies > 0; --copies)
+	{
+		std::cout << node->key << std::endl;
+	}
+
+	// Recursively call the function to the left of the tree.
+	descending(node->left);
+}
+
+//***************************************
+//			Default Contructor
+//***************************************
+/// <summary>
+/// Constructor for RB_Tree. Creates an empty tree with a default constructed allocator.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>::RB_Tree() : RB_Tree(Allocator{})
+{
+}
+
+//***************************************
+//			Allocator Contructor
+//***************************************
+/// <summary>
+/// Creates an empty tree whose nodes come from the given allocator. Points root to the NIL node, which is a member
+/// of the tree, so no memory is allocated. The NIL node is colored black and its links point back to itself, so
+/// minimum and maximum of an empty tree return NIL.
+/// </summary>
+/// <param name="allocator"> The allocator nodes are obtained from, rebound to the node type. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>::RB_Tree(const Allocator& allocator) : nodeAllocator{ allocator }, NIL{ &sentinel }, numRedNodes{ 0 },
+    numBlackNodes{ 0 }, numRepeats{ 0 }, numTombstones{ 0 }, lazyDeletion{ false }, compactThreshold{ 0.25 },
+    teardown{ Teardown::IMMEDIATE }, teardownChunk{ 64 }, numPendingNodes{ 0 }, fingerSearch{ false }, finger{ NIL },
+    capacity{ 0 }, eviction{ Eviction::SMALLEST }, structureVersion{ 0 }
+{
+    NIL->nodeColor = Color::BLACK;
+    NIL->tombstone = false;
+    NIL->parent = NIL;
+    NIL->left = NIL;
+    NIL->right = NIL;
+    if constexpr (balance != Balance::RED_BLACK)
+    {
+        NIL->rank = -1;
+    }
+    root = NIL;
+    leftmost = NIL;
+    rightmost = NIL;
+}
+
+//***************************************
+//			Copy Constructor
+//***************************************
+/// <summary>
+/// Red-Black Tree copy constructor. The copy's allocator is chosen by select_on_container_copy_construction.
+/// </summary>
+/// <param name="right"> Constant reference to the tree being copied. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>::RB_Tree(const RB_Tree& right) :
+	RB_Tree(right, Allocator{ NodeTraits::select_on_container_copy_construction(right.nodeAllocator) })
+{
+}
+
+/// <summary>
+/// Sets up an empty tree using the given allocator then copies data from the tree parameter.
+/// </summary>
+/// <param name="right"> Constant reference to the tree being copied. </param>
+/// <param name="allocator"> The allocator the copy's nodes are obtained from. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>::RB_Tree(const RB_Tree& right, const Allocator& allocator) : RB_Tree(allocator)
+{
+	//Copy data from the tree parameter. The counts are set afterwards so a copy that throws is destroyed correctly.
+	copyTree(root, right.root, right.NIL);
+	leftmost = minimum(root);
+	rightmost = maximum(root);
+	numRedNodes = right.numRedNodes;
+	numBlackNodes = right.numBlackNodes;
+	numRepeats = right.numRepeats;
+	numTombstones = right.numTombstones;
+	lazyDeletion = right.lazyDeletion;
+	compactThreshold = right.compactThreshold;
+	capacity = right.capacity;
+	eviction = right.eviction;
+	teardown = right.teardown;
+	teardownChunk = right.teardownChunk;
+	filter = right.filter;
+	fingerSearch = right.fingerSearch;
+	hashIndex.setEnabled(right.hashIndex.isEnabled());
+	rebuildIndex();
+}
+
+//***************************************
+//			Move Constructor
+//***************************************
+/// <summary>
+/// Takes the nodes of another tree along with a copy of its allocator, leaving it empty. Nothing is allocated, but
+/// the links to the other tree's NIL node are moved to this tree's, which visits every node.
+/// </summary>
+/// <param name="right"> The tree being moved from. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>::RB_Tree(RB_Tree&& right) noexcept : RB_Tree(Allocator{ right.nodeAllocator })
+{
+	adoptNodes(right);
+}
+
+//*********************************
+//			Destructor
+//*********************************
+//NOTE: Memory is deallocated in this function
+/// <summary>
+/// Red-Black Tree destructor. Destroys the tree and frees the allocated memory. Under Teardown::BACKGROUND the nodes
+/// are handed to the reclaimer thread instead, so the destructor takes the same time for any size of tree.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>::~RB_Tree()
+{
+	//Destroy the tree, leaving only the NIL node. Nodes a Teardown::DEFERRED tree has not freed yet are freed now.
+	destroyTree();
+	finishTeardown();
+#if RB_TREE_CONCURRENT_READS
+	reclaim();
+#endif
+}
+
+//*********************************************
+//			Public Member Functions
+//*********************************************
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Inserts a node into the Red-Black tree with a specified key value. If the key is already in the tree a
+/// Duplicates::COUNTED tree increments the node's count and a Duplicates::UNIQUE tree rejects the key,
+/// in both cases without allocating.
+/// </summary>
+/// <param name="x"> The key value of the node being insterted. </param>
+/// <returns> True if the key was stored, false if a Duplicates::UNIQUE tree already contained it. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::insert(const keyType& x)
+{
+    return insertKey(x);
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Inserts a key as insert(x) does, moving it into the new node instead of copying it. A key that is not stored
+/// because an equal one already has a node is left untouched.
+/// </summary>
+/// <param name="x"> The key value of the node being inserted. </param>
+/// <returns> True if the key was stored, false if a Duplicates::UNIQUE tree already contained it. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::insert(keyType&& x)
+{
+    return insertKey(std::move(x));
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Constructs a key in a new node from the given arguments and inserts it. The key is built before the tree is
+/// searched, since it has to be compared. If an equal key already has a node (Duplicates::COUNTED and
+/// Duplicates::UNIQUE), or a full bounded tree turns the key away, the new node is freed again, so prefer insert for
+/// keys that are usually present or rejected.
+/// </summary>
+/// <param name="args"> The arguments of the key's constructor. </param>
+/// <returns> True if the key was stored, false if a Duplicates::UNIQUE tree already contained it or a full bounded tree rejected it. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+template<typename... Args>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::emplace(Args&&... args)
+{
+    continueTeardown();
+
+    RB_Node* const newNode{ createNode(std::forward<Args>(args)...) };
+
+    if (rejectsKey(newNode->key))
+    {
+        freeNode(newNode);
+        return false;
+    }
+    RB_TREE_TRACE_OP(OpType::INSERT, newNode->key);
+
+    RB_Node* parentNode{ NIL };
+    bool asLeftChild{ false };
+    RB_Node* existing{ NIL };
+
+    try
+    {
+        existing = findInsertPosition(newNode->key, parentNode, asLeftChild);
+    }
+    catch (...)
+    {
+        freeNode(newNode);
+        throw;
+    }
+
+    if (existing != NIL)
+    {
+        freeNode(newNode);
+        const bool stored{ addDuplicate(existing) };
+        evictOverflow();
+        return stored;
+    }
+
+    attachNode(parentNode, newNode, asLeftChild);
+    evictOverflow();
+    return true;
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Implements insert(x) for keys passed by reference and by rvalue. The key is forwarded to the node only once a
+/// new node is needed.
+/// </summary>
+/// <param name="x"> The key value of the node being inserted. </param>
+/// <returns> True if the key was stored, false if a Duplicates::UNIQUE tree already contained it. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+template<typename K>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::insertKey(K&& x)
+{
+    continueTeardown();
+
+    //A full bounded tree turns away a key it would evict at once, before searching or allocating
+    if (rejectsKey(x))
+    {
+        return false;
+    }
+    RB_TREE_TRACE_OP(OpType::INSERT, x);
+
+    RB_Node* parentNode{ NIL };
+    bool asLeftChild{ false };
+
+    //Find the position of the key, or the node already holding it
+    RB_Node* const existing{ findInsertPosition(x, parentNode, asLeftChild) };
+
+    if (existing != NIL)
+    {
+        const bool stored{ addDuplicate(existing) };
+        evictOverflow();
+        return stored;
+    }
+
+    //Allocate a new node, initialize it with the data passed to the function and link it into the tree
+    attachNode(parentNode, createNode(std::forward<K>(x)), asLeftChild);
+    evictOverflow();
+    return true;
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Inserts a key using a position hint. If the key belongs directly before or directly after the hinted position
+/// the node is linked there without searching from the root, otherwise this behaves like insert(x).
+/// Inserting a run of sorted keys with each returned iterator as the next hint costs amortized O(1) per key.
+/// </summary>
+/// <param name="hint"> An iterator to a position near the one the key belongs to, end() is allowed. </param>
+/// <param name="x"> The key value of the node being inserted. </param>
+/// <returns> An iterator to the inserted key, or to the key already in the tree if equal keys share a node. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::iterator RB_Tree<keyType, duplicates, balance, Allocator>::insert(iterator hint, const keyType& x)
+{
+    return insertKey(hint, x);
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Inserts a key using a position hint as insert(hint, x) does, moving the key into the new node.
+/// </summary>
+/// <param name="hint"> An iterator to a position near the one the key belongs to, end() is allowed. </param>
+/// <param name="x"> The key value of the node being inserted. </param>
+/// <returns> An iterator to the inserted key, or to the key already in the tree if equal keys share a node. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::iterator RB_Tree<keyType, duplicates, balance, Allocator>::insert(iterator hint, keyType&& x)
+{
+    return insertKey(hint, std::move(x));
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Implements insert(hint, x) for keys passed by reference and by rvalue.
+/// </summary>
+/// <param name="hint"> An iterator to a position near the one the key belongs to, end() is allowed. </param>
+/// <param name="x"> The key value of the node being inserted. </param>
+/// <returns> An iterator to the inserted key, to the key already in the tree if equal keys share a node, or end() if a full bounded tree rejected it. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+template<typename K>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::iterator RB_Tree<keyType, duplicates, balance, Allocator>::insertKey(iterator hint, K&& x)
+{
+    continueTeardown();
+
+    if (rejectsKey(x))
+    {
+        return end();
+    }
+    RB_TREE_TRACE_OP(OpType::INSERT, x);
+
+    RB_Node* const position{ const_cast<RB_Node*>(hint.node) };
+    RB_Node* parentNode{ NIL };
+    bool asLeftChild{ false };
+    RB_Node* existing{ NIL };
+
+    if (position == NIL)
+    {
+        //The hint is end(): the key belongs after the largest node, or anywhere if the tree is empty
+        if (rightmost == NIL || rightmost->key < x)
+        {
+            parentNode = rightmost;
+        }
+        else
+        {
+            existing = findInsertPosition(x, parentNode, asLeftChild);
+        }
+    }
+    else if (x < position->key)
+    {
+        //The key fits directly before the hint if it is larger than the hint's predecessor
+        RB_Node* const before{ predecessor(position) };
+
+        if (before == NIL || before->key < x)
+        {
+            //Either the hint has a free left slot, or its predecessor (the maximum of its left subtree) has a free right slot
+            asLeftChild = (position->left == NIL);
+            parentNode = asLeftChild ? position : before;
+        }
+        else
+        {
+            existing = findInsertPosition(x, parentNode, asLeftChild);
+        }
+    }
+    else if (position->key < x)
+    {
+        //The key fits directly after the hint if it is smaller than the hint's successor
+        RB_Node* const after{ successor(position) };
+
+        if (after == NIL || x < after->key)
+        {
+            //Either the hint has a free right slot, or its successor (the minimum of its right subtree) has a free left slot
+            asLeftChild = (position->right != NIL);
+            parentNode = asLeftChild ? after : position;
+        }
+        else
+        {
+            existing = findInsertPosition(x, parentNode, asLeftChild);
+        }
+    }
+    else if (duplicates == Duplicates::MULTI_NODE)
+    {
+        //The key equals the hint's key, the new node goes directly after the hint
+        asLeftChild = (position->right != NIL);
+        parentNode = asLeftChild ? successor(position) : position;
+    }
+    else
+    {
+        existing = position;
+    }
+
+    if (existing != NIL)
+    {
+        addDuplicate(existing);
+        evictOverflow();
+        return iterator{ existing, this };
+    }
+
+    RB_Node* const newNode{ createNode(std::forward<K>(x)) };
+    attachNode(parentNode, newNode, asLeftChild);
+    evictOverflow();
+
+    return iterator{ newNode, this };
+}
+
+/// <summary>
+/// Attempts to remove a node with the specified key value from the tree. If such a node does not exist
+/// nothing happens. In a Duplicates::COUNTED tree one copy of the key is removed and the node is deleted
+/// when its last copy goes. In lazy deletion mode the node is marked as a tombstone instead of being deleted.
+/// </summary>
+/// <param name="x"> The key value of the node to be removed from the tree. </param>
+/// <returns> Returns true if a node was removed, otherwise false. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::remove(const keyType& x)
+{
+    RB_TREE_TRACE_OP(OpType::REMOVE, x);
+    continueTeardown();
+
+	//Search for the node to delete. Returns NIL if the node does not exist or is already a tombstone.
+    RB_Node* nodeToDelete = filterExcludes(x) ? NIL : searchLive(x);
+
+	//If the node exists, delete it and return true
+    if (nodeToDelete != NIL)
+    {
+        eraseKey(nodeToDelete);
+		return true;
+    }
+
+	//The node was not found, return false
+	return false;
+}
+
+/// <summary>
+/// Links the node owned by a handle into the tree without allocating. If the key is already in the tree a
+/// Duplicates::COUNTED tree adds the node's copies to the existing node and frees the handle's node, and a
+/// Duplicates::UNIQUE tree rejects it, leaving the node in the handle, as does a full bounded tree that would evict the
+/// key at once. Throws std::invalid_argument if the node came
+/// from an allocator that does not compare equal to this tree's, since the tree could not free it.
+/// </summary>
+/// <param name="handle"> The handle owning the node. It is empty afterwards unless the node was rejected. </param>
+/// <returns> False if the handle was empty or the node was rejected, otherwise true. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::insert(NodeHandle&& handle)
+{
+    if (handle.node == nullptr)
+    {
+        return false;
+    }
+
+    if (!NodeTraits::is_always_equal::value && !(*handle.allocator == nodeAllocator))
+    {
+        throw std::invalid_argument{ "ERROR: The node handle's allocator does not compare equal to the tree's." };
+    }
+
+    if (rejectsKey(handle.node->key))
+    {
+        return false;
+    }
+    RB_TREE_TRACE_COPIES(OpType::INSERT, handle.node->key, keyCount(handle.node));
+
+    RB_Node* parentNode{ NIL };
+    bool asLeftChild{ false };
+    RB_Node* const existing{ findSplicePosition(handle.node->key, parentNode, asLeftChild) };
+
+    if (existing != NIL)
+    {
+        if constexpr (duplicates == Duplicates::COUNTED)
+        {
+            //Every copy held by the handle becomes a repeat of the existing key
+            existing->count += handle.node->count;
+            numRepeats += handle.node->count;
+
+            freeNode(handle.node);
+            handle.node = nullptr;
+            handle.allocator.reset();
+            evictOverflow();
+            return true;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    RB_Node* const node{ handle.node };
+    handle.node = nullptr;
+    handle.allocator.reset();
+
+    if constexpr (duplicates == Duplicates::COUNTED)
+    {
+        numRepeats += node->count - 1;
+    }
+
+    resetLinks(node);
+    attachNode(parentNode, node, asLeftChild);
+    evictOverflow();
+    return true;
+}
+
+/// <summary>
+/// Detaches the node holding a key and returns it in a node handle. The tree is rebalanced as by remove, but the
+/// node is not freed. In a Duplicates::COUNTED tree the node takes every copy of the key with it.
+/// </summary>
+/// <param name="x"> The key of the node being extracted. </param>
+/// <returns> A handle owning the node, or an empty handle if the key is not in the tree. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::NodeHandle RB_Tree<keyType, duplicates, balance, Allocator>::extract(const keyType& x)
+{
+    return extract(iterator{ searchLive(x), this });
+}
+
+/// <summary>
+/// Detaches the node an iterator refers to and returns it in a node handle. Other iterators stay valid.
+/// </summary>
+/// <param name="position"> An iterator into this tree. </param>
+/// <returns> A handle owning the node, or an empty handle if position is end(). </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::NodeHandle RB_Tree<keyType, duplicates, balance, Allocator>::extract(iterator position)
+{
+    if (position.node == NIL || position.node == nullptr)
+    {
+        return NodeHandle{};
+    }
+
+    RB_Node* const node{ const_cast<RB_Node*>(position.node) };
+    RB_TREE_TRACE_COPIES(OpType::REMOVE, node->key, keyCount(node));
+
+    if constexpr (duplicates == Duplicates::COUNTED)
+    {
+        numRepeats -= node->count - 1;
+    }
+
+    detachNode(node);
+    return NodeHandle{ node, nodeAllocator };
+}
+
+/// <summary>
+/// Moves the nodes of another tree into this one without allocating. In a Duplicates::UNIQUE tree nodes whose key
+/// is already present stay in the other tree. In a Duplicates::COUNTED tree their copies are added to the existing
+/// node. Every other node is relinked into this tree. If the trees' allocators do not compare equal, its key is
+/// moved into a node from this tree's allocator instead and the other tree frees the old node. A bounded tree evicts
+/// as nodes come in, and leaves the nodes it would evict at once in the other tree.
+/// </summary>
+/// <param name="other"> The tree nodes are taken from. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::merge(RB_Tree& other)
+{
+    if (&other == this)
+    {
+        return;
+    }
+
+    const bool sameAllocator{ NodeTraits::is_always_equal::value || nodeAllocator == other.nodeAllocator };
+
+    //Visit the other tree in LNR order. Unlinking a node never frees or moves its successor.
+    RB_Node* node{ other.leftmost };
+
+    while (node != other.NIL)
+    {
+        RB_Node* const next{ other.successor(node) };
+
+        //Tombstones hold no key and are left for the other tree to compact, and keys a full bounded tree would evict at
+        //once stay behind as well
+        if (node->tombstone || rejectsKey(node->key))
+        {
+            node = next;
+            continue;
+        }
+
+        RB_Node* parentNode{ NIL };
+        bool asLeftChild{ false };
+        RB_Node* const existing{ findSplicePosition(node->key, parentNode, asLeftChild) };
+
+        //A node linked in from another allocator is replaced by one from this tree's allocator. It is allocated before
+        //either tree is changed, so a throwing allocation leaves both intact.
+        RB_Node* const moved{ (existing != NIL || sameAllocator) ? node : allocateNode(std::move(node->key)) };
+
+#if RB_TREE_TRACE
+        //Every copy moves unless the key is already held by a Duplicates::UNIQUE tree
+        if (existing == NIL || duplicates == Duplicates::COUNTED)
+        {
+            traceOperation(OpType::INSERT, moved->key, keyCount(node));
+            other.traceOperation(OpType::REMOVE, moved->key, keyCount(node));
+        }
+#endif
+
+        if (existing == NIL)
+        {
+            if constexpr (duplicates == Duplicates::COUNTED)
+            {
+                moved->count = node->count;
+                other.numRepeats -= node->count - 1;
+                numRepeats += node->count - 1;
+            }
+
+            other.detachNode(node);
+            if (moved != node)
+            {
+                other.disposeNode(node);
+            }
+
+            resetLinks(moved);
+            attachNode(parentNode, moved, asLeftChild);
+        }
+        else if constexpr (duplicates == Duplicates::COUNTED)
+        {
+            existing->count += node->count;
+            numRepeats += node->count;
+            other.numRepeats -= node->count - 1;
+            other.RB_delete(node);
+        }
+
+        evictOverflow();
+        node = next;
+    }
+}
+
+//NOTE: Memory is allocated and freed in this function
+/// <summary>
+/// Applies a batch of inserts, removes and lookups with the same results as performing them one by one in order.
+/// The operations are stably sorted by key, so operations on the same key keep their relative order, and the tree is
+/// then swept once in ascending order. Each key is located by a finger search from the previous key's position, the
+/// operations on it are replayed against the number of copies found there and only the net change is made, through
+/// the node found: copies are removed from it and new nodes are linked next to it. An insert and a remove of the same
+/// key cancel without touching the tree. In lazy deletion mode compact() runs at most once, after the sweep.
+/// </summary>
+/// <param name="batch"> The operations, in the order they would be performed one by one. </param>
+/// <returns> One result per operation, at the same index: what insert, remove or containsKey would have returned. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+std::vector<bool> RB_Tree<keyType, duplicates, balance, Allocator>::apply(const std::vector<Operation>& batch)
+{
+    std::vector<bool> results(batch.size(), false);
+
+    //Evictions depend on the order keys arrive in, so a bounded tree performs the operations one by one
+    if (capacity != 0)
+    {
+        for (std::size_t i{ 0 }; i < batch.size(); ++i)
+        {
+            switch (batch[i].type)
+            {
+            case OpType::INSERT:
+                results[i] = insert(batch[i].key);
+                break;
+            case OpType::REMOVE:
+                results[i] = remove(batch[i].key);
+                break;
+            default:
+                results[i] = containsKey(batch[i].key);
+                break;
+            }
+        }
+        return results;
+    }
+
+#if RB_TREE_TRACE
+    //The sweep below works on the tree directly, so the operations are recorded here in the order they were given
+    for (const Operation& operation : batch)
+    {
+        traceOperation(operation.type, operation.key);
+    }
+#endif
+
+    //Sort the positions of the operations rather than the operations themselves, so keys are not copied
+    std::vector<std::size_t> order(batch.size());
+    std::iota(order.begin(), order.end(), std::size_t{ 0 });
+    std::stable_sort(order.begin(), order.end(), [&batch](const std::size_t a, const std::size_t b)
+    {
+        return batch[a].key < batch[b].key;
+    });
+
+    continueTeardown();
+
+    //The smallest node, then the first node after the last key visited. Only nodes equal to the key being visited
+    //are removed and new nodes are linked before it, so it stays in the tree and no node falls between the two keys.
+    RB_Node* cursor{ leftmost };
+
+    std::size_t first{ 0 };
+    while (first < order.size())
+    {
+        const keyType& key{ batch[order[first]].key };
+
+        std::size_t last{ first + 1 };
+        while (last < order.size() && !(key < batch[order[last]].key))
+        {
+            ++last;
+        }
+
+        //Locate the nodes holding the key, tombstones included, and the first node after them
+        RB_Node* const at{ boundFrom(cursor, key) };
+        RB_Node* after{ at };
+        unsigned before{ 0 };
+        while (after != NIL && !(key < after->key))
+        {
+            before += keyCount(after);
+            after = successor(after);
+        }
+
+        //Replay the operations on this key against its number of copies
+        unsigned copies{ before };
+
+        for (std::size_t i{ first }; i < last; ++i)
+        {
+            const std::size_t index{ order[i] };
+
+            switch (batch[index].type)
+            {
+            case OpType::INSERT:
+                results[index] = (duplicates != Duplicates::UNIQUE || copies == 0);
+                copies += results[index] ? 1 : 0;
+                break;
+            case OpType::REMOVE:
+                results[index] = (copies > 0);
+                copies -= results[index] ? 1 : 0;
+                break;
+            default:
+                results[index] = (copies > 0);
+                break;
+            }
+        }
+
+        //Make the net change through the nodes found. compact() is left until the sweep is done since it would free
+        //the nodes held here. Unlinking a node never frees or moves its successor.
+        RB_Node* node{ at };
+        while (copies < before)
+        {
+            RB_Node* const next{ successor(node) };
+            if (node->tombstone)
+            {
+                node = next;
+                continue;
+            }
+
+            //A counted node holding more copies keeps its place and loses the next one on the following pass
+            const bool lastCopy{ keyCount(node) == 1 };
+            ++copies;
+            eraseKey(node, false);
+            if (lastCopy)
+            {
+                node = next;
+            }
+        }
+
+        //New copies go into the node holding the key if equal keys share one, otherwise new nodes are linked directly
+        //before the first node after the key
+        RB_Node* holder{ (duplicates != Duplicates::MULTI_NODE && at != after) ? at : NIL };
+        for (; copies > before; --copies)
+        {
+            if (holder != NIL)
+            {
+                addDuplicate(holder);
+                continue;
+            }
+
+            RB_Node* const insertedNode{ createNode(key) };
+            if (after == NIL)
+            {
+                attachNode(rightmost, insertedNode, false);
+            }
+            else if (after->left == NIL)
+            {
+                attachNode(after, insertedNode, true);
+            }
+            else
+            {
+                attachNode(predecessor(after), insertedNode, false);
+            }
+
+            if constexpr (duplicates != Duplicates::MULTI_NODE)
+            {
+                holder = insertedNode;
+            }
+        }
+
+        cursor = after;
+        first = last;
+    }
+
+    if (lazyDeletion && numTombstones > compactThreshold * getNumNodes())
     {
-        //Check if the parent of the inserted node is a left child or right child
-        if (insertedNode->parent == insertedNode->parent->parent->left)
+        compact();
+    }
+
+    return results;
+}
+
+/// <summary>
+/// Determines if the key value specified is in the tree. The value of the pointer returned from search
+/// is compared to NIL. If the pointer is not NIL, the element was found and the expression evaluates to true. 
+/// If the pointer is NIL then the search was unsuccessful the expression evaluates to false.
+/// </summary>
+/// <param name="keyValue"> The key value that is searched for in the tree </param>
+/// <returns> True if the key value passed is in the tree, otherwise false </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::containsKey(const keyType& keyValue) const
+{
+    RB_TREE_TRACE_OP(OpType::CONTAINS, keyValue);
+    return !filterExcludes(keyValue) && (searchLive(keyValue) != NIL);
+}
+
+#if RB_TREE_TRACE
+/// <summary>
+/// Starts recording every insert, remove and containsKey call into a recorder, or stops when passed nullptr. The
+/// other changes listed with RB_TREE_TRACE are recorded as inserts and removes. The recorder must stay alive while it
+/// is set. Throws std::invalid_argument if the recorder already records trees of
+/// another type. Only available when RB_TREE_TRACE is enabled.
+/// </summary>
+/// <param name="recorder"> The recorder receiving the operations, or nullptr. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::setTraceRecorder(TraceRecorder* const recorder)
+{
+    static_assert(std::is_trivially_copyable<keyType>::value, "Only trees of trivially copyable keys can be traced.");
+
+    if (recorder != nullptr)
+    {
+        recorder->begin(sizeof(keyType), duplicates, balance);
+    }
+    traceRecorder = recorder;
+}
+#endif
+
+#if RB_TREE_CONCURRENT_READS
+/// <summary>
+/// Determines if a key is in the tree while the writer thread may be changing it. The reader takes no lock and writes
+/// only to its own reader slot. A live node holding the key was in the tree at some point during the search, so a hit
+/// is returned at once. A miss is only trusted if none of the nodes the search passed was rewritten meanwhile, and is
+/// searched again otherwise. Nodes the writer unlinks meanwhile are not freed until the reader has left.
+/// </summary>
+/// <param name="keyValue"> The key value that is searched for in the tree </param>
+/// <returns> True if the key value passed is in the tree, otherwise false </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::concurrentContainsKey(const keyType& keyValue) const
+{
+    ReaderSlot& slot{ readerSlots[readerSlotIndex()] };
+    unsigned parity;
+
+    //Enter under the current epoch. If the writer advanced it in between, it may already have checked this slot, so
+    //enter again under the new one.
+    for (;;)
+    {
+        const unsigned long long epoch{ readerEpoch.load() };
+        parity = static_cast<unsigned>(epoch & 1);
+        slot.readers[parity].fetch_add(1);
+        if (readerEpoch.load() == epoch)
         {
-            //Create a pointer to the inserted node's uncle
-            RB_Node* rightUncle = insertedNode->parent->parent->right;
+            break;
+        }
+        slot.readers[parity].fetch_sub(1, std::memory_order_release);
+    }
+
+    //A search whose miss keeps failing its check, or that passes more nodes than it can record, waits for a quiet
+    //moment of the whole tree instead
+    bool found{ false };
+    unsigned attempts{ 0 };
+    while (attempts < maxOptimisticReads && !searchOptimistic(keyValue, found))
+    {
+        ++attempts;
+    }
+    if (attempts == maxOptimisticReads)
+    {
+        while (!searchSequenced(keyValue, found))
+        {
+        }
+    }
+
+    slot.readers[parity].fetch_sub(1, std::memory_order_release);
+
+    return found;
+}
+
+/// <summary>
+/// One search of concurrentContainsKey. The version of every node is read before its links, and a miss is confirmed
+/// by finding the root unchanged and every version read still the same and even. A rotation or a splice changes the
+/// version of every node whose links it rewrites, including the parent whose child changes, so a search led astray
+/// by one always sees a changed version.
+/// </summary>
+/// <param name="keyValue"> The key being searched for. </param>
+/// <param name="found"> Set to the answer when the search returns true. </param>
+/// <returns> True if the answer can be trusted, false if the search has to be repeated. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::searchOptimistic(const keyType& keyValue, bool& found) const
+{
+    const RB_Node* visited[maxReaderVisits];
+    unsigned versions[maxReaderVisits];
+    unsigned numVisited{ 0 };
+
+    //Records a node's version before its links are read. False once no more nodes can be recorded.
+    const auto visit{ [&](const RB_Node* const node)
+    {
+        if (numVisited == maxReaderVisits)
+        {
+            return false;
+        }
+        versions[numVisited] = node->version;
+        visited[numVisited++] = node;
+        return true;
+    } };
+
+    const RB_Node* const top{ root };
+    const RB_Node* traverse{ top };
+    unsigned depth{ 0 };
+
+    while (traverse != NIL)
+    {
+        if (depth++ == maxReaderDepth || !visit(traverse))
+        {
+            return false;
+        }
+
+        if (keyValue < traverse->key)
+        {
+            traverse = traverse->left;
+        }
+        else if (traverse->key < keyValue)
+        {
+            traverse = traverse->right;
+        }
+        else if (!traverse->tombstone)
+        {
+            found = true;
+            return true;
+        }
+        else if constexpr (duplicates == Duplicates::MULTI_NODE)
+        {
+            //Every other copy of the key lies below the first node found holding it, in the parts of its subtrees
+            //equal to the key
+            const RB_Node* pending[maxReaderDepth];
+            unsigned numPending{ 0 };
+            pending[numPending++] = traverse->left;
+            pending[numPending++] = traverse->right;
+
+            while (numPending > 0)
+            {
+                const RB_Node* const node{ pending[--numPending] };
+                if (node == NIL)
+                {
+                    continue;
+                }
+                if (!visit(node) || numPending + 2 > maxReaderDepth)
+                {
+                    return false;
+                }
+
+                if (node->key < keyValue)
+                {
+                    pending[numPending++] = node->right;
+                }
+                else if (keyValue < node->key)
+                {
+                    pending[numPending++] = node->left;
+                }
+                else if (!node->tombstone)
+                {
+                    found = true;
+                    return true;
+                }
+                else
+                {
+                    pending[numPending++] = node->left;
+                    pending[numPending++] = node->right;
+                }
+            }
+            break;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    //Confirm the miss
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (root != top)
+    {
+        return false;
+    }
+    for (unsigned i{ 0 }; i < numVisited; ++i)
+    {
+        if ((versions[i] & 1) != 0 || visited[i]->version != versions[i])
+        {
+            return false;
+        }
+    }
+
+    found = false;
+    return true;
+}
+
+/// <summary>
+/// The fallback search of concurrentContainsKey. It waits until the writer is between changes, searches, and is
+/// trusted only if no change to the links started anywhere in the tree meanwhile.
+/// </summary>
+/// <param name="keyValue"> The key being searched for. </param>
+/// <param name="found"> Set to the answer when the search returns true. </param>
+/// <returns> True if the answer can be trusted, false if the search has to be repeated. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::searchSequenced(const keyType& keyValue, bool& found) const
+{
+    const unsigned long long sequence{ writeSequence.load(std::memory_order_acquire) };
+
+    //The writer is in the middle of a change
+    if (sequence & 1)
+    {
+        std::this_thread::yield();
+        return false;
+    }
+
+    const RB_Node* traverse{ root };
+    unsigned depth{ 0 };
+    found = false;
+
+    while (traverse != NIL && depth++ < maxReaderDepth)
+    {
+        if (keyValue < traverse->key)
+        {
+            traverse = traverse->left;
+        }
+        else if (traverse->key < keyValue)
+        {
+            traverse = traverse->right;
+        }
+        else
+        {
+            //A removed key may still have live copies next to it in a Duplicates::MULTI_NODE tree
+            found = !traverse->tombstone;
+            if constexpr (duplicates == Duplicates::MULTI_NODE)
+            {
+                for (const RB_Node* before{ predecessor(traverse) }; !found && before != NIL && !(before->key < keyValue); before = predecessor(before))
+                {
+                    found = !before->tombstone;
+                }
+                for (const RB_Node* after{ successor(traverse) }; !found && after != NIL && !(keyValue < after->key); after = successor(after))
+                {
+                    found = !after->tombstone;
+                }
+            }
+            break;
+        }
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return depth <= maxReaderDepth && writeSequence.load(std::memory_order_relaxed) == sequence;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Frees the nodes unlinked since the last reclamation, after waiting for every concurrent reader that started before
+/// the call to leave. The writer does this every 1024 retired nodes and can call it to give memory back sooner. Must
+/// only be called by the writer thread.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::reclaim()
+{
+    if (retiredNodes.empty())
+    {
+        return;
+    }
+
+    waitForReaders();
+
+    for (RB_Node* const node : retiredNodes)
+    {
+        freeNode(node);
+    }
+    retiredNodes.clear();
+}
+#endif
+
+/// <summary>
+/// Counts the copies of a key stored in the tree. Equal keys are adjacent in LNR order, so a Duplicates::MULTI_NODE
+/// tree walks outward from the node found by search.
+/// </summary>
+/// <param name="keyValue"> The key value being counted. </param>
+/// <returns> The number of times the key was inserted and not yet removed. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+unsigned RB_Tree<keyType, duplicates, balance, Allocator>::countKey(const keyType& keyValue) const
+{
+    const RB_Node* const found{ filterExcludes(keyValue) ? NIL : locate(keyValue) };
+
+    if (found == NIL)
+    {
+        return 0;
+    }
+
+    unsigned copies{ keyCount(found) };
+
+    if constexpr (duplicates == Duplicates::MULTI_NODE)
+    {
+        for (const RB_Node* before{ predecessor(found) }; before != NIL && !(before->key < keyValue); before = predecessor(before))
+        {
+            copies += keyCount(before);
+        }
+        for (const RB_Node* after{ successor(found) }; after != NIL && !(keyValue < after->key); after = successor(after))
+        {
+            copies += keyCount(after);
+        }
+    }
+
+    return copies;
+}
+
+/// <summary>
+/// Checks to see if the tree is empty. The tree is empty if the root is NIL or every node is a tombstone.
+/// </summary>
+/// <returns> True if the tree is empty, otherwise false </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::isEmpty() const
+{
+    return getNumKeys() == 0;
+}
+
+/// <summary>
+/// Accessor function for the numRedNodes member
+/// </summary>
+/// <returns> The number of red nodes in the Red-Black tree. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+unsigned RB_Tree<keyType, duplicates, balance, Allocator>::getNumRedNodes() const
+{
+    return numRedNodes;
+}
+
+/// <summary>
+/// Accessor function for the numBlackNodes member.
+/// </summary>
+/// <returns> The number of black nodes in the Red-Black tree. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+unsigned RB_Tree<keyType, duplicates, balance, Allocator>::getNumBlackNodes() const
+{
+    return numBlackNodes;
+}
+
+/// <summary>
+/// Gets the total number of nodes in the tree by adding the number of red and black nodes together.
+/// A Duplicates::COUNTED tree has one node per distinct key.
+/// </summary>
+/// <returns> The total number of nodes in the Red-Black tree. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+unsigned RB_Tree<keyType, duplicates, balance, Allocator>::getNumNodes() const
+{
+    return numRedNodes + numBlackNodes;
+}
+
+/// <summary>
+/// Gets the number of keys stored in the tree. This is the number of nodes plus the extra copies held in node
+/// counts, less the tombstones, so it only differs from getNumNodes() for a Duplicates::COUNTED tree or in lazy
+/// deletion mode.
+/// </summary>
+/// <returns> The total number of keys in the Red-Black tree. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+unsigned RB_Tree<keyType, duplicates, balance, Allocator>::getNumKeys() const
+{
+    return getNumNodes() + numRepeats - numTombstones;
+}
+
+/// <summary>
+/// Calculates the height of the Red-Black tree.
+/// </summary>
+/// <returns> The height of the Red-Black tree as an int. -1 is returned if the tree is empty. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+int RB_Tree<keyType, duplicates, balance, Allocator>::getTreeHeight() const
+{
+    return calculateSubtreeHeight(root);
+}
+
+/// <summary>
+/// Displays statistics about the tree including total nodes, height, memory usage, and for Red-Black trees the number
+/// of red and black nodes.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::statistics() const
+{
+    switch (balance)
+    {
+    case Balance::AVL:
+        std::cout << "AVL Tree Statistics\n";
+        break;
+    case Balance::WAVL:
+        std::cout << "WAVL Tree Statistics\n";
+        break;
+    default:
+        std::cout << "Red-Black Tree Statistics\n";
+        break;
+    }
+    std::cout << "-------------------------\n";
+    std::cout << std::setw(25) << "Total Nodes: " << getNumNodes() << std::endl;
+    if (duplicates == Duplicates::COUNTED || numTombstones > 0)
+    {
+        std::cout << std::setw(25) << "Total Keys: " << getNumKeys() << std::endl;
+    }
+    if (lazyDeletion || numTombstones > 0)
+    {
+        std::cout << std::setw(25) << "Tombstones: " << getNumTombstones() << std::endl;
+    }
+    if (capacity != 0)
+    {
+        std::cout << std::setw(25) << "Capacity: " << capacity << std::endl;
+    }
+    std::cout << std::setw(25) << "Tree Height: " << getTreeHeight() << std::endl;
+    if constexpr (balance == Balance::RED_BLACK)
+    {
+        std::cout << std::setw(25) << "Number of Red Nodes: " << getNumRedNodes() << std::endl;
+        std::cout << std::setw(25) << "Number of Black Nodes: " << getNumBlackNodes() << std::endl;
+    }
+    std::cout << std::setw(25) << "Memory Usage: " << memoryUsage().totalBytes() << " bytes" << std::endl;
+    if (fingerSearch)
+    {
+        std::cout << std::setw(25) << "Finger Hit Rate: " << fingerStats.hitRate() << " of " << fingerStats.lookups
+                  << " lookups" << std::endl;
+    }
+
+#if RB_TREE_COUNTERS
+    std::cout << "\nOperation Counters\n";
+    std::cout << "-------------------------\n";
+    std::cout << std::setw(25) << "Left Rotations: " << counters.leftRotations << std::endl;
+    std::cout << std::setw(25) << "Right Rotations: " << counters.rightRotations << std::endl;
+    std::cout << std::setw(25) << "Insert Fixup Cases: " << counters.insertFixupCase1 << " / "
+              << counters.insertFixupCase2 << " / " << counters.insertFixupCase3 << std::endl;
+    std::cout << std::setw(25) << "Delete Fixup Cases: " << counters.deleteFixupCase1 << " / " << counters.deleteFixupCase2
+              << " / " << counters.deleteFixupCase3 << " / " << counters.deleteFixupCase4 << std::endl;
+    std::cout << std::setw(25) << "Search Comparisons: " << counters.searchComparisons << std::endl;
+    std::cout << std::setw(25) << "Insert Comparisons: " << counters.insertComparisons << std::endl;
+    std::cout << std::setw(25) << "Node Allocations: " << counters.nodeAllocations << std::endl;
+    std::cout << std::setw(25) << "Node Frees: " << counters.nodeFrees << std::endl;
+    std::cout << std::setw(25) << "Max Descent Depth: " << counters.maxDescentDepth << std::endl;
+    if (filter.isEnabled())
+    {
+        std::cout << std::setw(25) << "Filter Rejections: " << counters.filterRejections << std::endl;
+        std::cout << std::setw(25) << "Filter Rebuilds: " << counters.filterRebuilds << std::endl;
+    }
+    if (capacity != 0)
+    {
+        std::cout << std::setw(25) << "Evictions: " << counters.evictions << std::endl;
+        std::cout << std::setw(25) << "Capacity Rejections: " << counters.capacityRejections << std::endl;
+    }
+#endif
+}
 
-            //Case 1: The inserted node's uncle is red
-            //Recolor the node's parent and uncle to be black, recolor the node's grandparent to be red. Preserves property 5
-            //By changing the node's grandparent to red, we may have introduced violations of property 2 or 4
-            //further up the tree. Change the inserted node pointer to point to the nodes grandparent and check for a violation
-            if (rightUncle->nodeColor == Color::RED)
-            {
-                insertedNode->parent->nodeColor = Color::BLACK;
-                rightUncle->nodeColor = Color::BLACK;
-                insertedNode->parent->parent->nodeColor = Color::RED;
-                insertedNode = insertedNode->parent->parent;
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Destroys the Red-Black tree, leaving only the NIL node as the root. Under Teardown::IMMEDIATE the nodes are freed
+/// in LRN order without rebalancing, or with RB_TREE_CONCURRENT_READS enabled by deleting the root until the tree is
+/// empty, so readers keep seeing a valid tree. Under the other policies the nodes are unlinked in O(1) and freed
+/// later, see setTeardown.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::destroyTree()
+{
+    //Dropped first, so deleting the nodes one at a time does not remove their entries one at a time
+    hashIndex.clear();
 
-                //Case 1 produces a net change of one more black node and one less red node
-                ++numBlackNodes;
-                --numRedNodes;
-            }
-            //Else, the inserted node's uncle is black
-            else
-            {
-                //Case 2: The inserted node's uncle is black and the inserted node is a right child
-                //Point to the inserted node's parent and perform a left rotate with the inserted node's parent as the pivot
-                //This changes our violation to case 3 and we fall through to case 3
-                if (insertedNode == insertedNode->parent->right)
-                {
-                    insertedNode = insertedNode->parent;
-                    leftRotate(insertedNode);
-                }
+    if (teardown != Teardown::IMMEDIATE)
+    {
+        if (root != NIL)
+        {
+            pendingNodes.push_back(root);
+            numPendingNodes += getNumNodes();
 
-                //Case 3: The inserted node's uncle is black and the inserted node is a left child
-                //Color the inserted node's parent black and the grandparent red then rotate right with
-                //the grandparent as the pivot. The recoloring and rotation preserve property 5. After case 3 we do not
-                //have two red nodes in a row and the loop will terminate. Since we do not point to the root in case two
-                //and three property two holds. Case 2 and 3 fix the only violation of property 4.
-                insertedNode->parent->nodeColor = Color::BLACK;
-                insertedNode->parent->parent->nodeColor = Color::RED;
-                rightRotate(insertedNode->parent->parent);
-            }
+            beginWrite();
+            root = NIL;
+            endWrite();
+#if RB_TREE_CONCURRENT_READS
+            //No reader may still be standing on the unlinked nodes when they are freed
+            waitForReaders();
+#endif
+            leftmost = NIL;
+            rightmost = NIL;
+            numRedNodes = 0;
+            numBlackNodes = 0;
+            numRepeats = 0;
+            numTombstones = 0;
+            finger = NIL;
+            ++structureVersion;
         }
-        //Same as the first if block but with left and right exchanged.
-        else //if (insertedNode->parent == insertedNode->parent->parent->right)
+
+        if (teardown == Teardown::BACKGROUND)
         {
-            RB_Node* leftUncle = insertedNode->parent->parent->left;
+            handOffPending();
+        }
+        filter.clear();
+        return;
+    }
 
-            //Case 1
-            if (leftUncle->nodeColor == Color::RED)
-            {
-                insertedNode->parent->nodeColor = Color::BLACK;
-                leftUncle->nodeColor = Color::BLACK;
-                insertedNode->parent->parent->nodeColor = Color::RED;
-                insertedNode = insertedNode->parent->parent;
+#if RB_TREE_CONCURRENT_READS
+	//While the tree is not empty, delete the root
+    while (root != NIL)
+    {
+        RB_delete(root);
+    }
+#else
+    freeSubtree(root);
+    root = NIL;
+    leftmost = NIL;
+    rightmost = NIL;
+    numRedNodes = 0;
+    numBlackNodes = 0;
+    ++structureVersion;
+#endif
 
-                //Case 1 produces a net change of one more black node and one less red node
-                ++numBlackNodes;
-                --numRedNodes;
-            }
-            else
-            {
-                //Case 2
-                if (insertedNode == insertedNode->parent->left)
-                {
-                    insertedNode = insertedNode->parent;
-                    rightRotate(insertedNode);
-                }
+    numRepeats = 0;
+    numTombstones = 0;
+    filter.clear();
+}
 
-                //Case 3
-                insertedNode->parent->nodeColor = Color::BLACK;
-                insertedNode->parent->parent->nodeColor = Color::RED;
-                leftRotate(insertedNode->parent->parent);
-            }
-        }
+/// <summary>
+/// Empties the tree without destroying its keys or returning its nodes to the allocator, pending nodes included. Meant for trees whose
+/// allocator draws from an arena, such as a std::pmr::monotonic_buffer_resource, that is released as a whole
+/// afterwards, so the tree does not have to visit its nodes first. With any other allocator the nodes are leaked.
+/// Keys must be trivially destructible, since keys that own memory would leak it.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::release()
+{
+    static_assert(std::is_trivially_destructible<keyType>::value,
+                  "release() requires a trivially destructible key type.");
+
+    root = NIL;
+    leftmost = NIL;
+    rightmost = NIL;
+    numRedNodes = 0;
+    numBlackNodes = 0;
+    numRepeats = 0;
+    numTombstones = 0;
+    finger = NIL;
+    ++structureVersion;
+    defragmentPlan.reset();
+    pendingNodes.clear();
+    numPendingNodes = 0;
+    filter.clear();
+    hashIndex.clear();
+#if RB_TREE_CONCURRENT_READS
+    retiredNodes.clear();
+#endif
+}
+
+/// <summary>
+/// Exchanges the contents and settings of two trees. The allocators are exchanged too if the allocator's
+/// propagate_on_container_swap is true, otherwise they must compare equal or std::invalid_argument is thrown.
+/// Nothing is allocated, but the links to each tree's NIL node are moved, which visits every node of both trees.
+/// </summary>
+/// <param name="other"> The tree exchanged with this one. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::swap(RB_Tree& other)
+{
+    if (&other == this)
+    {
+        return;
     }
 
-    //If the root color is red at this point, we recolor it black
-    if (root->nodeColor == Color::RED)
+    if constexpr (NodeTraits::propagate_on_container_swap::value)
     {
-        ++numBlackNodes;
-        --numRedNodes;
+        //Retired and pending nodes go back to the allocator they came from
+#if RB_TREE_CONCURRENT_READS
+        reclaim();
+        other.reclaim();
+#endif
+        finishTeardown();
+        other.finishTeardown();
+        using std::swap;
+        swap(nodeAllocator, other.nodeAllocator);
+    }
+    else if (!NodeTraits::is_always_equal::value && !(nodeAllocator == other.nodeAllocator))
+    {
+        throw std::invalid_argument{ "ERROR: Trees whose allocators do not compare equal cannot be swapped." };
     }
 
-    //Color the root black since at termination property 2 is the only property not guaranteed
-    root->nodeColor = Color::BLACK;
+    RB_Tree held{ std::move(other) };
+    other.adoptNodes(*this);
+    adoptNodes(held);
 }
 
-//ADD COMMENTS, REWRITE
-template<typename keyType>
-void RB_Tree<keyType>::deleteFixup(RB_Node* x)
+/// <summary>
+/// Returns a copy of the allocator the tree's nodes come from, rebound to the key type.
+/// </summary>
+/// <returns> The tree's allocator. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+Allocator RB_Tree<keyType, duplicates, balance, Allocator>::getAllocator() const
 {
-    RB_Node* w;
-    while (x != root && x->nodeColor == Color::BLACK)
-    {
-        if (x == x->parent->left)
-        {
-            w = x->parent->right;
-            //case1 transforms to case 2,3,4
-            if (w->nodeColor == Color::RED)
-            {
-                w->nodeColor = Color::BLACK;
-                x->parent->nodeColor = Color::RED;
-                leftRotate(x->parent);
-                w = x->parent->right;
-            }
-            //case 2
-            if (w->left->nodeColor == Color::BLACK && w->right->nodeColor == Color::BLACK)
-            {
-                w->nodeColor = Color::RED;
-                x = x->parent;
+    return Allocator{ nodeAllocator };
+}
 
-                //Adjust the red and black node counts
-                ++numRedNodes;
-                --numBlackNodes;
-            }
-            else
-            {
-                //case 3 transforms to case 4
-                if (w->right->nodeColor == Color::BLACK)
-                {
-                    w->left->nodeColor = Color::BLACK;
-                    w->nodeColor = Color::RED;
-                    rightRotate(w);
-                    w = x->parent->right;
-                }
+/// <summary>
+/// Determines the type of way the tree wants to be displayed. As of now, the two options
+/// are ascending and descending. If more ways to order tree was to be added, add more types
+/// to the Order enumerator class and account for them within the displayTree function.
+/// </summary>
+/// <param name="ord"> Specifies the order in which the tree is displayed. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::displayTree(const Order ord) const
+{
+	// Set the node to its root value.
+	RB_Node* node = root;
 
-                //case 4
-                w->nodeColor = x->parent->nodeColor;
-                x->parent->nodeColor = Color::BLACK;
-                w->right->nodeColor = Color::BLACK;
-                leftRotate(x->parent);
-                x = root;
+	// If the node is NIL, no tree.
+	if (node == NIL)
+	{
+		return;
+	}
+	// If the value of x is 0, place the tree in ascending order.
+	else if (ord == Order::ASC)
+	{
+		ascending(node);
+	}
+	// If the value of x is 1, place the tree in descending order.
+	else if (ord == Order::DES)
+	{
+		descending(node);
+	}
+	// If the value does not exist within the enumerator class Order, display the following:
+	else
+	{
+		std::cout << "Order not within the enumerator class." << std::endl;
+	}
+}
 
-                //Adjust the red and black node counts
-                --numRedNodes;
-                ++numBlackNodes;
-            }
-        }
-        else
-        {
-            w = x->parent->left;
+/// <summary>
+/// Returns a snapshot of the operation counters. All counters are zero unless the header was compiled with
+/// RB_TREE_COUNTERS enabled.
+/// </summary>
+/// <returns> A copy of the counters accumulated since construction or the last reset. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+OperationCounters RB_Tree<keyType, duplicates, balance, Allocator>::getCounters() const
+{
+#if RB_TREE_COUNTERS
+    return counters;
+#else
+    return OperationCounters{};
+#endif
+}
 
-            //Case 1
-            if (w->nodeColor == Color::RED)
-            {
-                w->nodeColor = Color::BLACK;
-                x->parent->nodeColor = Color::RED;
-                rightRotate(x->parent);
-                w = x->parent->left;
-            }
+/// <summary>
+/// Sets every operation counter back to zero. Does nothing when the counters are compiled out.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::resetCounters()
+{
+#if RB_TREE_COUNTERS
+    counters = OperationCounters{};
+#endif
+}
 
-            //Case 2
-            if (w->right->nodeColor == Color::BLACK && w->left->nodeColor == Color::BLACK)
-            {
-                w->nodeColor = Color::RED;
-                x = x->parent;
+/// <summary>
+/// Returns an iterator to the smallest key in the tree, or end() if the tree is empty. Takes constant time unless
+/// tombstones have to be skipped.
+/// </summary>
+/// <returns> An iterator to the first key in ascending order. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::iterator RB_Tree<keyType, duplicates, balance, Allocator>::begin() const
+{
+    return iterator{ firstLive(leftmost), this };
+}
 
-                //Adjust the red and black node counts
-                ++numRedNodes;
-                --numBlackNodes;
-            }
-            else
-            {
-                //Case 3
-                if (w->left->nodeColor == Color::BLACK)
-                {
-                    w->right->nodeColor = Color::BLACK;
-                    w->nodeColor = Color::RED;
-                    leftRotate(w);
-                    w = x->parent->left;
-                }
+/// <summary>
+/// Returns the past-the-end iterator. Decrementing it yields the largest key.
+/// </summary>
+/// <returns> An iterator referring to the tree's NIL node. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::iterator RB_Tree<keyType, duplicates, balance, Allocator>::end() const
+{
+    return iterator{ NIL, this };
+}
 
-                //Case 4
-                w->nodeColor = x->parent->nodeColor;
-                x->parent->nodeColor = Color::BLACK;
-                w->left->nodeColor = Color::BLACK;
-                rightRotate(x->parent);
-                x = root;
+/// <summary>
+/// Finds the intervals that contain a point. Only available when the keys are Interval.
+/// </summary>
+/// <param name="point"> The point being looked up. </param>
+/// <returns> Every interval with low <= point <= high, in ascending order. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+std::vector<keyType> RB_Tree<keyType, duplicates, balance, Allocator>::overlapping(const endpointType point) const
+{
+    return overlapping(point, point);
+}
 
-                //Adjust the red and black node counts
-                ++numBlackNodes;
-                --numRedNodes;
-            }
-        }
+/// <summary>
+/// Finds the intervals that share at least one point with [low, high]. The search skips every subtree whose largest
+/// endpoint is below low, so it takes O(log n + k) time for k results when the matches are clustered and never
+/// visits more than O(k log n) nodes. Only available when the keys are Interval.
+/// </summary>
+/// <param name="low"> The start of the query range. </param>
+/// <param name="high"> The end of the query range, included in it. Must not be less than low. </param>
+/// <returns> Every interval overlapping the range, in ascending order. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+std::vector<keyType> RB_Tree<keyType, duplicates, balance, Allocator>::overlapping(const endpointType low, const endpointType high) const
+{
+    static_assert(intervalKeys, "ERROR: overlapping needs a tree of Interval keys.");
+
+    if (high < low)
+    {
+        throw std::invalid_argument{ "ERROR: The end of the range is less than its start." };
     }
 
-    //Check if we need to adjust our counter
-    if (x->nodeColor != Color::BLACK)
+    std::vector<keyType> found;
+    collectOverlapping(root, low, high, found);
+
+    return found;
+}
+
+/// <summary>
+/// Finds the first key that is not smaller than a value.
+/// </summary>
+/// <param name="x"> The value being searched for. </param>
+/// <returns> An iterator to the first key not less than x, or end() if there is none. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::iterator RB_Tree<keyType, duplicates, balance, Allocator>::lowerBound(const keyType& x) const
+{
+    RB_Node* bound{ NIL };
+
+    for (RB_Node* traverse{ root }; traverse != NIL;)
     {
-        --numRedNodes;
-        ++numBlackNodes;
+        if (traverse->key < x)
+        {
+            traverse = traverse->right;
+        }
+        else
+        {
+            bound = traverse;
+            traverse = traverse->left;
+        }
     }
 
-    x->nodeColor = Color::BLACK;
+    return iterator{ firstLive(bound), this };
 }
 
 /// <summary>
-/// Inserts a node into the red black tree
+/// Finds the first key that is larger than a value.
 /// </summary>
-/// <param name="insertedNode"> A pointer to the node being inserted in the tree </param>
-template<typename keyType>
-void RB_Tree<keyType>::RB_insert(RB_Node* insertedNode)
+/// <param name="x"> The value being searched for. </param>
+/// <returns> An iterator to the first key greater than x, or end() if there is none. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::iterator RB_Tree<keyType, duplicates, balance, Allocator>::upperBound(const keyType& x) const
 {
-    //Pointer to trail the inserted node, points to the parent when the insertion takes place
-    RB_Node* trailing = NIL;
-
-    //Pointer used to traverse the tree, we stop traversing when this pointer points to NIL
-    RB_Node* traverse = root;
+    RB_Node* bound{ NIL };
 
-    //Find the position to insert the node
-    while (traverse != NIL)
+    for (RB_Node* traverse{ root }; traverse != NIL;)
     {
-        trailing = traverse;
-        if (insertedNode->key < traverse->key)
+        if (x < traverse->key)
         {
+            bound = traverse;
             traverse = traverse->left;
         }
         else
@@ -510,491 +6030,770 @@ void RB_Tree<keyType>::RB_insert(RB_Node* insertedNode)
         }
     }
 
-    //Set the inserted node's parent to point to the trailing pointer
-    insertedNode->parent = trailing;
+    return iterator{ firstLive(bound), this };
+}
 
-    //Check if the inserted node is the root, a left child, or a right child and insert the node into the tree
-    if (trailing == NIL)
+/// <summary>
+/// Reports the memory held by the tree: its nodes including padding, the NIL node, an estimate of the
+/// allocator's per allocation overhead and, for key types with a KeyHeapUsage specialization, the memory the keys
+/// own. Keys are only visited when KeyHeapUsage says they own heap memory.
+/// </summary>
+/// <returns> The memory usage broken down by source. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+MemoryUsage RB_Tree<keyType, duplicates, balance, Allocator>::memoryUsage() const
+{
+    MemoryUsage usage;
+
+    //Nodes a Teardown::DEFERRED tree has unlinked but not yet freed are still held
+    const std::size_t heldNodes{ static_cast<std::size_t>(getNumNodes()) + numPendingNodes };
+
+    usage.nodeBytes = heldNodes * sizeof(RB_Node);
+    usage.sentinelBytes = sizeof(RB_Node);
+    usage.allocatorBytes = heldNodes * allocationOverhead(sizeof(RB_Node));
+
+    if constexpr (KeyHeapUsage<keyType>::ownsHeap)
     {
-        root = insertedNode;
+        for (const RB_Node* node{ leftmost }; node != NIL; node = successor(node))
+        {
+            usage.keyHeapBytes += KeyHeapUsage<keyType>::bytes(node->key);
+        }
     }
-    else if (insertedNode->key < trailing->key)
+
+    usage.filterBytes = filter.bytes();
+    usage.indexBytes = hashIndex.bytes();
+    return usage;
+}
+
+//NOTE: Memory is allocated and freed in this function
+/// <summary>
+/// Compacts the memory held by the tree after large deletions. The tree keeps no spare node capacity, removed nodes
+/// are freed at once, so the survivors are what remain scattered across the heap. Every node is moved to a newly
+/// allocated node, in NLR order and before any old node is freed, and each key gives up its spare capacity through
+/// KeyHeapUsage. The logical tree is unchanged, but iterators and node handles taken before the call are invalid.
+/// The old nodes are returned to the allocator together; how much of that reaches the operating system depends on
+/// the allocator. Node storage briefly doubles while the copy is made.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::shrinkToFit()
+{
+    //Tombstones are freed rather than relocated
+    compact();
+
+    RB_Node* const oldRoot{ root };
+
+    ++structureVersion;
+    root = relocateSubtree(oldRoot, NIL);
+    freeSubtree(oldRoot);
+
+    leftmost = minimum(root);
+    rightmost = maximum(root);
+    rebuildIndex();
+}
+
+/// <summary>
+/// Turns lazy deletion on or off. In lazy deletion mode remove marks the node as a tombstone in O(log n) without
+/// rotations or recoloring. Lookups and iteration skip tombstones, inserting a key that matches a
+/// tombstone reuses its node, and once the fraction of tombstone nodes passes the threshold compact() frees them
+/// all with a linear rebuild. Turning lazy deletion off compacts the tree.
+/// </summary>
+/// <param name="enabled"> True to mark removed nodes as tombstones, false to delete them at once. </param>
+/// <param name="threshold"> The fraction of nodes that may be tombstones before remove compacts the tree. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::setLazyDeletion(const bool enabled, const double threshold)
+{
+    lazyDeletion = enabled;
+    compactThreshold = threshold;
+
+    if (!lazyDeletion)
     {
-        trailing->left = insertedNode;
+        compact();
     }
-    else
+}
+
+/// <summary>
+/// Accessor function for the lazyDeletion member
+/// </summary>
+/// <returns> True if remove marks nodes as tombstones. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::isLazyDeletion() const
+{
+    return lazyDeletion;
+}
+
+/// <summary>
+/// Accessor function for the numTombstones member
+/// </summary>
+/// <returns> The number of nodes that are tombstones. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+unsigned RB_Tree<keyType, duplicates, balance, Allocator>::getNumTombstones() const
+{
+    return numTombstones;
+}
+
+/// <summary>
+/// Chooses how destroyTree and the destructor free the tree's nodes, which for large trees takes long enough to
+/// stall the calling thread. Under Teardown::DEFERRED destroyTree unlinks the nodes in O(1) and every later insert
+/// and remove frees up to chunk of them; the destructor frees whatever is left. Under Teardown::BACKGROUND both hand
+/// the nodes to the BackgroundReclaimer thread in O(1), which requires an allocator that may free from another thread
+/// and keys that may be destroyed on it. Copies, moves and swaps take the policy along.
+/// </summary>
+/// <param name="policy"> The teardown policy. </param>
+/// <param name="chunk"> The most pending nodes an insert or remove frees under Teardown::DEFERRED, at least 1. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::setTeardown(const Teardown policy, const unsigned chunk)
+{
+    if (chunk == 0)
     {
-        trailing->right = insertedNode;
+        throw std::invalid_argument{ "ERROR: The teardown chunk must free at least one node." };
     }
 
-	//Restore RedBlack Tree properties
-    insertFixup(insertedNode);
+    teardown = policy;
+    teardownChunk = chunk;
 }
 
-//ADD COMMENTS, REWRITE
-//NOTE: Memory is freed in this function
-template<typename keyType>
-void RB_Tree<keyType>::RB_delete(RB_Node* nodeToDelete)
+/// <summary>
+/// Accessor function for the teardown member
+/// </summary>
+/// <returns> The teardown policy. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+Teardown RB_Tree<keyType, duplicates, balance, Allocator>::getTeardown() const
 {
-    RB_Node* y = nodeToDelete;
-    RB_Node* replacement;
-    Color originalColor = nodeToDelete->nodeColor;
+    return teardown;
+}
 
-    if (nodeToDelete->left == NIL)
+/// <summary>
+/// Accessor function for the numPendingNodes member
+/// </summary>
+/// <returns> The number of nodes destroyTree unlinked under Teardown::DEFERRED that have not been freed yet. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+unsigned RB_Tree<keyType, duplicates, balance, Allocator>::getNumPendingNodes() const
+{
+    return numPendingNodes;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Frees every node left by a Teardown::DEFERRED destroyTree now.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::finishTeardown()
+{
+    //Every pending node is the root of a subtree none of whose nodes have been freed
+    while (!pendingNodes.empty())
     {
-        replacement = nodeToDelete->right;
-        transplant(nodeToDelete, nodeToDelete->right);
+        RB_Node* const subtreeRoot{ pendingNodes.back() };
+        pendingNodes.pop_back();
+        freeSubtree(subtreeRoot);
     }
-    else if (nodeToDelete->right == NIL)
+    numPendingNodes = 0;
+}
+
+//NOTE: Memory is allocated and freed in this function
+/// <summary>
+/// Turns the membership filter on or off. While it is on, containsKey, countKey and remove first test a blocked Bloom
+/// filter of the tree's keys, and return without searching for most keys that are absent: fewer than 1% of them get
+/// through at 10 bits per key. A lookup of a present key costs one extra cache line. The filter holds bitsPerKey bits
+/// for up to twice the nodes of the tree and is refilled from the tree when it fills up, which also clears the bits
+/// of removed keys. Enabling it fills it at once in O(n). Keys need std::hash or a KeyHash specialization. Throws
+/// std::invalid_argument if the filter is enabled with 0 or more than 64 bits per key.
+/// </summary>
+/// <param name="enabled"> True to filter lookups, false to drop the filter and free its memory. </param>
+/// <param name="bitsPerKey"> Bits of filter per key. More bits mean fewer absent keys searched for. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::setMembershipFilter(const bool enabled, const unsigned bitsPerKey)
+{
+    static_assert(KeyHash<keyType>::available, "The membership filter needs std::hash or KeyHash for the key type.");
+
+    if (enabled && (bitsPerKey == 0 || bitsPerKey > 64))
     {
-        replacement = nodeToDelete->left;
-        transplant(nodeToDelete, nodeToDelete->left);
+        throw std::invalid_argument{ "ERROR: The membership filter needs between 1 and 64 bits per key." };
     }
-    else
+
+    filter.setBitsPerKey(enabled ? bitsPerKey : 0);
+    if (enabled)
     {
-        y = minimum(nodeToDelete->right);
-        originalColor = y->nodeColor;
-        replacement = y->right;
+        refillFilter();
+    }
+}
 
-        if (y->parent == nodeToDelete)
-        {
-            replacement->parent = y;
-        }
-        else
-        {
-            transplant(y, y->right);
-            y->right = nodeToDelete->right;
-            y->right->parent = y;
-        }
+/// <summary>
+/// Tells whether lookups are filtered, see setMembershipFilter.
+/// </summary>
+/// <returns> True if the membership filter is enabled. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::isMembershipFilter() const
+{
+    return filter.isEnabled();
+}
 
-        transplant(nodeToDelete, y);
-        y->left = nodeToDelete->left;
-        y->left->parent = y;
+/// <summary>
+/// Turns finger search on or off. In finger search mode containsKey, countKey, remove and extract start from the node
+/// the previous lookup, insert or removal ended at, rather than from the root, so a key d positions away from the
+/// previous one is found in O(log d) steps. Streams of nearby keys get faster; scattered keys pay for the climb,
+/// up to twice the cost of a search from the root. Lookups then move the finger, so unlike other const member
+/// functions they must not run concurrently with each other.
+/// </summary>
+/// <param name="enabled"> True to start lookups from the finger, false to start them from the root. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::setFingerSearch(const bool enabled)
+{
+    fingerSearch = enabled;
+}
 
-        //The node y will be recolored with the color of the node we are deleting
-        //If the node colors are different, then y will change color and the counters are adjusted
-        if (y->nodeColor != nodeToDelete->nodeColor)
-        {
-            //y changes color to the color of the node being deleted
-            if (nodeToDelete->nodeColor == Color::BLACK)
-            {
-                ++numBlackNodes;
-                --numRedNodes;
-            }
-            else
-            {
-                ++numRedNodes;
-                --numBlackNodes;
-            }
-        }
+/// <summary>
+/// Tells whether lookups start from the finger, see setFingerSearch.
+/// </summary>
+/// <returns> True if finger search is enabled. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::isFingerSearch() const
+{
+    return fingerSearch;
+}
 
-        y->nodeColor = nodeToDelete->nodeColor;
-    }
+/// <summary>
+/// Reports the work done by finger searches since the tree was created or resetFingerStats was called. A hit is a
+/// lookup that found the key's place without climbing to the root. The average number of nodes visited shows the
+/// O(log d) cost directly and can be compared with getTreeHeight.
+/// </summary>
+/// <returns> The finger search statistics. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+FingerStats RB_Tree<keyType, duplicates, balance, Allocator>::getFingerStats() const
+{
+    return fingerStats;
+}
 
-    //Adjust the appropriate counter before removing a node
-    if (nodeToDelete->nodeColor == Color::BLACK)
+/// <summary>
+/// Sets the finger search statistics back to zero.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::resetFingerStats()
+{
+    fingerStats = FingerStats{};
+}
+
+//NOTE: Memory is allocated and freed in this function
+/// <summary>
+/// Turns the hash index on or off. While it is on, every node also has an entry in a hash table from its key, kept
+/// up to date as nodes are linked and unlinked. containsKey, countKey, remove and extract then find their node in
+/// O(1) expected time instead of searching the tree, and remove only pays for unlinking the node. Ordered operations
+/// do not use the index. Each slot takes 9 bytes and a quarter to three quarters of the slots are in use, so the
+/// index costs 12 to 36 bytes per node. concurrentContainsKey does not use it, and if the table cannot grow during
+/// an insert it is turned off, which isHashIndex reports. Throws std::bad_alloc if the index cannot be built.
+/// </summary>
+/// <param name="enabled"> True to build the index, false to drop it and free its memory. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::setHashIndex(const bool enabled)
+{
+    static_assert(KeyHash<keyType>::available, "The hash index needs std::hash or KeyHash for the key type.");
+
+    if (enabled == hashIndex.isEnabled())
     {
-        --numBlackNodes;
+        return;
     }
-    else
+
+    hashIndex.setEnabled(enabled);
+    rebuildIndex();
+    if (enabled && !hashIndex.isEnabled())
     {
-        --numRedNodes;
+        throw std::bad_alloc{};
     }
+}
 
-	//Free allocated memory
-    delete nodeToDelete;
+/// <summary>
+/// Tells whether lookups use the hash index, see setHashIndex.
+/// </summary>
+/// <returns> True if the hash index is enabled. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::isHashIndex() const
+{
+    return hashIndex.isEnabled();
+}
 
-    if (originalColor == Color::BLACK)
-    {
-        deleteFixup(replacement);
-    }
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Bounds the number of keys the tree holds. Once it is full, an insert of a new key also removes the smallest key
+/// under Eviction::SMALLEST or the largest under Eviction::LARGEST, in the same call and as remove would, so the
+/// tree keeps its capacity many nodes. A key that would be evicted at once, such as a key no larger than the smallest
+/// under Eviction::SMALLEST, is rejected after one comparison, without searching the tree or allocating a node.
+/// emplace has to build the key first, so it allocates the node before rejecting it. The tree is trimmed to the new
+/// capacity right away. Copies, moves, swaps and set operator results keep the bound.
+/// </summary>
+/// <param name="maxKeys"> The most keys the tree may hold, 0 to remove the bound. </param>
+/// <param name="evict"> The end of the tree keys are evicted from. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::setCapacity(const unsigned maxKeys, const Eviction evict)
+{
+    capacity = maxKeys;
+    eviction = evict;
+    evictOverflow();
 }
 
 /// <summary>
-/// Compares two integers and returns the beg
+/// Accessor function for the capacity member
 /// </summary>
-/// <param name="a"> First integer being compared. </param>
-/// <param name="b"> Second integer being compared. </param>
-/// <returns> The maximum of the two integers. </returns>
-template<typename keyType>
-int RB_Tree<keyType>::maximum(const int a, const int b) const
+/// <returns> The most keys the tree may hold, 0 if it is not bounded. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+unsigned RB_Tree<keyType, duplicates, balance, Allocator>::getCapacity() const
 {
-    return (a > b) ? a : b;
+    return capacity;
 }
 
 /// <summary>
-/// Calculates the height of the tree rooted at the node passed as a paramater.
+/// Accessor function for the eviction member
 /// </summary>
-/// <param name="subtreeRoot"> Pointer to the root of the subtree height is being calculated for. </param>
-/// <returns> The height of the subtree as an int. </returns>
-template<typename keyType>
-int RB_Tree<keyType>::calculateSubtreeHeight(const RB_Node* const subtreeRoot) const
+/// <returns> The end of the tree a full bounded tree evicts from. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+Eviction RB_Tree<keyType, duplicates, balance, Allocator>::getEviction() const
 {
-	//If our subtree is empty, return height of -1
-    if (subtreeRoot == NIL)
+    return eviction;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Physically removes every tombstone. The live nodes are threaded into a sorted list and relinked into a balanced
+/// tree in O(n) time without allocating, instead of running a delete fixup per tombstone. Live nodes are not moved,
+/// so iterators to them stay valid. Does nothing if there are no tombstones.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::compact()
+{
+    if (numTombstones == 0)
     {
-        return -1;
+        return;
     }
-	//Otherwise, return the maximum of the height of the left and right subtrees of the current node
-    else
+
+    RB_Node* head{ NIL };
+    RB_Node* tail{ NIL };
+    unsigned count{ 0 };
+
+    //collectLive marks every node as it rewrites the links, and the live ones are marked done once relinked. The
+    //tombstones stay marked, so a reader still standing on one searches again.
+    beginWrite();
+    collectLive(root, head, tail, count);
+    ++structureVersion;
+
+    numRedNodes = 0;
+    numBlackNodes = 0;
+    numTombstones = 0;
+
+    linkBalanced(head, count);
+#if RB_TREE_CONCURRENT_READS
+    for (RB_Node* node{ leftmost }; node != NIL; node = successor(node))
     {
-        return maximum(calculateSubtreeHeight(subtreeRoot->left), calculateSubtreeHeight(subtreeRoot->right)) + 1;
+        markChanged(node);
     }
+#endif
+    endWrite();
 }
 
 /// <summary>
-/// Allocates a new red black tree by copying the structure of another.
+/// Places the nodes in memory in the given layout without changing the tree. No memory is allocated or freed. The
+/// nodes keep the addresses they already own, and the contents are moved so that the address order follows the
+/// layout. After long churn the nodes are spread across the heap in the order they happened to be allocated. Sorting
+/// them turns a scan or a search path into a forward walk through memory. It also puts nodes that are visited
+/// together on the same cache lines and pages. Iterators and node handles taken before the call refer to other keys
+/// afterwards.
 /// </summary>
-/// <param name="copyTo_parent"> Pointer to the parent of node being copied to. </param>
-/// <param name="copyFrom"> Pointer to the node being copied. </param>
-/// <param name="copyFrom_NIL"> Pointer to the NIL node in the tree being copied from. </param>
-template<typename keyType>
-void RB_Tree<keyType>::copyTree(RB_Node* copyTo_parent, RB_Node* copyFrom, RB_Node* copyFrom_NIL)
+/// <param name="layout"> The order the nodes should follow in memory. IN_ORDER favors scans, DEPTH_FIRST and VEB favor lookups. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::defragment(const Layout layout)
 {
-	//If the node from the subtree we are copying from is that tree's NIL node, there is nothing to copy
-	if (copyFrom == copyFrom_NIL)
-	{
-		return;
-	}
+    defragmentPlan.reset();
 
-	//The node being copied is not NIL so allocate a new node and perform the copy
-	RB_Node* copyTo{ new RB_Node };
-	copyTo->key = copyFrom->key;
-	copyTo->nodeColor = copyFrom->nodeColor;
-	copyTo->parent = copyTo_parent;
-	copyTo->left = NIL;
-	copyTo->right = NIL;
-	
-	//If the tree being copied to happens to be empty, set the root to the new node that was allocated
-	if (root == NIL)
-	{
-		root = copyTo;
-	}
+    const std::unique_ptr<DefragmentPlan> plan{ planDefragment(layout) };
+    stepDefragment(*plan, nullptr);
+}
 
-	//Check if the node being copied to is a left or right child and link it accordingly
-	if (copyTo->key < copyTo_parent->key)
-	{
-		copyTo_parent->left = copyTo;
-	}
-	else
-	{
-		copyTo_parent->right = copyTo;
-	}
+/// <summary>
+/// Runs defragment in bounded time slices, so it can be spread across idle periods of a long-lived tree. Each call
+/// moves nodes until the time slice runs out and remembers where it stopped. The first call of a pass also plans
+/// the moves, which sorts the node addresses. Linking or unlinking nodes between calls, or asking for a different
+/// layout, starts a new pass. The tree is valid between calls, but iterators and node handles taken before a call
+/// may refer to other keys afterwards.
+/// </summary>
+/// <param name="timeSlice"> The time the call may spend moving nodes. </param>
+/// <param name="layout"> The order the nodes should follow in memory. </param>
+/// <returns> True once every node is in place, false if more calls are needed. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::defragmentFor(const std::chrono::microseconds timeSlice, const Layout layout)
+{
+    const std::chrono::steady_clock::time_point deadline{ std::chrono::steady_clock::now() + timeSlice };
 
-	//Recursively call the copySubtree function twice with the node being copied to as the copyTo_parent in the next calls
-	//and the left and right children of the node being copied as the copyFrom node in the next calls
-	copyTree(copyTo, copyFrom->left, copyFrom_NIL);
-	copyTree(copyTo, copyFrom->right, copyFrom_NIL);
+    if (!defragmentPlan || defragmentPlan->version != structureVersion || defragmentPlan->layout != layout)
+    {
+        defragmentPlan = planDefragment(layout);
+    }
+
+    if (!stepDefragment(*defragmentPlan, &deadline))
+    {
+        return false;
+    }
+
+    defragmentPlan.reset();
+    return true;
 }
 
 /// <summary>
-/// Perform a LNR traversal of some tree and insert each node in that tree into THIS tree.
+/// Accesses the smallest key in the tree in constant time. Throws std::out_of_range if the tree is empty.
 /// </summary>
-/// <param name="traverse"> Pointer to a node in the tree being traversed. </param>
-/// <param name="traverseTreeNIL"> Pointer to the NIL node in the tree being traversed. </param>
-template<typename keyType>
-void RB_Tree<keyType>::traverseInsert(const RB_Node* const traverse, const RB_Node* const traverseTreeNIL)
+/// <returns> A constant reference to the smallest key. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+const keyType& RB_Tree<keyType, duplicates, balance, Allocator>::getMin() const
 {
-	// If node is NIL, return recursively to the function called from.
-	if (traverse == traverseTreeNIL)
-		return;
-
-	// Recursively call the function to the left of the tree.
-	traverseInsert(traverse->left, traverseTreeNIL);
+    const RB_Node* const first{ firstLive(leftmost) };
 
-	// Insert a new node into THIS tree with the key value of the traverse node
-	insert(traverse->key);
+    if (first == NIL)
+    {
+        throw std::out_of_range{ "ERROR: The tree is empty." };
+    }
 
-	// Recursively call the function to the right of the tree.
-	traverseInsert(traverse->right, traverseTreeNIL);
+    return first->key;
 }
 
 /// <summary>
-/// Compares two trees by comparing the two nodes being pointed to and then recursively comparing the
-/// left and right subtrees of these nodes.
+/// Accesses the largest key in the tree in constant time. Throws std::out_of_range if the tree is empty.
 /// </summary>
-/// <param name="t1"> Pointer to a node THIS tree which is being compared. </param>
-/// <param name="t2"> Pointer to a node in the second tree being compared. </param>
-/// <param name="t2NIL"> Pointer to the second tree's NIL node. </param>
-/// <returns> True if the two nodes are the same and their subtrees are the same, otherwise false. </returns>
-template<typename keyType>
-bool RB_Tree<keyType>::compareSubtrees(const RB_Node* t1, const RB_Node* t2, RB_Node* const t2NIL) const
-{			
-			//Both nodes have the same key
-	return (t1->key == t2->key) &&
-		   //AND both nodes have the same left subtrees
-		   ((t1->left == NIL && t2->left == t2NIL) ||
-		   (t1->left != NIL && t2->left != t2NIL && compareSubtrees(t1->left, t2->left, t2NIL))) &&
-		   //AND both nodes have the same right subtrees
-		   ((t1->right == NIL && t2->right == t2NIL) ||
-		   (t1->right != NIL && t2->right != t2NIL && compareSubtrees(t1->right, t2->right, t2NIL)));
+/// <returns> A constant reference to the largest key. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+const keyType& RB_Tree<keyType, duplicates, balance, Allocator>::getMax() const
+{
+    const RB_Node* const last{ lastLive(rightmost) };
+
+    if (last == NIL)
+    {
+        throw std::out_of_range{ "ERROR: The tree is empty." };
+    }
+
+    return last->key;
 }
 
+//NOTE: Memory is freed in this function
 /// <summary>
-/// Initially a node that points to the root node will then traverse the tree
-/// in a ascending order, following the LNR (Left-Node-Right) order.
+/// Removes the smallest key from the tree and returns it. The cached smallest node is deleted directly,
+/// so no search is performed. Throws std::out_of_range if the tree is empty.
 /// </summary>
-/// <param name="node"> A pointer to a node that will traverse the tree </param>
-template<typename keyType>
-void RB_Tree<keyType>::ascending(const RB_Node* const node) const
+/// <returns> The key that was removed. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+keyType RB_Tree<keyType, duplicates, balance, Allocator>::popMin()
 {
-	// If node is NIL, return recursively to the function called from.
-	if (node == NIL)
-		return;
+    //Tombstones at the end of the tree are freed here, so repeated pops do not skip over the same ones
+    while (leftmost != NIL && leftmost->tombstone)
+    {
+        RB_delete(leftmost);
+        --numTombstones;
+    }
 
-	// Recursively call the function to the left of the tree.
-	ascending(node->left);
+    if (leftmost == NIL)
+    {
+        throw std::out_of_range{ "ERROR: The tree is empty." };
+    }
+    RB_TREE_TRACE_OP(OpType::REMOVE, leftmost->key);
+
+    //A counted key held more than once only loses one copy
+    if constexpr (duplicates == Duplicates::COUNTED)
+    {
+        if (leftmost->count > 1)
+        {
+            --leftmost->count;
+            --numRepeats;
+            return leftmost->key;
+        }
+    }
 
-	// Display node's key value.
-	std::cout << node->key << std::endl;
+    //Move the key out before the node is freed. A concurrent reader may still compare against the retired node, so
+    //the key is copied when readers are compiled in.
+#if RB_TREE_CONCURRENT_READS
+    keyType x{ leftmost->key };
+#else
+    keyType x{ std::move(leftmost->key) };
+#endif
+    RB_delete(leftmost);
 
-	// Recursively call the function to the right of the tree.
-	ascending(node->right);
+    return x;
 }
 
+//NOTE: Memory is freed in this function
 /// <summary>
-/// Initially a node that points to the root node will then traverse the tree
-/// in a descending order, RNL (Right-Node-Left) order.
+/// Removes the largest key from the tree and returns it. The cached largest node is deleted directly,
+/// so no search is performed. Throws std::out_of_range if the tree is empty.
 /// </summary>
-/// <param name="node"> A pointer to a node that will traverse the tree </param>
-template<typename keyType>
-void RB_Tree<keyType>::descending(const RB_Node* const node) const
+/// <returns> The key that was removed. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+keyType RB_Tree<keyType, duplicates, balance, Allocator>::popMax()
 {
-	// If node is NIL, return recursively to the function called from.
-	if (node == NIL)
-		return;
+    //Tombstones at the end of the tree are freed here, so repeated pops do not skip over the same ones
+    while (rightmost != NIL && rightmost->tombstone)
+    {
+        RB_delete(rightmost);
+        --numTombstones;
+    }
 
-	// Recursively call the function to the right of the tree.
-	descending(node->right);
+    if (rightmost == NIL)
+    {
+        throw std::out_of_range{ "ERROR: The tree is empty." };
+    }
+    RB_TREE_TRACE_OP(OpType::REMOVE, rightmost->key);
+
+    //A counted key held more than once only loses one copy
+    if constexpr (duplicates == Duplicates::COUNTED)
+    {
+        if (rightmost->count > 1)
+        {
+            --rightmost->count;
+            --numRepeats;
+            return rightmost->key;
+        }
+    }
 
-	// Display node's key value.
-	std::cout << node->key << std::endl;
+    //Move the key out before the node is freed. A concurrent reader may still compare against the retired node, so
+    //the key is copied when readers are compiled in.
+#if RB_TREE_CONCURRENT_READS
+    keyType x{ rightmost->key };
+#else
+    keyType x{ std::move(rightmost->key) };
+#endif
+    RB_delete(rightmost);
 
-	// Recursively call the function to the left of the tree.
-	descending(node->left);
+    return x;
 }
 
-//***************************************
-//			Default Contructor
-//***************************************
+//************************************************
+//				Iterator
+//************************************************
 /// <summary>
-/// Constructor for RB_Tree. Allocates a NIL node and points root to NIL. The NIL node is colored black
+/// Creates an iterator referring to a node of a tree.
 /// </summary>
-template<typename keyType>
-RB_Tree<keyType>::RB_Tree() : NIL{ new RB_Node }, numBlackNodes{ 0 }, numRedNodes{ 0 }
+/// <param name="position"> The node the iterator refers to, the tree's NIL node for end(). </param>
+/// <param name="owner"> The tree the node belongs to. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>::iterator::iterator(const RB_Node* const position, const RB_Tree* const owner) :
+    node{ position }, tree{ owner }
 {
-    NIL->nodeColor = Color::BLACK;
-    root = NIL;
 }
 
-//***************************************
-//			Copy Constructor
-//***************************************
 /// <summary>
-/// Red-Black Tree copy constructor. Sets up an empty tree then copies data from the tree parameter.
+/// Creates a singular iterator that does not refer to any tree.
 /// </summary>
-/// <param name="right"> Constant reference to the tree being copied. </param>
-template<typename keyType>
-RB_Tree<keyType>::RB_Tree(const RB_Tree& right) : 
-	NIL{ new RB_Node }, numBlackNodes{ right.numBlackNodes }, numRedNodes{ right.numRedNodes }
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>::iterator::iterator() : node{ nullptr }, tree{ nullptr }
 {
-	//Set up empty tree
-	NIL->nodeColor = Color::BLACK;
-	root = NIL;
-
-	//Copy data from the tree parameter
-	copyTree(root, right.root, right.NIL);
 }
 
-//*********************************
-//			Destructor
-//*********************************
-//NOTE: Memory is deallocated in this function
 /// <summary>
-/// Red-Black Tree destructor. Destroys the tree and frees the allocated memory. The memory allocated to the NIL node is
-/// deallocated in the destructor.
+/// Accesses the key the iterator refers to.
 /// </summary>
-template<typename keyType>
-RB_Tree<keyType>::~RB_Tree()
+/// <returns> A constant reference to the key. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::iterator::reference RB_Tree<keyType, duplicates, balance, Allocator>::iterator::operator*() const
 {
-	//Destroy the tree, leaving only the NIL node
-	destroyTree();
-
-	//Free up the memory allocated for the NIL node
-	delete NIL;
+    return node->key;
 }
 
-//*********************************************
-//			Public Member Functions
-//*********************************************
-//NOTE: Memory is allocated in this function
 /// <summary>
-/// Inserts a node into the Red-Black tree with a specified key value.
+/// Accesses a member of the key the iterator refers to.
 /// </summary>
-/// <param name="x"> The key value of the node being insterted. </param>
-template<typename keyType>
-void RB_Tree<keyType>::insert(const keyType x)
+/// <returns> A pointer to the key. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::iterator::pointer RB_Tree<keyType, duplicates, balance, Allocator>::iterator::operator->() const
 {
-    //Allocate a new node, initialize it with the data passed to the function
-    RB_Node* newNode = new RB_Node;
+    return &node->key;
+}
 
-    newNode->parent = NIL;
-    newNode->left = NIL;
-    newNode->right = NIL;
-    newNode->nodeColor = Color::RED;
-    newNode->key = x;
+/// <summary>
+/// Returns the number of copies of the key the iterator refers to. The iterator visits a Duplicates::COUNTED key
+/// once, so this is how a walk accounts for every copy without searching for the key again.
+/// </summary>
+/// <returns> The node's repeat count under Duplicates::COUNTED, otherwise 1. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+unsigned RB_Tree<keyType, duplicates, balance, Allocator>::iterator::count() const
+{
+    return tree->keyCount(node);
+}
 
-    //Insert the node into the tree
-    RB_insert(newNode);
+/// <summary>
+/// Advances to the next key in ascending order.
+/// </summary>
+/// <returns> A reference to this iterator after advancing. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::iterator& RB_Tree<keyType, duplicates, balance, Allocator>::iterator::operator++()
+{
+    node = tree->firstLive(tree->successor(node));
+    return *this;
 }
 
 /// <summary>
-/// Attempts to remove a node with the specified key value from the tree. If such a node does not exist
-/// nothing happens.
+/// Advances to the next key in ascending order.
 /// </summary>
-/// <param name="x"> The key value of the node to be removed from the tree. </param>
-/// <returns> Returns true if a node was removed, otherwise false. </returns>
-template<typename keyType>
-bool RB_Tree<keyType>::remove(const keyType x)
+/// <returns> A copy of the iterator before advancing. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::iterator RB_Tree<keyType, duplicates, balance, Allocator>::iterator::operator++(int)
 {
-	//Search for the node to delete. Returns NIL if the node does not exist.
-    RB_Node* nodeToDelete = search(root, x);
+    iterator before{ *this };
+    ++(*this);
+    return before;
+}
 
-	//If the node exists, delete it and return true
-    if (nodeToDelete != NIL)
-    {
-        RB_delete(nodeToDelete);
-		return true;
-    }
+/// <summary>
+/// Moves to the previous key in ascending order. Decrementing end() moves to the largest key.
+/// </summary>
+/// <returns> A reference to this iterator after moving. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::iterator& RB_Tree<keyType, duplicates, balance, Allocator>::iterator::operator--()
+{
+    node = tree->lastLive((node == tree->NIL) ? tree->rightmost : tree->predecessor(node));
+    return *this;
+}
 
-	//The node was not found, return false
-	return false;
+/// <summary>
+/// Moves to the previous key in ascending order.
+/// </summary>
+/// <returns> A copy of the iterator before moving. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::iterator RB_Tree<keyType, duplicates, balance, Allocator>::iterator::operator--(int)
+{
+    iterator before{ *this };
+    --(*this);
+    return before;
 }
 
 /// <summary>
-/// Determines if the key value specified is in the tree. The value of the pointer returned from search
-/// is compared to NIL. If the pointer is not NIL, the element was found and the expression evaluates to true. 
-/// If the pointer is NIL then the search was unsuccessful the expression evaluates to false.
+/// Two iterators are equal when they refer to the same node.
 /// </summary>
-/// <param name="keyValue"> The key value that is searched for in the tree </param>
-/// <returns> True if the key value passed is in the tree, otherwise false </returns>
-template<typename keyType>
-bool RB_Tree<keyType>::containsKey(const keyType keyValue) const
+/// <param name="right"> The iterator being compared to this one. </param>
+/// <returns> True if both iterators refer to the same position. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::iterator::operator==(const iterator& right) const
 {
-    return (search(root, keyValue) != NIL);
+    return node == right.node;
 }
 
 /// <summary>
-/// Checks to see if the tree is empty. The tree is empty if the root is NIL.
+/// Returns the NOT of operator==.
 /// </summary>
-/// <returns> True if the tree is empty, otherwise false </returns>
-template<typename keyType>
-bool RB_Tree<keyType>::isEmpty() const
+/// <param name="right"> The iterator being compared to this one. </param>
+/// <returns> True if the iterators refer to different positions. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::iterator::operator!=(const iterator& right) const
 {
-    return root == NIL;
+    return !(*this == right);
 }
 
+//************************************************
+//				Node Handle
+//************************************************
 /// <summary>
-/// Accessor function for the numRedNodes member
+/// Creates a handle that owns a detached node.
 /// </summary>
-/// <returns> The number of red nodes in the Red-Black tree. </returns>
-template<typename keyType>
-unsigned RB_Tree<keyType>::getNumRedNodes() const
+/// <param name="detached"> A node that is not linked into any tree. </param>
+/// <param name="source"> The allocator of the tree the node was detached from. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>::NodeHandle::NodeHandle(RB_Node* const detached, const NodeAllocator& source) : node{ detached },
+    allocator{ source }
 {
-    return numRedNodes;
 }
 
+//NOTE: Memory is freed in this function
 /// <summary>
-/// Accessor function for the numBlackNodes member.
+/// Frees the node if the handle owns one and leaves the handle empty.
 /// </summary>
-/// <returns> The number of black nodes in the Red-Black tree. </returns>
-template<typename keyType>
-unsigned RB_Tree<keyType>::getNumBlackNodes() const
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+void RB_Tree<keyType, duplicates, balance, Allocator>::NodeHandle::release()
 {
-    return numBlackNodes;
+    if (node != nullptr)
+    {
+        NodeTraits::destroy(*allocator, node);
+        NodeTraits::deallocate(*allocator, node, 1);
+        node = nullptr;
+    }
+    allocator.reset();
 }
 
 /// <summary>
-/// Gets the total number of nodes in the tree by adding the number of red and black nodes together.
+/// Creates an empty handle.
 /// </summary>
-/// <returns> The total number of nodes in the Red-Black tree. </returns>
-template<typename keyType>
-unsigned RB_Tree<keyType>::getNumNodes() const
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>::NodeHandle::NodeHandle() : node{ nullptr }
 {
-    return numRedNodes + numBlackNodes;
 }
 
 /// <summary>
-/// Calculates the height of the Red-Black tree.
+/// Takes the node owned by another handle, leaving that handle empty.
 /// </summary>
-/// <returns> The height of the Red-Black tree as an int. -1 is returned if the tree is empty. </returns>
-template<typename keyType>
-int RB_Tree<keyType>::getTreeHeight() const
+/// <param name="other"> The handle being moved from. </param>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>::NodeHandle::NodeHandle(NodeHandle&& other) noexcept : node{ other.node },
+    allocator{ std::move(other.allocator) }
 {
-    return calculateSubtreeHeight(root);
+    other.node = nullptr;
+    other.allocator.reset();
 }
 
+//NOTE: Memory is freed in this function
 /// <summary>
-/// Displays statistics about the Red-Black tree including total nodes, height, and number of red and black nodes.
+/// Frees the node if the handle still owns one.
 /// </summary>
-template<typename keyType>
-void RB_Tree<keyType>::statistics() const
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>::NodeHandle::~NodeHandle()
 {
-    std::cout << "Red-Black Tree Statistics\n";
-    std::cout << "-------------------------\n";
-    std::cout << std::setw(25) << "Total Nodes: " << getNumNodes() << std::endl;
-    std::cout << std::setw(25) << "Tree Height: " << getTreeHeight() << std::endl;
-    std::cout << std::setw(25) << "Number of Red Nodes: " << getNumRedNodes() << std::endl;
-    std::cout << std::setw(25) << "Number of Black Nodes: " << getNumBlackNodes() << std::endl;
+    release();
 }
 
+//NOTE: Memory is freed in this function
 /// <summary>
-/// Destroys the Red-Black tree, leaving only the NIL node as the root.
+/// Frees the node this handle owns, if any, and takes the node owned by another handle.
 /// </summary>
-template<typename keyType>
-void RB_Tree<keyType>::destroyTree()
+/// <param name="other"> The handle being moved from. </param>
+/// <returns> A reference to this handle. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+typename RB_Tree<keyType, duplicates, balance, Allocator>::NodeHandle& RB_Tree<keyType, duplicates, balance, Allocator>::NodeHandle::operator=(NodeHandle&& other) noexcept
 {
-	//While the tree is not empty, delete the root
-    while (root != NIL)
+    if (this != &other)
     {
-        RB_delete(root);
+        release();
+        node = other.node;
+        allocator = std::move(other.allocator);
+        other.node = nullptr;
+        other.allocator.reset();
     }
+
+    return *this;
 }
 
 /// <summary>
-/// Determines the type of way the tree wants to be displayed. As of now, the two options
-/// are ascending and descending. If more ways to order tree was to be added, add more types
-/// to the Order enumerator class and account for them within the displayTree function.
+/// Checks if the handle owns a node.
 /// </summary>
-/// <param name="ord"> Specifies the order in which the tree is displayed. </param>
-template<typename keyType>
-void RB_Tree<keyType>::displayTree(const Order ord) const
+/// <returns> True if the handle is empty, otherwise false. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::NodeHandle::empty() const
 {
-	// Set the node to its root value.
-	RB_Node* node = root;
+    return node == nullptr;
+}
 
-	// If the node is NIL, no tree.
-	if (node == NIL)
-	{
-		return;
-	}
-	// If the value of x is 0, place the tree in ascending order.
-	else if (ord == Order::ASC)
-	{
-		ascending(node);
-	}
-	// If the value of x is 1, place the tree in descending order.
-	else if (ord == Order::DES)
-	{
-		descending(node);
-	}
-	// If the value does not exist within the enumerator class Order, display the following:
-	else
-	{
-		std::cout << "Order not within the enumerator class." << std::endl;
-	}
+/// <summary>
+/// Checks if the handle owns a node.
+/// </summary>
+/// <returns> True if the handle owns a node, otherwise false. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>::NodeHandle::operator bool() const
+{
+    return node != nullptr;
 }
 
+/// <summary>
+/// Accesses the key of the owned node. Unlike keys in a tree it may be modified, which lets a key change its
+/// value and be reinserted without reallocating. Throws std::logic_error if the handle is empty.
+/// </summary>
+/// <returns> A reference to the key. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+keyType& RB_Tree<keyType, duplicates, balance, Allocator>::NodeHandle::key() const
+{
+    if (node == nullptr)
+    {
+        throw std::logic_error{ "ERROR: The node handle is empty." };
+    }
+
+    return node->key;
+}
 
 //************************************************
 //				Overloaded Operators
@@ -1004,8 +6803,8 @@ void RB_Tree<keyType>::displayTree(const Order ord) const
 /// </summary>
 /// <param name="right"> The tree on the right hand side of an assignment statement. (leftTree = rightTree) </param>
 /// <returns> A reference to the tree that has been assigned to. </returns>
-template<typename keyType>
-RB_Tree<keyType>& RB_Tree<keyType>::operator=(const RB_Tree<keyType>& right)
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>& RB_Tree<keyType, duplicates, balance, Allocator>::operator=(const RB_Tree<keyType, duplicates, balance, Allocator>& right)
 {
 	//this = right
 
@@ -1014,32 +6813,112 @@ RB_Tree<keyType>& RB_Tree<keyType>::operator=(const RB_Tree<keyType>& right)
 	{
 		//Destroy the tree being assigned to, which is overwritten by a new tree.
 		this->destroyTree();
+		if constexpr (NodeTraits::propagate_on_container_copy_assignment::value)
+		{
+			//Retired and pending nodes go back to the allocator they came from
+#if RB_TREE_CONCURRENT_READS
+			reclaim();
+#endif
+			finishTeardown();
+			nodeAllocator = right.nodeAllocator;
+		}
 
-		//Copy the number of red and black nodes
+		//Copy the number of red and black nodes and repeated keys
 		numBlackNodes = right.numBlackNodes;
 		numRedNodes = right.numRedNodes;
+		numRepeats = right.numRepeats;
+		numTombstones = right.numTombstones;
+		lazyDeletion = right.lazyDeletion;
+		compactThreshold = right.compactThreshold;
+		capacity = right.capacity;
+		eviction = right.eviction;
+		teardown = right.teardown;
+		teardownChunk = right.teardownChunk;
 
 		//Copy the right tree to the left tree
+		++structureVersion;
 		copyTree(root, right.root, right.NIL);	
+		leftmost = minimum(root);
+		rightmost = maximum(root);
+		filter = right.filter;
+		fingerSearch = right.fingerSearch;
+		hashIndex.setEnabled(right.hashIndex.isEnabled());
+		rebuildIndex();
 	}
 
 	//Return constant reference to the tree that was assigned to. Allows for cascading assignment.
 	return *this;
 }
 
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Move assigns one tree to another. The nodes are taken over if the allocator propagates on move assignment, in
+/// which case it is taken too, or if the allocators compare equal. Otherwise the keys are copied into nodes from this
+/// tree's allocator. The tree on the right is empty afterwards.
+/// </summary>
+/// <param name="right"> The tree being moved from. </param>
+/// <returns> A reference to the tree that has been assigned to. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>& RB_Tree<keyType, duplicates, balance, Allocator>::operator=(RB_Tree<keyType, duplicates, balance, Allocator>&& right)
+{
+	if (this != &right)
+	{
+		this->destroyTree();
+
+		if (NodeTraits::propagate_on_container_move_assignment::value || nodeAllocator == right.nodeAllocator)
+		{
+			if constexpr (NodeTraits::propagate_on_container_move_assignment::value)
+			{
+				//Retired and pending nodes go back to the allocator they came from
+#if RB_TREE_CONCURRENT_READS
+				reclaim();
+#endif
+				finishTeardown();
+				nodeAllocator = right.nodeAllocator;
+			}
+			adoptNodes(right);
+		}
+		else
+		{
+			//The nodes cannot change allocators, so they are copied and the right tree frees its own
+			++structureVersion;
+			copyTree(root, right.root, right.NIL);
+			leftmost = minimum(root);
+			rightmost = maximum(root);
+			numRedNodes = right.numRedNodes;
+			numBlackNodes = right.numBlackNodes;
+			numRepeats = right.numRepeats;
+			numTombstones = right.numTombstones;
+			lazyDeletion = right.lazyDeletion;
+			compactThreshold = right.compactThreshold;
+			capacity = right.capacity;
+			eviction = right.eviction;
+			teardown = right.teardown;
+			teardownChunk = right.teardownChunk;
+			filter = right.filter;
+			fingerSearch = right.fingerSearch;
+			hashIndex.setEnabled(right.hashIndex.isEnabled());
+			rebuildIndex();
+			right.destroyTree();
+		}
+	}
+
+	return *this;
+}
+
 /// <summary>
 /// Adds THIS tree and the right tree parameter. Red-Black tree addition (x + y) is defined as the tree that results
 /// from starting with tree x and then inserting nodes from tree y in LNR order.
 /// </summary>
 /// <param name="right"> The tree that is the right summand in an addition operation. </param>
 /// <returns> A copy of the sum of the two trees. This enables cascading. </returns>
-template<typename keyType>
-RB_Tree<keyType> RB_Tree<keyType>::operator+(const RB_Tree<keyType>& right) const
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator> RB_Tree<keyType, duplicates, balance, Allocator>::operator+(const RB_Tree<keyType, duplicates, balance, Allocator>& right) const
 {
 	//sum = this + right, return sum
 
 	//Initialize the sum to this tree
-	RB_Tree<keyType> sumTree{ *this };
+	RB_Tree<keyType, duplicates, balance, Allocator> sumTree{ *this };
 
 	//Insert each node from the right tree into the sum tree
 	sumTree.traverseInsert(right.root, right.NIL);
@@ -1053,20 +6932,111 @@ RB_Tree<keyType> RB_Tree<keyType>::operator+(const RB_Tree<keyType>& right) cons
 /// </summary>
 /// <param name="right"> The tree on the right hand side of the += operator. </param>
 /// <returns> A reference to THIS tree after the assignment has been done. </param>
-template<typename keyType>
-RB_Tree<keyType>& RB_Tree<keyType>::operator+=(const RB_Tree<keyType>& right)
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>& RB_Tree<keyType, duplicates, balance, Allocator>::operator+=(const RB_Tree<keyType, duplicates, balance, Allocator>& right)
 {
 	return *this = (*this + right);
 }
 
+/// <summary>
+/// Intersects THIS tree and the right tree. A key held a times in THIS tree and b times in the right tree is held
+/// min(a, b) times in the intersection. Runs in linear time, or in O(m log(n/m)) when one tree holds m keys and the
+/// other n much larger.
+/// </summary>
+/// <param name="right"> The tree being intersected with THIS tree. </param>
+/// <returns> A new tree holding the intersection. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator> RB_Tree<keyType, duplicates, balance, Allocator>::operator&(const RB_Tree<keyType, duplicates, balance, Allocator>& right) const
+{
+	return combineTrees(right, SetOperation::INTERSECTION);
+}
+
+/// <summary>
+/// Performs the intersection THIS & right and then assigns the result to THIS.
+/// </summary>
+/// <param name="right"> The tree on the right hand side of the &= operator. </param>
+/// <returns> A reference to THIS tree after the assignment has been done. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>& RB_Tree<keyType, duplicates, balance, Allocator>::operator&=(const RB_Tree<keyType, duplicates, balance, Allocator>& right)
+{
+	return *this = (*this & right);
+}
+
+/// <summary>
+/// Subtracts the right tree from THIS tree. A key held a times in THIS tree and b times in the right tree is held
+/// max(a - b, 0) times in the difference. Runs in linear time, or in O(m log(n/m)) when THIS tree holds m keys and
+/// the right tree n much larger.
+/// </summary>
+/// <param name="right"> The tree whose keys are taken away. </param>
+/// <returns> A new tree holding the difference. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator> RB_Tree<keyType, duplicates, balance, Allocator>::operator-(const RB_Tree<keyType, duplicates, balance, Allocator>& right) const
+{
+	return combineTrees(right, SetOperation::DIFFERENCE);
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Removes the keys of the right tree from THIS tree. When the right tree is much smaller its keys are removed in
+/// place, one copy at a time, in O(m log n). Otherwise the difference is built as by operator- and assigned to THIS.
+/// </summary>
+/// <param name="right"> The tree whose keys are taken away. </param>
+/// <returns> A reference to THIS tree after the keys have been removed. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>& RB_Tree<keyType, duplicates, balance, Allocator>::operator-=(const RB_Tree<keyType, duplicates, balance, Allocator>& right)
+{
+	if (this == &right)
+	{
+		destroyTree();
+		return *this;
+	}
+
+	if (!preferGalloping(right.getNumNodes(), getNumNodes()))
+	{
+		return *this = (*this - right);
+	}
+
+	for (RB_Node* node{ right.firstLive(right.leftmost) }; node != right.NIL; node = right.firstLive(right.successor(node)))
+	{
+		for (unsigned copies{ right.keyCount(node) }; copies > 0 && remove(node->key); --copies)
+		{
+		}
+	}
+
+	return *this;
+}
+
+/// <summary>
+/// Computes the symmetric difference of THIS tree and the right tree. A key held a times in THIS tree and b times in
+/// the right tree is held |a - b| times in the result. Runs in linear time.
+/// </summary>
+/// <param name="right"> The other tree. </param>
+/// <returns> A new tree holding the keys found in only one of the trees. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator> RB_Tree<keyType, duplicates, balance, Allocator>::operator^(const RB_Tree<keyType, duplicates, balance, Allocator>& right) const
+{
+	return combineTrees(right, SetOperation::SYMMETRIC_DIFFERENCE);
+}
+
+/// <summary>
+/// Performs the symmetric difference THIS ^ right and then assigns the result to THIS.
+/// </summary>
+/// <param name="right"> The tree on the right hand side of the ^= operator. </param>
+/// <returns> A reference to THIS tree after the assignment has been done. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+RB_Tree<keyType, duplicates, balance, Allocator>& RB_Tree<keyType, duplicates, balance, Allocator>::operator^=(const RB_Tree<keyType, duplicates, balance, Allocator>& right)
+{
+	return *this = (*this ^ right);
+}
+
 /// <summary>
 /// Compares two trees to determine if they are equal.
 /// Equality is defined as having the same structure, colors, and keys.
 /// </summary>
 /// <param name="right"> The tree on the right of the equality operation being compared to THIS tree. </param>
 /// <returns> True if the trees are the same, otherwise false. </returns>
-template<typename keyType>
-bool RB_Tree<keyType>::operator==(const RB_Tree& right) const
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::operator==(const RB_Tree& right) const
 {
 	//Check for self comparisson
 	if (this != &right)
@@ -1089,8 +7059,13 @@ bool RB_Tree<keyType>::operator==(const RB_Tree& right) const
 /// </summary>
 /// <param name="right"> Tree on the right hand side of the not equal operator. </param>
 /// <returns> True if the trees are equal, otherwise false. </returns>
-template<typename keyType>
-bool RB_Tree<keyType>::operator!=(const RB_Tree& right) const
+template<typename keyType, Duplicates duplicates, Balance balance, typename Allocator>
+bool RB_Tree<keyType, duplicates, balance, Allocator>::operator!=(const RB_Tree& right) const
 {
 	return !(*this == right);
-}
\ No newline at end of file
+}
+
+//Trees whose nodes come from a std::pmr::memory_resource, such as an arena shared by many trees or released with a
+//request. Construct them with the resource, for example PmrRBTree<int> tree{ &arena }.
+template<typename keyType, Duplicates duplicates = Duplicates::MULTI_NODE, Balance balance = Balance::RED_BLACK>
+using PmrRBTree = RB_Tree<keyType, duplicates, balance, std::pmr::polymorphic_allocator<keyType>>;
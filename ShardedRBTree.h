@@ -0,0 +1,776 @@
+#pragma once
+#include "RB_Tree.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+//Range-sharded tree for concurrent writers. A single RB_Tree serializes its writers, since any insert can rotate
+//nodes all the way up to the root. Here keys are partitioned by range across a fixed number of RB_Tree shards, each
+//guarded by its own mutex, so writers working on different key ranges update different trees and do not wait for
+//each other. The routing table lists the active shards in key order: active shard k holds the keys in
+//[splitKeys[k - 1], splitKeys[k]), so equal keys always share a shard.
+//
+//Split points adapt to the data. The tree starts with one active shard. When a shard grows past splitLimit it is
+//split at its median key into an unused shard, and once every shard is in use the adjacent pair holding the fewest
+//keys is merged first to free one. Nodes move between shards through node handles and merge, so no key is copied.
+//
+//Operations route without a shared lock. The routing table is never changed once published: a split or merge builds
+//a new one and swaps the pointer, and the old table is freed after a grace period, the way RB_Tree frees nodes under
+//RB_TREE_CONCURRENT_READS. Each shard also keeps its own range under its lock, so an operation that routed with a
+//table that was replaced meanwhile sees that the key is no longer in range once it has locked the shard, and routes
+//again. Only rebalance and destroyTree change the table, one at a time under rebalanceLock.
+template<typename keyType, Duplicates duplicates = Duplicates::MULTI_NODE, Balance balance = Balance::RED_BLACK>
+class ShardedRBTree
+{
+private:
+    //One range partition. Aligned to a cache line so the locks of neighbouring shards do not share one.
+    struct alignas(64) Shard
+    {
+        mutable std::mutex lock;                        //Guards the other members
+        RB_Tree<keyType, duplicates, balance> tree;     //Keys of the shard's range
+        std::optional<keyType> low;                     //Smallest key of the range, empty for the first active shard
+        std::optional<keyType> high;                    //First key past the range, empty for the last active shard
+        bool active{ false };                           //False while the shard is unused
+    };
+
+    //Routing table. Published tables are never changed, so operations read them without a lock.
+    struct Routing
+    {
+        std::vector<keyType> splitKeys;     //Smallest key of each active shard after the first
+        std::vector<Shard*> active;         //Active shards in key order
+    };
+
+    //Operations reading the routing table, counted under the parity of the epoch they entered in. Every thread has
+    //its own slot on its own cache line, so routing never writes to memory another thread writes to.
+    struct alignas(64) RouterSlot
+    {
+        std::atomic<unsigned> routers[2];
+    };
+
+    static constexpr unsigned minSplitKeys{ 1024 };     //Shards holding fewer keys than this are never split
+    static constexpr unsigned maxRouterSlots{ 64 };     //Threads beyond this many share slots
+
+    std::vector<std::unique_ptr<Shard>> shards;             //Every shard, never reordered or freed before the tree
+    std::unique_ptr<const Routing> table;                   //Current routing table, replaced under rebalanceLock
+    std::atomic<const Routing*> routing;                    //table.get(), read by operations without a lock
+    std::vector<std::unique_ptr<const Routing>> retired;    //Replaced tables that operations may still be reading
+    std::atomic<unsigned> splitLimit;                       //Number of keys a shard may hold before rebalance is called
+    mutable std::mutex rebalanceLock;                       //Held while the shards are split, merged or destroyed
+    mutable RouterSlot routerSlots[maxRouterSlots]{};       //Router counts, indexed by routerSlotIndex()
+    std::atomic<unsigned long long> routingEpoch{ 0 };      //Advanced by rebalance to start a grace period
+
+    //Private member functions
+    static unsigned routerSlotIndex();
+    static std::size_t shardIndex(const Routing&, const keyType&);
+    static bool inRange(const Shard&, const keyType* const);
+    Shard& lockShard(const keyType* const, std::unique_lock<std::mutex>&) const;
+    template<typename ShardVisitor>
+    void forEachShard(const keyType* const, ShardVisitor) const;
+    std::vector<unsigned> activeShardSizes() const;
+    void publish(Routing* const);
+    void waitForRouters();
+    void reclaimTables();
+    bool splitShard(const std::size_t);
+    void mergeShards(const std::size_t);
+    template<typename K>
+    bool insertKey(K&&);
+
+public:
+    //Constructor
+    explicit ShardedRBTree(const unsigned numShards = std::thread::hardware_concurrency());
+
+    //Shards hold locks, so the tree cannot be copied
+    ShardedRBTree(const ShardedRBTree&) = delete;
+    ShardedRBTree& operator=(const ShardedRBTree&) = delete;
+
+    //Public member functions
+    bool insert(const keyType& x);
+    bool insert(keyType&& x);
+    bool remove(const keyType& x);
+    bool containsKey(const keyType& x) const;
+    unsigned countKey(const keyType& x) const;
+    bool isEmpty() const;
+    unsigned getNumKeys() const;
+    unsigned getNumShards() const;
+    std::vector<unsigned> getShardSizes() const;
+    void rebalance();
+    void statistics() const;
+    void destroyTree();
+
+    template<typename Visitor>
+    void forEach(Visitor visit) const;
+    template<typename Visitor>
+    void forEachInRange(const keyType& low, const keyType& high, Visitor visit) const;
+};
+
+//*********************************************
+//			Private Member Functions
+//*********************************************
+/// <summary>
+/// Gives each thread a router slot of its own, round robin, so routers on different threads count themselves on
+/// different cache lines.
+/// </summary>
+/// <returns> The index of the calling thread's slot in routerSlots. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance>
+unsigned ShardedRBTree<keyType, duplicates, balance>::routerSlotIndex()
+{
+    static std::atomic<unsigned> nextSlot{ 0 };
+    thread_local const unsigned slot{ nextSlot.fetch_add(1, std::memory_order_relaxed) % maxRouterSlots };
+
+    return slot;
+}
+
+/// <summary>
+/// Finds the position in a routing table of the active shard whose range holds a key.
+/// </summary>
+/// <param name="current"> The routing table being searched. </param>
+/// <param name="x"> The key being routed. </param>
+/// <returns> The index of the shard in current.active. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance>
+std::size_t ShardedRBTree<keyType, duplicates, balance>::shardIndex(const Routing& current, const keyType& x)
+{
+    return static_cast<std::size_t>(std::upper_bound(current.splitKeys.begin(), current.splitKeys.end(), x) - current.splitKeys.begin());
+}
+
+/// <summary>
+/// Determines if a key is in the range of a shard. The caller must hold the shard's lock.
+/// </summary>
+/// <param name="shard"> The shard being checked. </param>
+/// <param name="x"> The key being checked, or nullptr to check for the first active shard. </param>
+/// <returns> True if the shard is active and its range holds the key, otherwise false. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance>
+bool ShardedRBTree<keyType, duplicates, balance>::inRange(const Shard& shard, const keyType* const x)
+{
+    if (!shard.active)
+    {
+        return false;
+    }
+
+    if (x == nullptr)
+    {
+        return !shard.low;
+    }
+
+    return (!shard.low || !(*x < *shard.low)) && (!shard.high || *x < *shard.high);
+}
+
+/// <summary>
+/// Finds and locks the active shard whose range holds a key. The routing table is read from the calling thread's
+/// router slot, so rebalance does not free it meanwhile, and the slot is left before the shard is locked. Shards are
+/// never freed, so the shard can still be locked once the table may be gone. If a split or merge moved the key's
+/// range away in between, it published the table that routes the key before unlocking the shard, so the search is
+/// repeated with that one.
+/// </summary>
+/// <param name="x"> The key being routed, or nullptr for the first active shard. </param>
+/// <param name="guard"> Receives the lock of the shard. </param>
+/// <returns> A reference to the locked shard. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance>
+typename ShardedRBTree<keyType, duplicates, balance>::Shard& ShardedRBTree<keyType, duplicates, balance>::lockShard(const keyType* const x, std::unique_lock<std::mutex>& guard) const
+{
+    RouterSlot& slot{ routerSlots[routerSlotIndex()] };
+
+    for (;;)
+    {
+        //Enter under the current epoch. If rebalance advanced it in between, it may already have checked this slot,
+        //so enter again under the new one.
+        const unsigned long long epoch{ routingEpoch.load() };
+        const unsigned parity{ static_cast<unsigned>(epoch & 1) };
+        slot.routers[parity].fetch_add(1);
+        if (routingEpoch.load() != epoch)
+        {
+            slot.routers[parity].fetch_sub(1, std::memory_order_release);
+            continue;
+        }
+
+        const Routing& current{ *routing.load(std::memory_order_acquire) };
+        Shard& shard{ *current.active[(x != nullptr) ? shardIndex(current, *x) : 0] };
+        slot.routers[parity].fetch_sub(1, std::memory_order_release);
+
+        guard = std::unique_lock<std::mutex>{ shard.lock };
+        if (inRange(shard, x))
+        {
+            return shard;
+        }
+        guard.unlock();
+    }
+}
+
+/// <summary>
+/// Locks the active shards one at a time in key order, starting with the one whose range holds a key, and calls the
+/// visitor for each while it is locked. Every shard after the first is routed by the first key past the previous
+/// range, so a split between two visits cannot skip a range. A merge can join a visited shard to the next one, so the
+/// visitor is given the key the shard was routed by and must skip the keys below it.
+/// </summary>
+/// <param name="from"> The key whose shard is visited first, or nullptr to start with the first active shard. </param>
+/// <param name="visitShard"> Called with each locked shard and the key it was routed by. Returns false to stop. </param>
+template<typename keyType, Duplicates duplicates, Balance balance>
+template<typename ShardVisitor>
+void ShardedRBTree<keyType, duplicates, balance>::forEachShard(const keyType* const from, ShardVisitor visitShard) const
+{
+    const keyType* next{ from };
+    std::optional<keyType> boundary;
+
+    for (;;)
+    {
+        std::unique_lock<std::mutex> guard;
+        const Shard& shard{ lockShard(next, guard) };
+
+        if (!visitShard(shard, next) || !shard.high)
+        {
+            return;
+        }
+
+        boundary = *shard.high;
+        next = &*boundary;
+    }
+}
+
+/// <summary>
+/// Gets the number of keys in each active shard of the current routing table. The caller must hold rebalanceLock,
+/// so the table cannot be replaced meanwhile.
+/// </summary>
+/// <returns> One entry per active shard, in key order. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance>
+std::vector<unsigned> ShardedRBTree<keyType, duplicates, balance>::activeShardSizes() const
+{
+    std::vector<unsigned> sizes;
+
+    for (const Shard* const shard : table->active)
+    {
+        std::lock_guard<std::mutex> guard{ shard->lock };
+        sizes.push_back(shard->tree.getNumKeys());
+    }
+
+    return sizes;
+}
+
+/// <summary>
+/// Replaces the routing table. The old table is kept until reclaimTables has waited for the operations that may still
+/// be reading it. The caller must hold rebalanceLock and the locks of every shard whose range changed, so operations
+/// that find their key out of range after locking one of them will load the new table.
+/// </summary>
+/// <param name="next"> The new routing table. The tree takes ownership of it. </param>
+template<typename keyType, Duplicates duplicates, Balance balance>
+void ShardedRBTree<keyType, duplicates, balance>::publish(Routing* const next)
+{
+    retired.push_back(std::move(table));
+    table.reset(next);
+    routing.store(next, std::memory_order_release);
+}
+
+/// <summary>
+/// Waits out a grace period: returns once every operation that was reading a routing table when the call was made has
+/// left its router slot. Advancing the epoch sends new routers to the other parity, so after advancing twice and
+/// waiting for the parity left behind to drain each time, no router from before the call remains.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance>
+void ShardedRBTree<keyType, duplicates, balance>::waitForRouters()
+{
+    for (int flip{ 0 }; flip < 2; ++flip)
+    {
+        const unsigned parity{ static_cast<unsigned>(routingEpoch.fetch_add(1) & 1) };
+
+        for (const RouterSlot& slot : routerSlots)
+        {
+            while (slot.routers[parity].load() != 0)
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Frees the routing tables replaced since the last call, after a grace period. Routers never wait while in their
+/// slot, so the caller must not hold any shard lock but does not wait long. The caller must hold rebalanceLock.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance>
+void ShardedRBTree<keyType, duplicates, balance>::reclaimTables()
+{
+    if (retired.empty())
+    {
+        return;
+    }
+
+    waitForRouters();
+    retired.clear();
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Splits an active shard at its median key, moving the upper half into an unused shard, which becomes active right
+/// after it. The largest keys are moved first, so each one is linked at the front of the new shard without a search.
+/// Only the two shards are locked. The caller must hold rebalanceLock and there must be an unused shard.
+/// </summary>
+/// <param name="index"> The position of the shard being split in the routing table. </param>
+/// <returns> True if the shard was split, false if all of its keys are equal. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance>
+bool ShardedRBTree<keyType, duplicates, balance>::splitShard(const std::size_t index)
+{
+    Shard& source{ *table->active[index] };
+
+    //Only rebalance and destroyTree change which shards are active, so the flag can be read here without the locks
+    Shard* unused{ nullptr };
+    for (const std::unique_ptr<Shard>& shard : shards)
+    {
+        if (!shard->active)
+        {
+            unused = shard.get();
+            break;
+        }
+    }
+    Shard& target{ *unused };
+
+    std::scoped_lock<std::mutex, std::mutex> guard{ source.lock, target.lock };
+
+    if (source.tree.isEmpty())
+    {
+        return false;
+    }
+
+    auto middle{ source.tree.begin() };
+    for (unsigned steps{ source.tree.getNumNodes() / 2 }; steps > 0; --steps)
+    {
+        ++middle;
+    }
+
+    //Equal keys have to stay together. If the lower half holds only copies of the smallest key, split after them.
+    keyType boundary{ *middle };
+    if (!(source.tree.getMin() < boundary))
+    {
+        const auto after{ source.tree.upperBound(boundary) };
+        if (after == source.tree.end())
+        {
+            return false;
+        }
+        boundary = *after;
+    }
+
+    while (!source.tree.isEmpty() && !(source.tree.getMax() < boundary))
+    {
+        target.tree.insert(source.tree.extract(--source.tree.end()));
+    }
+
+    target.low = boundary;
+    target.high = std::move(source.high);
+    target.active = true;
+    source.high = boundary;
+
+    Routing* const next{ new Routing{ *table } };
+    next->splitKeys.insert(next->splitKeys.begin() + index, std::move(boundary));
+    next->active.insert(next->active.begin() + index + 1, &target);
+    publish(next);
+
+    return true;
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Merges two adjacent active shards. The smaller shard's nodes are relinked into the larger one, which takes over
+/// both ranges, and the emptied shard becomes unused. Only the two shards are locked. The caller must hold
+/// rebalanceLock.
+/// </summary>
+/// <param name="index"> The position of the first shard of the pair in the routing table. </param>
+template<typename keyType, Duplicates duplicates, Balance balance>
+void ShardedRBTree<keyType, duplicates, balance>::mergeShards(const std::size_t index)
+{
+    Shard& first{ *table->active[index] };
+    Shard& second{ *table->active[index + 1] };
+
+    std::scoped_lock<std::mutex, std::mutex> guard{ first.lock, second.lock };
+
+    //The pair's ranges are disjoint, so every node is moved
+    const bool intoSecond{ first.tree.getNumNodes() < second.tree.getNumNodes() };
+    Shard& kept{ intoSecond ? second : first };
+    Shard& emptied{ intoSecond ? first : second };
+
+    kept.tree.merge(emptied.tree);
+    if (intoSecond)
+    {
+        second.low = std::move(first.low);
+    }
+    else
+    {
+        first.high = std::move(second.high);
+    }
+    emptied.low.reset();
+    emptied.high.reset();
+    emptied.active = false;
+
+    Routing* const next{ new Routing{ *table } };
+    next->splitKeys.erase(next->splitKeys.begin() + index);
+    next->active.erase(next->active.begin() + index + 1);
+    next->active[index] = &kept;
+    publish(next);
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Implements insert(x) for keys passed by reference and by rvalue. Only the shard owning the key's range is locked.
+/// If the shard has grown past the split limit, the tree is rebalanced after the shard is unlocked.
+/// </summary>
+/// <param name="x"> The key being inserted. </param>
+/// <returns> True if the key was stored, false if a Duplicates::UNIQUE tree already contained it. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance>
+template<typename K>
+bool ShardedRBTree<keyType, duplicates, balance>::insertKey(K&& x)
+{
+    bool inserted{ false };
+    bool overLimit{ false };
+
+    {
+        std::unique_lock<std::mutex> guard;
+        Shard& shard{ lockShard(&x, guard) };
+
+        inserted = shard.tree.insert(std::forward<K>(x));
+        overLimit = (shard.tree.getNumKeys() > splitLimit.load(std::memory_order_relaxed));
+    }
+
+    if (overLimit)
+    {
+        rebalance();
+    }
+
+    return inserted;
+}
+
+//***************************************
+//			Constructor
+//***************************************
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Constructor for ShardedRBTree. Allocates the shards up front, with only the first one active.
+/// </summary>
+/// <param name="numShards"> The most shards the keys are spread across. The number of hardware threads by default. </param>
+template<typename keyType, Duplicates duplicates, Balance balance>
+ShardedRBTree<keyType, duplicates, balance>::ShardedRBTree(const unsigned numShards) : routing{ nullptr }, splitLimit{ minSplitKeys }
+{
+    //hardware_concurrency() reports 0 when it cannot tell
+    const unsigned count{ std::max(numShards, 1u) };
+
+    shards.reserve(count);
+    for (unsigned i{ 0 }; i < count; ++i)
+    {
+        shards.push_back(std::unique_ptr<Shard>{ new Shard });
+    }
+
+    shards[0]->active = true;
+    table.reset(new Routing{ {}, { shards[0].get() } });
+    routing.store(table.get(), std::memory_order_release);
+}
+
+//*********************************************
+//			Public Member Functions
+//*********************************************
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Inserts a key into the shard owning its range. Only that shard is locked. If the shard has grown past the split
+/// limit, the tree is rebalanced after the shard is unlocked.
+/// </summary>
+/// <param name="x"> The key being inserted. </param>
+/// <returns> True if the key was stored, false if a Duplicates::UNIQUE tree already contained it. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance>
+bool ShardedRBTree<keyType, duplicates, balance>::insert(const keyType& x)
+{
+    return insertKey(x);
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Inserts a key as insert(x) does, moving it into the shard's node instead of copying it.
+/// </summary>
+/// <param name="x"> The key being inserted. </param>
+/// <returns> True if the key was stored, false if a Duplicates::UNIQUE tree already contained it. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance>
+bool ShardedRBTree<keyType, duplicates, balance>::insert(keyType&& x)
+{
+    return insertKey(std::move(x));
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Removes one copy of a key from the shard owning its range.
+/// </summary>
+/// <param name="x"> The key being removed. </param>
+/// <returns> True if a copy of the key was removed, otherwise false. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance>
+bool ShardedRBTree<keyType, duplicates, balance>::remove(const keyType& x)
+{
+    std::unique_lock<std::mutex> guard;
+    Shard& shard{ lockShard(&x, guard) };
+
+    return shard.tree.remove(x);
+}
+
+/// <summary>
+/// Determines if a key is in the tree by searching the shard owning its range.
+/// </summary>
+/// <param name="x"> The key being searched for. </param>
+/// <returns> True if the key is in the tree, otherwise false. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance>
+bool ShardedRBTree<keyType, duplicates, balance>::containsKey(const keyType& x) const
+{
+    std::unique_lock<std::mutex> guard;
+    const Shard& shard{ lockShard(&x, guard) };
+
+    return shard.tree.containsKey(x);
+}
+
+/// <summary>
+/// Counts the copies of a key. Equal keys always share a shard, so only one shard is searched.
+/// </summary>
+/// <param name="x"> The key being counted. </param>
+/// <returns> The number of times the key was inserted and not yet removed. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance>
+unsigned ShardedRBTree<keyType, duplicates, balance>::countKey(const keyType& x) const
+{
+    std::unique_lock<std::mutex> guard;
+    const Shard& shard{ lockShard(&x, guard) };
+
+    return shard.tree.countKey(x);
+}
+
+/// <summary>
+/// Checks to see if the tree is empty.
+/// </summary>
+/// <returns> True if no shard holds a key, otherwise false. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance>
+bool ShardedRBTree<keyType, duplicates, balance>::isEmpty() const
+{
+    return getNumKeys() == 0;
+}
+
+/// <summary>
+/// Gets the number of keys stored in the tree. The shards are locked one at a time, so concurrent writers to other
+/// shards may be counted before or after their changes.
+/// </summary>
+/// <returns> The total number of keys in every shard. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance>
+unsigned ShardedRBTree<keyType, duplicates, balance>::getNumKeys() const
+{
+    unsigned total{ 0 };
+
+    for (const unsigned size : getShardSizes())
+    {
+        total += size;
+    }
+
+    return total;
+}
+
+/// <summary>
+/// Gets the number of shards the keys may be spread across, active or not.
+/// </summary>
+/// <returns> The number of shards given to the constructor. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance>
+unsigned ShardedRBTree<keyType, duplicates, balance>::getNumShards() const
+{
+    return static_cast<unsigned>(shards.size());
+}
+
+/// <summary>
+/// Gets the number of keys in each active shard, in key order. The shards are locked one at a time. Splits and merges
+/// wait until the sizes are read, so no key is counted twice.
+/// </summary>
+/// <returns> One entry per active shard. </returns>
+template<typename keyType, Duplicates duplicates, Balance balance>
+std::vector<unsigned> ShardedRBTree<keyType, duplicates, balance>::getShardSizes() const
+{
+    std::lock_guard<std::mutex> rebalancing{ rebalanceLock };
+
+    return activeShardSizes();
+}
+
+//NOTE: Memory is allocated and freed in this function
+/// <summary>
+/// Adapts the split points to the shard sizes. While some shards are unused the split limit is the number of keys
+/// per shard if the keys were spread evenly, so every shard is put to use as the tree grows. Once all are in use it
+/// is twice that. It is never less than minSplitKeys. If the largest shard is over the limit it is split in half,
+/// first merging the adjacent pair with the fewest keys when every shard is in use. Afterwards other shards may grow
+/// a quarter past the largest one before the next call, so a shard that cannot be split, such as one holding a
+/// single key many times, does not cause a rebalance on every insert. Only the shards being split or merged are
+/// locked, while their nodes move, so operations on the other shards keep running.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance>
+void ShardedRBTree<keyType, duplicates, balance>::rebalance()
+{
+    std::lock_guard<std::mutex> rebalancing{ rebalanceLock };
+
+    std::vector<unsigned> sizes{ activeShardSizes() };
+    std::size_t total{ 0 };
+    std::size_t largest{ 0 };
+    for (std::size_t i{ 0 }; i < sizes.size(); ++i)
+    {
+        total += sizes[i];
+        if (sizes[i] > sizes[largest])
+        {
+            largest = i;
+        }
+    }
+
+    const std::size_t evenShare{ (total + shards.size() - 1) / shards.size() };
+    const bool unusedShards{ sizes.size() < shards.size() };
+    const std::size_t limit{ std::max<std::size_t>(minSplitKeys, unusedShards ? evenShare : 2 * evenShare) };
+
+    if (sizes[largest] > limit)
+    {
+        if (sizes.size() == shards.size())
+        {
+            //Pick the adjacent pair with the fewest keys that leaves the largest shard alone and stays under the limit
+            std::size_t pair{ shards.size() };
+            std::size_t pairKeys{ limit + 1 };
+
+            for (std::size_t i{ 0 }; i + 1 < sizes.size(); ++i)
+            {
+                const std::size_t keys{ static_cast<std::size_t>(sizes[i]) + sizes[i + 1] };
+
+                if (i != largest && i + 1 != largest && keys < pairKeys)
+                {
+                    pair = i;
+                    pairKeys = keys;
+                }
+            }
+
+            if (pair != shards.size())
+            {
+                mergeShards(pair);
+                largest -= (pair < largest) ? 1 : 0;
+            }
+        }
+
+        if (table->active.size() < shards.size())
+        {
+            splitShard(largest);
+        }
+
+        sizes = activeShardSizes();
+    }
+
+    const std::size_t maxKeys{ *std::max_element(sizes.begin(), sizes.end()) };
+    splitLimit.store(static_cast<unsigned>(std::max(limit, maxKeys + maxKeys / 4)), std::memory_order_relaxed);
+
+    reclaimTables();
+}
+
+/// <summary>
+/// Displays statistics about the tree: the total number of keys and the number of keys in each active shard.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance>
+void ShardedRBTree<keyType, duplicates, balance>::statistics() const
+{
+    const std::vector<unsigned> sizes{ getShardSizes() };
+    unsigned total{ 0 };
+    for (const unsigned size : sizes)
+    {
+        total += size;
+    }
+
+    std::cout << "Sharded Tree Statistics\n";
+    std::cout << "-------------------------\n";
+    std::cout << std::setw(25) << "Total Keys: " << total << std::endl;
+    std::cout << std::setw(25) << "Active Shards: " << sizes.size() << " of " << getNumShards() << std::endl;
+    for (std::size_t i{ 0 }; i < sizes.size(); ++i)
+    {
+        std::cout << std::setw(19) << "Shard " << std::setw(4) << i << ": " << sizes[i] << std::endl;
+    }
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Destroys every shard, leaving a single empty active shard. Every shard is locked while the nodes are freed.
+/// </summary>
+template<typename keyType, Duplicates duplicates, Balance balance>
+void ShardedRBTree<keyType, duplicates, balance>::destroyTree()
+{
+    std::lock_guard<std::mutex> rebalancing{ rebalanceLock };
+
+    {
+        //Nothing else holds more than one shard lock without rebalanceLock, so the order does not matter
+        std::vector<std::unique_lock<std::mutex>> guards;
+        for (const std::unique_ptr<Shard>& shard : shards)
+        {
+            guards.emplace_back(shard->lock);
+        }
+
+        for (const std::unique_ptr<Shard>& shard : shards)
+        {
+            shard->tree.destroyTree();
+            shard->low.reset();
+            shard->high.reset();
+            shard->active = false;
+        }
+
+        shards[0]->active = true;
+        publish(new Routing{ {}, { shards[0].get() } });
+        splitLimit.store(minSplitKeys, std::memory_order_relaxed);
+    }
+
+    reclaimTables();
+}
+
+/// <summary>
+/// Visits every key in ascending order, across the shards in key order, once for every copy of a repeated key so the
+/// visits add up to getNumKeys(). Each shard is locked while it is visited, so writers to other shards keep running
+/// and may be seen before or after their changes. A key moved by a concurrent split or merge is visited exactly once.
+/// The visitor must not call back into the tree.
+/// </summary>
+/// <param name="visit"> Called with a constant reference to each key. </param>
+template<typename keyType, Duplicates duplicates, Balance balance>
+template<typename Visitor>
+void ShardedRBTree<keyType, duplicates, balance>::forEach(Visitor visit) const
+{
+    forEachShard(nullptr, [&visit](const Shard& shard, const keyType* const from)
+    {
+        //The iterator visits a counted key once, whatever its count
+        auto position{ (from != nullptr) ? shard.tree.lowerBound(*from) : shard.tree.begin() };
+        for (; position != shard.tree.end(); ++position)
+        {
+            for (unsigned copy{ 0 }; copy < position.count(); ++copy)
+            {
+                visit(*position);
+            }
+        }
+        return true;
+    });
+}
+
+/// <summary>
+/// Visits the keys in [low, high] in ascending order, once for every copy as forEach does. Only the shards whose
+/// ranges overlap the interval are locked, one at a time, with the same consistency as forEach. The visitor must not
+/// call back into the tree.
+/// </summary>
+/// <param name="low"> The smallest key visited. </param>
+/// <param name="high"> The largest key visited. </param>
+/// <param name="visit"> Called with a constant reference to each key. </param>
+template<typename keyType, Duplicates duplicates, Balance balance>
+template<typename Visitor>
+void ShardedRBTree<keyType, duplicates, balance>::forEachInRange(const keyType& low, const keyType& high, Visitor visit) const
+{
+    if (high < low)
+    {
+        return;
+    }
+
+    forEachShard(&low, [&high, &visit](const Shard& shard, const keyType* const from)
+    {
+        for (auto position{ shard.tree.lowerBound(*from) }; position != shard.tree.end() && !(high < *position); ++position)
+        {
+            for (unsigned copy{ 0 }; copy < position.count(); ++copy)
+            {
+                visit(*position);
+            }
+        }
+
+        //The next shard starts at shard.high, so it only holds keys in the interval if high is not below that
+        return !(shard.high && high < *shard.high);
+    });
+}
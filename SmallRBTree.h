@@ -0,0 +1,609 @@
+#pragma once
+#include "RB_Tree.h"
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+
+//Tree for sets that are usually tiny. Up to inlineKeys keys are kept sorted in an array inside the object, so a small
+//set needs no heap memory and a lookup is a short scan of adjacent keys instead of a walk through scattered nodes.
+//Once the set outgrows the array its keys move into an RB_Tree, and they move back into the array when removals
+//bring the tree down to half the array. The gap between the two sizes keeps a set that hovers around inlineKeys
+//from moving its keys back and forth on every call.
+//
+//In the array every copy of a key takes its own slot, whatever the Duplicates policy, and Duplicates::UNIQUE rejects
+//keys that are already present just like RB_Tree does.
+template<typename keyType, unsigned inlineKeys = 8, Duplicates duplicates = Duplicates::MULTI_NODE, Balance balance = Balance::RED_BLACK>
+class SmallRBTree
+{
+private:
+    static_assert(inlineKeys > 0, "ERROR: A SmallRBTree needs room for at least one inline key.");
+
+    keyType keys[inlineKeys];                                   //Inline keys in ascending order, the first numInline are used
+    unsigned numInline;                                         //Number of keys in the array, 0 while the keys are in tree
+    std::unique_ptr<RB_Tree<keyType, duplicates, balance>> tree;    //Keys of a set that outgrew the array, null while small
+
+    //Private member functions
+    unsigned countBelow(const keyType&) const;
+    unsigned countNotAbove(const keyType&) const;
+    void moveToTree();
+    void moveToArray();
+    template<typename K>
+    bool insertKey(K&&);
+
+public:
+    //Default Constructor
+    SmallRBTree();
+
+    //Copy Constructor
+    SmallRBTree(const SmallRBTree&);
+
+    //Move Constructor
+    SmallRBTree(SmallRBTree&&) noexcept;
+
+    //Public member functions
+    bool insert(const keyType& x);
+    bool insert(keyType&& x);
+    bool remove(const keyType& x);
+    bool containsKey(const keyType& x) const;
+    unsigned countKey(const keyType& x) const;
+    bool isEmpty() const;
+    bool isInline() const;
+    unsigned getNumKeys() const;
+    const keyType& getMin() const;
+    const keyType& getMax() const;
+    keyType popMin();
+    keyType popMax();
+    MemoryUsage memoryUsage() const;
+    void statistics() const;
+    void destroyTree();
+
+    template<typename Visitor>
+    void forEach(Visitor visit) const;
+
+    //Overloaded Operators
+    SmallRBTree& operator=(const SmallRBTree&);
+    SmallRBTree& operator=(SmallRBTree&&) noexcept;
+};
+
+//*********************************************
+//			Private Member Functions
+//*********************************************
+/// <summary>
+/// Counts the inline keys that are smaller than x. The comparisons are summed rather than branched on, the way
+/// B_Tree scans its nodes, so the compiler is free to vectorize the scan.
+/// </summary>
+/// <param name="x"> The key being located. </param>
+/// <returns> The index of the first inline key that is not smaller than x. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+unsigned SmallRBTree<keyType, inlineKeys, duplicates, balance>::countBelow(const keyType& x) const
+{
+    unsigned found{ 0 };
+    for (unsigned i{ 0 }; i < numInline; ++i)
+    {
+        found += (keys[i] < x);
+    }
+    return found;
+}
+
+/// <summary>
+/// Counts the inline keys that are not larger than x, without branching on the comparisons.
+/// </summary>
+/// <param name="x"> The key being located. </param>
+/// <returns> The index of the first inline key that is larger than x. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+unsigned SmallRBTree<keyType, inlineKeys, duplicates, balance>::countNotAbove(const keyType& x) const
+{
+    unsigned found{ 0 };
+    for (unsigned i{ 0 }; i < numInline; ++i)
+    {
+        found += !(x < keys[i]);
+    }
+    return found;
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Moves the inline keys into a new RB_Tree. The keys are already sorted, so each one is linked after the previous
+/// one with a hinted insert and no search.
+/// </summary>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+void SmallRBTree<keyType, inlineKeys, duplicates, balance>::moveToTree()
+{
+    std::unique_ptr<RB_Tree<keyType, duplicates, balance>> grown{ new RB_Tree<keyType, duplicates, balance> };
+
+    for (unsigned i{ 0 }; i < numInline; ++i)
+    {
+        grown->insert(grown->end(), keys[i]);
+    }
+
+    //The tree holds copies, so the array is only emptied once nothing can throw
+    for (unsigned i{ 0 }; i < numInline; ++i)
+    {
+        keys[i] = keyType{};
+    }
+    numInline = 0;
+    tree = std::move(grown);
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Moves the keys of the tree back into the array and frees the tree. The tree must hold no more than inlineKeys keys.
+/// </summary>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+void SmallRBTree<keyType, inlineKeys, duplicates, balance>::moveToArray()
+{
+    //popMin hands out one copy at a time, so counted keys fill one slot per copy
+    while (!tree->isEmpty())
+    {
+        keys[numInline++] = tree->popMin();
+    }
+
+    tree.reset();
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Implements insert(x) for keys passed by reference and by rvalue. While the array has room the key is shifted into
+/// its sorted position after any equal keys. A key that does not fit moves the whole set into an RB_Tree first.
+/// </summary>
+/// <param name="x"> The key being inserted. </param>
+/// <returns> True if the key was stored, false if a Duplicates::UNIQUE tree already contained it. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+template<typename K>
+bool SmallRBTree<keyType, inlineKeys, duplicates, balance>::insertKey(K&& x)
+{
+    if (!tree)
+    {
+        const unsigned position{ countNotAbove(x) };
+
+        if constexpr (duplicates == Duplicates::UNIQUE)
+        {
+            if (position > 0 && !(keys[position - 1] < x))
+            {
+                return false;
+            }
+        }
+
+        if (numInline < inlineKeys)
+        {
+            std::move_backward(keys + position, keys + numInline, keys + numInline + 1);
+            keys[position] = std::forward<K>(x);
+            ++numInline;
+            return true;
+        }
+
+        moveToTree();
+    }
+
+    return tree->insert(std::forward<K>(x));
+}
+
+//***************************************
+//			Default Contructor
+//***************************************
+/// <summary>
+/// Constructor for SmallRBTree. The tree starts in the inline array and allocates no memory.
+/// </summary>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+SmallRBTree<keyType, inlineKeys, duplicates, balance>::SmallRBTree() : keys{}, numInline{ 0 }
+{
+}
+
+//***************************************
+//			Copy Constructor
+//***************************************
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// SmallRBTree copy constructor. Copies the inline keys, or the whole RB_Tree of a set that outgrew them.
+/// </summary>
+/// <param name="right"> Constant reference to the tree being copied. </param>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+SmallRBTree<keyType, inlineKeys, duplicates, balance>::SmallRBTree(const SmallRBTree& right) : numInline{ right.numInline }
+{
+    std::copy(right.keys, right.keys + inlineKeys, keys);
+    if (right.tree)
+    {
+        tree.reset(new RB_Tree<keyType, duplicates, balance>{ *right.tree });
+    }
+}
+
+//***************************************
+//			Move Constructor
+//***************************************
+/// <summary>
+/// SmallRBTree move constructor. Takes over the RB_Tree of a set that outgrew the array, or moves the inline keys in
+/// use. The moved-from tree is left empty.
+/// </summary>
+/// <param name="right"> The tree being moved from. </param>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+SmallRBTree<keyType, inlineKeys, duplicates, balance>::SmallRBTree(SmallRBTree&& right) noexcept : keys{},
+    numInline{ right.numInline }, tree{ std::move(right.tree) }
+{
+    std::move(right.keys, right.keys + right.numInline, keys);
+
+    //Release anything the moved-from slots still own
+    for (unsigned i{ 0 }; i < right.numInline; ++i)
+    {
+        right.keys[i] = keyType{};
+    }
+    right.numInline = 0;
+}
+
+//*********************************************
+//			Public Member Functions
+//*********************************************
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Inserts a key. While the array has room the key is shifted into its sorted position after any equal keys. A key
+/// that does not fit moves the whole set into an RB_Tree first.
+/// </summary>
+/// <param name="x"> The key being inserted. </param>
+/// <returns> True if the key was stored, false if a Duplicates::UNIQUE tree already contained it. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+bool SmallRBTree<keyType, inlineKeys, duplicates, balance>::insert(const keyType& x)
+{
+    return insertKey(x);
+}
+
+//NOTE: Memory is allocated in this function
+/// <summary>
+/// Inserts a key as insert(x) does, moving it into its slot or node instead of copying it. A key rejected by a
+/// Duplicates::UNIQUE tree is left untouched.
+/// </summary>
+/// <param name="x"> The key being inserted. </param>
+/// <returns> True if the key was stored, false if a Duplicates::UNIQUE tree already contained it. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+bool SmallRBTree<keyType, inlineKeys, duplicates, balance>::insert(keyType&& x)
+{
+    return insertKey(std::move(x));
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Removes one copy of a key. A tree that shrinks to half the array moves its keys back inline.
+/// </summary>
+/// <param name="x"> The key being removed. </param>
+/// <returns> True if a copy of the key was removed, otherwise false. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+bool SmallRBTree<keyType, inlineKeys, duplicates, balance>::remove(const keyType& x)
+{
+    if (tree)
+    {
+        if (!tree->remove(x))
+        {
+            return false;
+        }
+        if (tree->getNumKeys() <= inlineKeys / 2)
+        {
+            moveToArray();
+        }
+        return true;
+    }
+
+    const unsigned position{ countBelow(x) };
+
+    if (position == numInline || x < keys[position])
+    {
+        return false;
+    }
+
+    std::move(keys + position + 1, keys + numInline, keys + position);
+    --numInline;
+
+    //Release anything the vacated slot still owns
+    keys[numInline] = keyType{};
+
+    return true;
+}
+
+/// <summary>
+/// Determines if a key is in the tree.
+/// </summary>
+/// <param name="x"> The key being searched for. </param>
+/// <returns> True if the key is in the tree, otherwise false. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+bool SmallRBTree<keyType, inlineKeys, duplicates, balance>::containsKey(const keyType& x) const
+{
+    if (tree)
+    {
+        return tree->containsKey(x);
+    }
+
+    const unsigned position{ countBelow(x) };
+
+    return (position < numInline && !(x < keys[position]));
+}
+
+/// <summary>
+/// Counts the copies of a key stored in the tree.
+/// </summary>
+/// <param name="x"> The key being counted. </param>
+/// <returns> The number of times the key was inserted and not yet removed. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+unsigned SmallRBTree<keyType, inlineKeys, duplicates, balance>::countKey(const keyType& x) const
+{
+    if (tree)
+    {
+        return tree->countKey(x);
+    }
+
+    return countNotAbove(x) - countBelow(x);
+}
+
+/// <summary>
+/// Determines if the tree holds no keys.
+/// </summary>
+/// <returns> True if the tree is empty, otherwise false. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+bool SmallRBTree<keyType, inlineKeys, duplicates, balance>::isEmpty() const
+{
+    return (getNumKeys() == 0);
+}
+
+/// <summary>
+/// Determines if the keys are in the inline array rather than in an RB_Tree.
+/// </summary>
+/// <returns> True while the set fits in the array, otherwise false. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+bool SmallRBTree<keyType, inlineKeys, duplicates, balance>::isInline() const
+{
+    return !tree;
+}
+
+/// <summary>
+/// Counts the keys in the tree, every copy of a repeated key included.
+/// </summary>
+/// <returns> The number of keys in the tree. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+unsigned SmallRBTree<keyType, inlineKeys, duplicates, balance>::getNumKeys() const
+{
+    return tree ? tree->getNumKeys() : numInline;
+}
+
+/// <summary>
+/// Returns the smallest key in the tree. Throws std::out_of_range if the tree is empty.
+/// </summary>
+/// <returns> A reference to the smallest key. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+const keyType& SmallRBTree<keyType, inlineKeys, duplicates, balance>::getMin() const
+{
+    if (tree)
+    {
+        return tree->getMin();
+    }
+    if (numInline == 0)
+    {
+        throw std::out_of_range{ "ERROR: The tree is empty." };
+    }
+
+    return keys[0];
+}
+
+/// <summary>
+/// Returns the largest key in the tree. Throws std::out_of_range if the tree is empty.
+/// </summary>
+/// <returns> A reference to the largest key. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+const keyType& SmallRBTree<keyType, inlineKeys, duplicates, balance>::getMax() const
+{
+    if (tree)
+    {
+        return tree->getMax();
+    }
+    if (numInline == 0)
+    {
+        throw std::out_of_range{ "ERROR: The tree is empty." };
+    }
+
+    return keys[numInline - 1];
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Removes the smallest key from the tree and returns it. Throws std::out_of_range if the tree is empty.
+/// </summary>
+/// <returns> The key that was removed. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+keyType SmallRBTree<keyType, inlineKeys, duplicates, balance>::popMin()
+{
+    if (tree)
+    {
+        keyType x{ tree->popMin() };
+        if (tree->getNumKeys() <= inlineKeys / 2)
+        {
+            moveToArray();
+        }
+        return x;
+    }
+    if (numInline == 0)
+    {
+        throw std::out_of_range{ "ERROR: The tree is empty." };
+    }
+
+    keyType x{ std::move(keys[0]) };
+    std::move(keys + 1, keys + numInline, keys);
+    --numInline;
+    keys[numInline] = keyType{};
+
+    return x;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Removes the largest key from the tree and returns it. Throws std::out_of_range if the tree is empty.
+/// </summary>
+/// <returns> The key that was removed. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+keyType SmallRBTree<keyType, inlineKeys, duplicates, balance>::popMax()
+{
+    if (tree)
+    {
+        keyType x{ tree->popMax() };
+        if (tree->getNumKeys() <= inlineKeys / 2)
+        {
+            moveToArray();
+        }
+        return x;
+    }
+    if (numInline == 0)
+    {
+        throw std::out_of_range{ "ERROR: The tree is empty." };
+    }
+
+    --numInline;
+    keyType x{ std::move(keys[numInline]) };
+    keys[numInline] = keyType{};
+
+    return x;
+}
+
+/// <summary>
+/// Reports the heap memory held by the tree. A set in the inline array holds none besides what its keys own. A set
+/// that outgrew the array also holds its RB_Tree object, which is counted with the nodes.
+/// </summary>
+/// <returns> The memory usage broken down by source. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+MemoryUsage SmallRBTree<keyType, inlineKeys, duplicates, balance>::memoryUsage() const
+{
+    MemoryUsage usage;
+
+    if (tree)
+    {
+        usage = tree->memoryUsage();
+        usage.nodeBytes += sizeof(RB_Tree<keyType, duplicates, balance>);
+        return usage;
+    }
+
+    if constexpr (KeyHeapUsage<keyType>::ownsHeap)
+    {
+        for (unsigned i{ 0 }; i < numInline; ++i)
+        {
+            usage.keyHeapBytes += KeyHeapUsage<keyType>::bytes(keys[i]);
+        }
+    }
+
+    return usage;
+}
+
+/// <summary>
+/// Displays statistics about the tree: where the keys are stored and how many there are, followed by the statistics
+/// of the RB_Tree once the set has outgrown the array.
+/// </summary>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+void SmallRBTree<keyType, inlineKeys, duplicates, balance>::statistics() const
+{
+    std::cout << "Small Tree Statistics\n";
+    std::cout << "-------------------------\n";
+    std::cout << std::setw(25) << "Storage: " << (tree ? "tree" : "inline") << std::endl;
+    std::cout << std::setw(25) << "Total Keys: " << getNumKeys() << " (" << inlineKeys << " fit inline)" << std::endl;
+    if (tree)
+    {
+        tree->statistics();
+    }
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Removes every key and frees the RB_Tree, if there is one, returning the set to the inline array.
+/// </summary>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+void SmallRBTree<keyType, inlineKeys, duplicates, balance>::destroyTree()
+{
+    tree.reset();
+    for (unsigned i{ 0 }; i < numInline; ++i)
+    {
+        keys[i] = keyType{};
+    }
+    numInline = 0;
+}
+
+/// <summary>
+/// Calls a visitor with every key in ascending order, once for every copy of a repeated key.
+/// </summary>
+/// <param name="visit"> Callable taking a const keyType&. </param>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+template<typename Visitor>
+void SmallRBTree<keyType, inlineKeys, duplicates, balance>::forEach(Visitor visit) const
+{
+    if (!tree)
+    {
+        for (unsigned i{ 0 }; i < numInline; ++i)
+        {
+            visit(keys[i]);
+        }
+        return;
+    }
+
+    //The iterator visits a counted key once, whatever its count
+    for (auto position{ tree->begin() }; position != tree->end(); ++position)
+    {
+        for (unsigned copy{ 0 }; copy < position.count(); ++copy)
+        {
+            visit(*position);
+        }
+    }
+}
+
+//*********************************************
+//			Overloaded Operators
+//*********************************************
+//NOTE: Memory is allocated and freed in this function
+/// <summary>
+/// Overloaded assignment operator. Replaces the keys of this tree with copies of the keys of another.
+/// </summary>
+/// <param name="right"> The tree being copied. </param>
+/// <returns> A reference to this tree. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+SmallRBTree<keyType, inlineKeys, duplicates, balance>& SmallRBTree<keyType, inlineKeys, duplicates, balance>::operator=(const SmallRBTree& right)
+{
+    if (this != &right)
+    {
+        std::unique_ptr<RB_Tree<keyType, duplicates, balance>> copied;
+        if (right.tree)
+        {
+            copied.reset(new RB_Tree<keyType, duplicates, balance>{ *right.tree });
+        }
+
+        std::copy(right.keys, right.keys + inlineKeys, keys);
+        numInline = right.numInline;
+        tree = std::move(copied);
+    }
+
+    return *this;
+}
+
+//NOTE: Memory is freed in this function
+/// <summary>
+/// Overloaded move assignment operator. Frees the keys of this tree and takes over those of another, which is left
+/// empty.
+/// </summary>
+/// <param name="right"> The tree being moved from. </param>
+/// <returns> A reference to this tree. </returns>
+template<typename keyType, unsigned inlineKeys, Duplicates duplicates, Balance balance>
+SmallRBTree<keyType, inlineKeys, duplicates, balance>& SmallRBTree<keyType, inlineKeys, duplicates, balance>::operator=(SmallRBTree&& right) noexcept
+{
+    if (this != &right)
+    {
+        std::move(right.keys, right.keys + right.numInline, keys);
+
+        //Release the old keys past the moved ones, and anything the moved-from slots still own
+        for (unsigned i{ right.numInline }; i < numInline; ++i)
+        {
+            keys[i] = keyType{};
+        }
+        for (unsigned i{ 0 }; i < right.numInline; ++i)
+        {
+            right.keys[i] = keyType{};
+        }
+
+        numInline = right.numInline;
+        tree = std::move(right.tree);
+        right.numInline = 0;
+    }
+
+    return *this;
+}